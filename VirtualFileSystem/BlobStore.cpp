@@ -0,0 +1,186 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "BlobStore.h"
+#include "Checksum.h"
+#include "Compression.h"
+#include "ImageFormat.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+/**
+ *	\brief Constructor that should NOT be used.  Instead use 
+ *	BlobStore::intern(), so that bodies with the same bytes are shared.
+ *	
+ *	\param bytes The body, which is taken over rather than copied.
+ *	\param hash The contentHash() of the body.
+ */
+Blob::Blob( std::string bytes, std::uint64_t hash )
+	: bytes(std::move(bytes)), hash(hash)
+{
+}
+
+/**
+ *	\return The body.
+ */
+const std::string& Blob::getBytes() const
+{
+	return bytes;
+}
+
+/**
+ *	\return The contentHash() of the body.
+ */
+std::uint64_t Blob::getHash() const
+{
+	return hash;
+}
+
+/**
+ *	\brief Get the body the way it is saved in an image.
+ *	
+ *	\param flags Set to the NodeFlags of what is returned.
+ *	
+ *	A large body is compressed the first time it is saved, and the block is 
+ *	kept for every save after, whichever TextFile is saving it.
+ *	
+ *	\return The compressed block if it is smaller, otherwise the body.
+ */
+const std::string& Blob::getStored( std::uint8_t& flags ) const
+{
+	// Only keep the compressed block if it really is smaller
+	if( !storedChecked && bytes.length() >= TEXT_COMPRESS_THRESHOLD )
+	{
+		stored = compressFramed(bytes.data(), bytes.length(), TEXT_FRAME_SIZE);
+		storedFlags = NODE_COMPRESSED | NODE_FRAMED;
+		if( stored.length() >= bytes.length() )
+			std::string().swap(stored);
+	}
+	storedChecked = true;
+
+	if( stored.empty() )
+	{
+		flags = 0;
+		return bytes;
+	}
+
+	flags = storedFlags;
+	return stored;
+}
+
+/**
+ *	\brief Keep a compressed block that was already made for the body, so 
+ *	that saving it does not have to compress it again.
+ *	
+ *	\param block The compressed block
+ *	\param length How many bytes are in the block
+ *	\param flags The NodeFlags of the block
+ *	
+ *	Nothing changes if the body has already been checked for compression.
+ */
+void Blob::keepStored( const char* block, std::size_t length, 
+	std::uint8_t flags ) const
+{
+	if( storedChecked )
+		return;
+
+	stored.assign(block, length);
+	storedFlags = flags;
+	storedChecked = true;
+}
+
+/**
+ *	\brief Everything the store knows, there is only ever the one.
+ */
+struct BlobTable
+{
+	//! Held while the table is looked at or changed
+	std::mutex lock;
+
+	//! Every Blob that has been handed out, by the hash of its bytes.  Blobs 
+	//!	that have since been freed stay until the next sweep.
+	std::unordered_multimap<std::uint64_t, std::weak_ptr<const Blob>> blobs;
+
+	//! Sweep out the freed Blobs once the table is this big
+	std::size_t sweepAt = 1024;
+};
+
+//! \return The store's table, made the first time it is needed
+static BlobTable& table()
+{
+	static BlobTable blobs;
+	return blobs;
+}
+
+/**
+ *	\brief Get the Blob that holds a body.
+ *	
+ *	\param bytes The body.  It is only copied if no Blob has these bytes yet, 
+ *	and then it is taken over rather than copied.
+ *	
+ *	\return The Blob, shared with every other user of the same bytes.
+ */
+std::shared_ptr<const Blob> BlobStore::intern( std::string bytes )
+{
+	// Hash outside of the lock, it is the slow part for a long body
+	const std::uint64_t hash = contentHash(bytes.data(), bytes.length());
+
+	BlobTable& store = table();
+	std::lock_guard<std::mutex> guard(store.lock);
+
+	// Equal hashes are rare for bytes that are not equal, but not impossible
+	const auto range = store.blobs.equal_range(hash);
+	for( auto it = range.first; it != range.second; ++it)
+	{
+		auto blob = it->second.lock();
+		if( blob && blob->getBytes() == bytes )
+			return blob;
+	}
+
+	// Entries for freed Blobs are only swept out once they could be half of 
+	//	the table, so a sweep is amortized O(1) per body
+	if( store.blobs.size() >= store.sweepAt )
+	{
+		for( auto it = store.blobs.begin(); it != store.blobs.end(); )
+			it = it->second.expired() ? store.blobs.erase(it) : ++it;
+		store.sweepAt = std::max<std::size_t>(store.blobs.size() * 2, 1024);
+	}
+
+	auto blob = std::make_shared<Blob>(std::move(bytes), hash);
+	store.blobs.emplace(hash, blob);
+	return blob;
+}
+
+/**
+ *	\brief Add up how much sharing Blobs saves right now.
+ *	
+ *	\return How many Blobs are alive and how many times they are used, 
+ *	counting every TextFile and TextRope piece that holds one.
+ */
+SharingStats BlobStore::getStats()
+{
+	BlobTable& store = table();
+	std::lock_guard<std::mutex> guard(store.lock);
+
+	SharingStats stats;
+	for( const auto& entry : store.blobs)
+	{
+		const long uses = entry.second.use_count();
+		const auto blob = entry.second.lock();
+		if( !blob )
+			continue;
+
+		const std::uint64_t bytes = blob->getBytes().length();
+		stats.references += uses;
+		stats.distinct++;
+		stats.storedBytes += bytes;
+		stats.referencedBytes += bytes * uses;
+	}
+
+	return stats;
+}
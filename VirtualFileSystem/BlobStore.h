@@ -0,0 +1,135 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef BLOB_STORE_H
+#define BLOB_STORE_H
+
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ *	\brief How much is saved by keeping only one copy of each distinct body.
+ */
+struct SharingStats
+{
+	//! How many times the bodies are used
+	std::uint64_t references = 0;
+	//! How many distinct bodies there are
+	std::uint64_t distinct = 0;
+	//! Bytes the distinct bodies take up
+	std::uint64_t storedBytes = 0;
+	//! Bytes the bodies would take up if every use had its own copy
+	std::uint64_t referencedBytes = 0;
+};
+
+/**
+ *	\brief The body of one or more TextFiles, held once however many 
+ *	TextFiles have the same bytes.
+ *	
+ *	A Blob never changes once it is made, so it is shared between TextFiles 
+ *	freely, and it is released when the last one lets go of it.  Get one 
+ *	from BlobStore::intern().
+ */
+class Blob
+{
+public:
+	/**
+	 *	\brief Constructor that should NOT be used.  Instead use 
+	 *	BlobStore::intern(), so that bodies with the same bytes are shared.
+	 *	
+	 *	\param bytes The body, which is taken over rather than copied.
+	 *	\param hash The contentHash() of the body.
+	 */
+	Blob( std::string bytes, std::uint64_t hash );
+
+	/**
+	 *	\return The body.
+	 */
+	const std::string& getBytes() const;
+
+	/**
+	 *	\return The contentHash() of the body.
+	 */
+	std::uint64_t getHash() const;
+
+	/**
+	 *	\brief Get the body the way it is saved in an image.
+	 *	
+	 *	\param flags Set to the NodeFlags of what is returned.
+	 *	
+	 *	A large body is compressed the first time it is saved, and the block 
+	 *	is kept for every save after, whichever TextFile is saving it.
+	 *	
+	 *	\return The compressed block if it is smaller, otherwise the body.
+	 */
+	const std::string& getStored( std::uint8_t& flags ) const;
+
+	/**
+	 *	\brief Keep a compressed block that was already made for the body, 
+	 *	so that saving it does not have to compress it again.
+	 *	
+	 *	\param block The compressed block
+	 *	\param length How many bytes are in the block
+	 *	\param flags The NodeFlags of the block
+	 *	
+	 *	Nothing changes if the body has already been checked for compression.
+	 */
+	void keepStored( const char* block, std::size_t length, 
+		std::uint8_t flags ) const;
+
+private:
+	//! The body
+	const std::string bytes;
+
+	//! The contentHash() of bytes
+	const std::uint64_t hash;
+
+	//! The body as a compressed block, empty if it is not worth compressing
+	mutable std::string stored;
+
+	//! How stored is compressed, any of NodeFlags
+	mutable std::uint8_t storedFlags = 0;
+
+	//! Has the body been checked for compression yet?
+	mutable bool storedChecked = false;
+};
+
+/**
+ *	\brief Hands out a shared Blob for each distinct TextFile body.
+ *	
+ *	Bodies are looked up by their contentHash(), and only the ones with the 
+ *	same hash are compared byte for byte.  The store only keeps weak 
+ *	references, the TextFiles that share a Blob are what keep it alive, so a 
+ *	body that nothing uses any more is freed straight away.  The entries they 
+ *	leave behind are swept out as the store grows.
+ *	
+ *	The store is shared by the whole program and can be used from any thread.
+ */
+class BlobStore
+{
+public:
+	/**
+	 *	\brief Get the Blob that holds a body.
+	 *	
+	 *	\param bytes The body.  It is only copied if no Blob has these bytes 
+	 *	yet, and then it is taken over rather than copied.
+	 *	
+	 *	\return The Blob, shared with every other user of the same bytes.
+	 */
+	static std::shared_ptr<const Blob> intern( std::string bytes );
+
+	/**
+	 *	\brief Add up how much sharing Blobs saves right now.
+	 *	
+	 *	\return How many Blobs are alive and how many times they are used, 
+	 *	counting every TextFile and TextRope piece that holds one.
+	 */
+	static SharingStats getStats();
+};
+
+#endif
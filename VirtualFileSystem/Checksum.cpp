@@ -0,0 +1,324 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "Checksum.h"
+
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define CRC32C_SSE42
+	#define CRC32C_TARGET __attribute__((target("sse4.2")))
+	#include <nmmintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#define CRC32C_SSE42
+	#define CRC32C_TARGET
+	#include <intrin.h>
+	#include <nmmintrin.h>
+#endif
+
+//! The reflected Castagnoli polynomial
+static const std::uint32_t CRC32C_POLYNOMIAL = 0x82F63B78;
+
+/**
+ *	\brief The tables that the portable kernel uses.  Table 0 is the usual one 
+ *	entry per byte, table k advances a byte through k more zero bytes so that 
+ *	8 bytes can be folded in at once.
+ */
+struct Crc32cTables
+{
+	std::uint32_t entries[8][256];
+
+	Crc32cTables()
+	{
+		for( std::uint32_t i = 0; i < 256; i++)
+		{
+			std::uint32_t crc = i;
+			for( int bit = 0; bit < 8; bit++)
+				crc = (crc >> 1) ^ (crc & 1 ? CRC32C_POLYNOMIAL : 0);
+			entries[0][i] = crc;
+		}
+
+		for( int k = 1; k < 8; k++)
+			for( std::uint32_t i = 0; i < 256; i++)
+				entries[k][i] = (entries[k - 1][i] >> 8) ^ 
+					entries[0][entries[k - 1][i] & 0xFF];
+	}
+};
+
+/**
+ *	\brief The portable kernel, 8 bytes per step through the tables.
+ */
+static std::uint32_t crc32cTable( std::uint32_t crc, const char* data, 
+	std::size_t length )
+{
+	static const Crc32cTables tables;
+	const auto& t = tables.entries;
+
+	// Words are read in the host's (little-endian) order, like the image
+	for( ; length >= 8; data += 8, length -= 8)
+	{
+		std::uint32_t low;
+		std::uint32_t high;
+		std::memcpy(&low, data, sizeof(low));
+		std::memcpy(&high, data + 4, sizeof(high));
+		low ^= crc;
+
+		crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ 
+			t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^ 
+			t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ 
+			t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+	}
+
+	for( ; length > 0; data++, length--)
+		crc = (crc >> 8) ^ t[0][(crc ^ static_cast<unsigned char>(*data)) & 0xFF];
+
+	return crc;
+}
+
+#ifdef CRC32C_SSE42
+//! Bytes in each of the three lanes that the hardware kernel runs side by 
+//!	side, one crc32 has to finish before the next one in its lane can start
+static const std::size_t CRC32C_LANE = 1024;
+
+/**
+ *	\brief Run a crc through 8 bytes at a time, the way the CPU allows.
+ */
+CRC32C_TARGET
+static inline std::uint64_t crc32cWord( std::uint64_t crc, const char* data )
+{
+#if defined(__x86_64__) || defined(_M_X64)
+	std::uint64_t word;
+	std::memcpy(&word, data, sizeof(word));
+	return _mm_crc32_u64(crc, word);
+#else
+	std::uint32_t low;
+	std::uint32_t high;
+	std::memcpy(&low, data, sizeof(low));
+	std::memcpy(&high, data + 4, sizeof(high));
+	return _mm_crc32_u32(_mm_crc32_u32(static_cast<std::uint32_t>(crc), low), 
+		high);
+#endif
+}
+
+/**
+ *	\brief Tables that advance a crc over a fixed run of zero bytes in four 
+ *	lookups.  Used to stitch the lanes of the hardware kernel back together.
+ */
+struct Crc32cShift
+{
+	std::uint32_t entries[4][256];
+
+	/**
+	 *	\param length How many zero bytes the tables advance over
+	 */
+	explicit Crc32cShift( std::size_t length );
+
+	/**
+	 *	\return The crc after running it over the zero bytes
+	 */
+	std::uint32_t apply( std::uint32_t crc ) const
+	{
+		return entries[0][crc & 0xFF] ^ entries[1][(crc >> 8) & 0xFF] ^ 
+			entries[2][(crc >> 16) & 0xFF] ^ entries[3][crc >> 24];
+	}
+};
+
+/**
+ *	\param length How many zero bytes the tables advance over
+ *	
+ *	Advancing over zero bytes is linear, so it is worked out once for each bit 
+ *	and the tables combine those.
+ */
+CRC32C_TARGET
+Crc32cShift::Crc32cShift( std::size_t length )
+{
+	static const char zeros[8] = {};
+
+	std::uint32_t bits[32];
+	for( int bit = 0; bit < 32; bit++)
+	{
+		std::uint64_t crc = std::uint32_t(1) << bit;
+		for( std::size_t i = 0; i < length; i += 8)
+			crc = crc32cWord(crc, zeros);
+		bits[bit] = static_cast<std::uint32_t>(crc);
+	}
+
+	for( int k = 0; k < 4; k++)
+		for( std::uint32_t b = 0; b < 256; b++)
+		{
+			std::uint32_t crc = 0;
+			for( int bit = 0; bit < 8; bit++)
+				if( b & (1u << bit) )
+					crc ^= bits[k * 8 + bit];
+			entries[k][b] = crc;
+		}
+}
+
+/**
+ *	\brief The hardware kernel.  Large runs are split into three lanes that 
+ *	are checksummed at the same time, then shifted into place and combined.
+ */
+CRC32C_TARGET
+static std::uint32_t crc32cSse42( std::uint32_t crc, const char* data, 
+	std::size_t length )
+{
+	static const Crc32cShift oneLane(CRC32C_LANE);
+	static const Crc32cShift twoLanes(2 * CRC32C_LANE);
+
+	for( ; length >= 3 * CRC32C_LANE; data += 3 * CRC32C_LANE, 
+		length -= 3 * CRC32C_LANE)
+	{
+		std::uint64_t a = crc;
+		std::uint64_t b = 0;
+		std::uint64_t c = 0;
+		for( std::size_t i = 0; i < CRC32C_LANE; i += 8)
+		{
+			a = crc32cWord(a, data + i);
+			b = crc32cWord(b, data + CRC32C_LANE + i);
+			c = crc32cWord(c, data + 2 * CRC32C_LANE + i);
+		}
+
+		crc = twoLanes.apply(static_cast<std::uint32_t>(a)) ^ 
+			oneLane.apply(static_cast<std::uint32_t>(b)) ^ 
+			static_cast<std::uint32_t>(c);
+	}
+
+	std::uint64_t wide = crc;
+	for( ; length >= 8; data += 8, length -= 8)
+		wide = crc32cWord(wide, data);
+	crc = static_cast<std::uint32_t>(wide);
+
+	for( ; length > 0; data++, length--)
+		crc = _mm_crc32_u8(crc, static_cast<unsigned char>(*data));
+
+	return crc;
+}
+
+/**
+ *	\brief Ask the CPU whether it has the SSE4.2 crc32 instruction.
+ */
+static bool detectSse42()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 20)) != 0;
+#else
+	return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#endif
+
+/**
+ *	\brief	Is crc32c() running on the CPU's crc32 instruction?
+ *	
+ *	\return True if the hardware kernel is in use
+ */
+bool crc32cHardware()
+{
+#ifdef CRC32C_SSE42
+	static const bool supported = detectSse42();
+	return supported;
+#else
+	return false;
+#endif
+}
+
+/**
+ *	\brief	Compute the CRC32C (Castagnoli) of a block of bytes.
+ *	
+ *	\param data The bytes to checksum
+ *	\param length How many bytes there are
+ *	
+ *	The SSE4.2 crc32 instruction is used when the CPU has it, otherwise a 
+ *	lookup table is used.  Both give the same result.
+ *	
+ *	\return The checksum of the bytes
+ */
+std::uint32_t crc32c( const char* data, std::size_t length )
+{
+#ifdef CRC32C_SSE42
+	if( crc32cHardware() )
+		return ~crc32cSse42(0xFFFFFFFF, data, length);
+#endif
+
+	return ~crc32cTable(0xFFFFFFFF, data, length);
+}
+
+//! The multipliers of the content hash, odd and with their bits well mixed
+static const std::uint64_t HASH_PRIME_1 = 0x9E3779B185EBCA87ULL;
+static const std::uint64_t HASH_PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+static const std::uint64_t HASH_PRIME_3 = 0x165667B19E3779F9ULL;
+static const std::uint64_t HASH_PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+
+//! \return The bits of a word rotated left
+static inline std::uint64_t rotateLeft( std::uint64_t word, int bits )
+{
+	return (word << bits) | (word >> (64 - bits));
+}
+
+//! \return A lane after 8 more bytes have been mixed into it
+static inline std::uint64_t hashRound( std::uint64_t lane, const char* data )
+{
+	std::uint64_t word;
+	std::memcpy(&word, data, sizeof(word));
+	return rotateLeft(lane + word * HASH_PRIME_2, 31) * HASH_PRIME_1;
+}
+
+/**
+ *	\brief	Hash a block of bytes into 64 bits, for telling blocks apart.
+ *	
+ *	\param data The bytes to hash
+ *	\param length How many bytes there are
+ *	
+ *	Four lanes of multiply and rotate run side by side over 32 bytes at a 
+ *	time, so it keeps up with memcpy on long blocks.  Unlike crc32c() it is 
+ *	not meant to catch damage, only to make equal hashes rare for blocks that 
+ *	are not equal.
+ *	
+ *	\return The hash of the bytes
+ */
+std::uint64_t contentHash( const char* data, std::size_t length )
+{
+	std::uint64_t hash = HASH_PRIME_4 + length * HASH_PRIME_3;
+
+	if( length >= 32 )
+	{
+		std::uint64_t a = HASH_PRIME_1 + HASH_PRIME_2;
+		std::uint64_t b = HASH_PRIME_2;
+		std::uint64_t c = 0;
+		std::uint64_t d = 0 - HASH_PRIME_1;
+		for( ; length >= 32; data += 32, length -= 32)
+		{
+			a = hashRound(a, data);
+			b = hashRound(b, data + 8);
+			c = hashRound(c, data + 16);
+			d = hashRound(d, data + 24);
+		}
+
+		hash ^= rotateLeft(a, 1) + rotateLeft(b, 7) + rotateLeft(c, 12) + 
+			rotateLeft(d, 18);
+		hash *= HASH_PRIME_1;
+	}
+
+	// What is left is mixed in a word, then a byte, at a time
+	for( ; length >= 8; data += 8, length -= 8)
+		hash = rotateLeft(hash ^ hashRound(0, data), 27) * HASH_PRIME_1 + 
+			HASH_PRIME_4;
+
+	for( ; length > 0; data++, length--)
+		hash = rotateLeft(hash ^ static_cast<unsigned char>(*data) * 
+			HASH_PRIME_3, 11) * HASH_PRIME_1;
+
+	// Spread every bit of the lanes over the whole result
+	hash ^= hash >> 33;
+	hash *= HASH_PRIME_2;
+	hash ^= hash >> 29;
+	hash *= HASH_PRIME_3;
+	hash ^= hash >> 32;
+
+	return hash;
+}
@@ -0,0 +1,48 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ *	\brief	Compute the CRC32C (Castagnoli) of a block of bytes.
+ *	
+ *	\param data The bytes to checksum
+ *	\param length How many bytes there are
+ *	
+ *	The SSE4.2 crc32 instruction is used when the CPU has it, otherwise a 
+ *	lookup table is used.  Both give the same result.
+ *	
+ *	\return The checksum of the bytes
+ */
+std::uint32_t crc32c( const char* data, std::size_t length );
+
+/**
+ *	\brief	Is crc32c() running on the CPU's crc32 instruction?
+ *	
+ *	\return True if the hardware kernel is in use
+ */
+bool crc32cHardware();
+
+/**
+ *	\brief	Hash a block of bytes into 64 bits, for telling blocks apart.
+ *	
+ *	\param data The bytes to hash
+ *	\param length How many bytes there are
+ *	
+ *	Four lanes of multiply and rotate run side by side over 32 bytes at a 
+ *	time, so it keeps up with memcpy on long blocks.  Unlike crc32c() it is 
+ *	not meant to catch damage, only to make equal hashes rare for blocks that 
+ *	are not equal.
+ *	
+ *	\return The hash of the bytes
+ */
+std::uint64_t contentHash( const char* data, std::size_t length );
+
+#endif
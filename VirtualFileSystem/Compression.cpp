@@ -0,0 +1,373 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "Compression.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+//! Shortest match worth encoding
+static const std::size_t MIN_MATCH = 4;
+
+//! Matches can reach at most this far back
+static const std::size_t MAX_OFFSET = 0xFFFF;
+
+//! Bits in the hash of the next 4 bytes
+static const int HASH_BITS = 14;
+
+//! Bytes in the header of a block, the original length
+static const std::size_t BLOCK_HEADER = sizeof(std::uint64_t);
+
+/**
+ *	\brief Read 4 bytes in the host's order.
+ */
+static inline std::uint32_t read32( const char* p )
+{
+	std::uint32_t value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+/**
+ *	\brief Hash the next 4 bytes into the match table.
+ */
+static inline std::uint32_t hash4( std::uint32_t sequence )
+{
+	return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/**
+ *	\brief Write a count that has already had 15 taken off, as bytes of 255 
+ *	then the remainder.
+ */
+static void writeCount( std::string& out, std::size_t count )
+{
+	for( ; count >= 255; count -= 255)
+		out.push_back(static_cast<char>(255));
+	out.push_back(static_cast<char>(count));
+}
+
+/**
+ *	\brief Write one sequence: literals, then a match if there is one.
+ */
+static void writeSequence( std::string& out, const char* literals, 
+	std::size_t literalCount, std::size_t offset, std::size_t matchLength )
+{
+	const std::size_t matchCount = matchLength ? matchLength - MIN_MATCH : 0;
+
+	const unsigned char token = static_cast<unsigned char>(
+		(literalCount < 15 ? literalCount : 15) << 4 | 
+		(matchCount < 15 ? matchCount : 15));
+	out.push_back(static_cast<char>(token));
+
+	if( literalCount >= 15 )
+		writeCount(out, literalCount - 15);
+	out.append(literals, literalCount);
+
+	if( matchLength == 0 )
+		return;
+
+	out.push_back(static_cast<char>(offset & 0xFF));
+	out.push_back(static_cast<char>(offset >> 8));
+
+	if( matchCount >= 15 )
+		writeCount(out, matchCount - 15);
+}
+
+/**
+ *	\brief	Compress a run of bytes into a block.
+ *	
+ *	\param data The bytes to compress
+ *	\param length How many bytes there are
+ *	
+ *	\return The compressed block.  It may be bigger than the original for data 
+ *	that does not compress.
+ */
+std::string compressBlock( const char* data, std::size_t length )
+{
+	std::string out;
+	out.reserve(BLOCK_HEADER + length + length / 255 + 16);
+
+	const std::uint64_t header = length;
+	out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	// Where each hash of 4 bytes was last seen, plus 1 so 0 means never
+	std::vector<std::uint32_t> table(std::size_t(1) << HASH_BITS, 0);
+
+	std::size_t anchor = 0;
+	std::size_t pos = 0;
+	while( length >= MIN_MATCH && pos <= length - MIN_MATCH )
+	{
+		const std::uint32_t sequence = read32(data + pos);
+		std::uint32_t& slot = table[hash4(sequence)];
+		const std::size_t candidate = slot;
+		slot = static_cast<std::uint32_t>(pos + 1);
+
+		if( candidate == 0 || pos - (candidate - 1) > MAX_OFFSET || 
+			read32(data + candidate - 1) != sequence )
+		{
+			// Step faster through data that is not matching
+			pos += 1 + ((pos - anchor) >> 6);
+			continue;
+		}
+
+		// Grow the match as far as it goes
+		const std::size_t match = candidate - 1;
+		std::size_t matchLength = MIN_MATCH;
+		while( pos + matchLength < length && 
+			data[match + matchLength] == data[pos + matchLength] )
+			matchLength++;
+
+		writeSequence(out, data + anchor, pos - anchor, pos - match, 
+			matchLength);
+
+		pos += matchLength;
+		anchor = pos;
+	}
+
+	// Whatever is left over goes out as literals
+	writeSequence(out, data + anchor, length - anchor, 0, 0);
+
+	return out;
+}
+
+/**
+ *	\brief Read a count continued past 15.
+ *	
+ *	\return False if the block ends first.
+ */
+static bool readCount( const unsigned char*& in, const unsigned char* end, 
+	std::size_t& count )
+{
+	unsigned char byte;
+	do
+	{
+		if( in == end )
+			return false;
+		byte = *in++;
+		count += byte;
+	} while( byte == 255 );
+
+	return true;
+}
+
+/**
+ *	\brief	Expand a compressed block back into the original bytes.
+ *	
+ *	\param block The compressed block
+ *	\param length How many bytes are in the block
+ *	\param output Replaced with the original bytes
+ *	
+ *	\return False if the block is malformed, output is then empty.
+ */
+bool decompressBlock( const char* block, std::size_t length, 
+	std::string& output )
+{
+	output.clear();
+	if( length < BLOCK_HEADER )
+		return false;
+
+	std::uint64_t original;
+	std::memcpy(&original, block, sizeof(original));
+
+	// No sequence can expand by more than this, so anything bigger is damage
+	if( original > static_cast<std::uint64_t>(length) * 255 + 255 )
+		return false;
+
+	output.resize(static_cast<std::size_t>(original));
+	char* out = &output[0];
+	std::size_t used = 0;
+
+	const unsigned char* in = 
+		reinterpret_cast<const unsigned char*>(block) + BLOCK_HEADER;
+	const unsigned char* end = 
+		reinterpret_cast<const unsigned char*>(block) + length;
+
+	while( in < end )
+	{
+		const unsigned char token = *in++;
+
+		// Literals are copied straight through
+		std::size_t literals = token >> 4;
+		if( literals == 15 && !readCount(in, end, literals) )
+			break;
+		if( literals > static_cast<std::size_t>(end - in) || 
+			literals > original - used )
+			break;
+
+		std::memcpy(out + used, in, literals);
+		in += literals;
+		used += literals;
+
+		// The last sequence has no match
+		if( in == end )
+		{
+			if( used == original )
+				return true;
+			break;
+		}
+
+		if( end - in < 2 )
+			break;
+		const std::size_t offset = in[0] | static_cast<std::size_t>(in[1]) << 8;
+		in += 2;
+
+		std::size_t matchLength = token & 0x0F;
+		if( matchLength == 15 && !readCount(in, end, matchLength) )
+			break;
+		matchLength += MIN_MATCH;
+
+		if( offset == 0 || offset > used || matchLength > original - used )
+			break;
+
+		// Matches can overlap what they are copying, so go forward a byte at a 
+		//	time unless they are far enough apart
+		const char* from = out + used - offset;
+		if( offset >= matchLength )
+			std::memcpy(out + used, from, matchLength);
+		else
+			for( std::size_t i = 0; i < matchLength; i++)
+				out[used + i] = from[i];
+		used += matchLength;
+	}
+
+	output.clear();
+	return false;
+}
+
+/**
+ *	\brief	Compress a run of bytes into a framed block.
+ *	
+ *	\param data The bytes to compress
+ *	\param length How many bytes there are
+ *	\param frameSize How many of the bytes go into each frame
+ *	
+ *	\return The framed block
+ */
+std::string compressFramed( const char* data, std::size_t length, 
+	std::uint32_t frameSize )
+{
+	return compressFramed(length, frameSize, 
+		[data]( std::uint64_t offset, std::size_t ) { return data + offset; });
+}
+
+/**
+ *	\brief	Compress bytes that are not all in one place into a framed block.
+ *	
+ *	\param length How many bytes there are
+ *	\param frameSize How many of the bytes go into each frame
+ *	\param frame Called with the offset and size of each frame in turn, it 
+ *	returns the frame's bytes
+ *	
+ *	Only one frame is asked for at a time, so the bytes never have to be 
+ *	gathered in one place.
+ *	
+ *	\return The framed block
+ */
+std::string compressFramed( std::uint64_t length, std::uint32_t frameSize, 
+	const std::function<const char*( std::uint64_t, std::size_t )>& frame )
+{
+	const std::uint32_t frameCount = static_cast<std::uint32_t>(
+		(length + frameSize - 1) / frameSize);
+
+	// Header then room for the frame ends, which are known once each frame is
+	const std::uint64_t header = length;
+	std::string out(reinterpret_cast<const char*>(&header), sizeof(header));
+	out.append(reinterpret_cast<const char*>(&frameSize), sizeof(frameSize));
+	out.append(reinterpret_cast<const char*>(&frameCount), sizeof(frameCount));
+
+	const std::size_t endsAt = out.length();
+	out.resize(endsAt + frameCount * sizeof(std::uint32_t));
+	const std::size_t framesAt = out.length();
+
+	for( std::uint32_t i = 0; i < frameCount; i++)
+	{
+		const std::uint64_t offset = static_cast<std::uint64_t>(i) * frameSize;
+		const std::size_t size = static_cast<std::size_t>(
+			length - offset < frameSize ? length - offset : frameSize);
+		out += compressBlock(frame(offset, size), size);
+
+		const std::uint32_t end = static_cast<std::uint32_t>(
+			out.length() - framesAt);
+		std::memcpy(&out[endsAt + i * sizeof(end)], &end, sizeof(end));
+	}
+
+	return out;
+}
+
+/**
+ *	\brief	Check the header of a framed block and locate its frames.
+ *	
+ *	\param block The framed block
+ *	\param length How many bytes are in the block
+ *	\param framed Filled in with where the frames are
+ *	
+ *	\return False if the header does not describe the block.
+ */
+bool openFramed( const char* block, std::size_t length, FramedBlock& framed )
+{
+	const std::size_t header = sizeof(std::uint64_t) + 2 * sizeof(std::uint32_t);
+	if( length < header )
+		return false;
+
+	std::memcpy(&framed.length, block, sizeof(framed.length));
+	std::memcpy(&framed.frameSize, block + 8, sizeof(framed.frameSize));
+	std::memcpy(&framed.frameCount, block + 12, sizeof(framed.frameCount));
+
+	if( framed.frameSize == 0 || framed.frameCount != 
+		(framed.length + framed.frameSize - 1) / framed.frameSize ||
+		framed.frameCount > (length - header) / sizeof(std::uint32_t) )
+		return false;
+
+	framed.frameEnds = block + header;
+	framed.frames = framed.frameEnds + framed.frameCount * sizeof(std::uint32_t);
+	framed.framesLength = length - (framed.frames - block);
+
+	return true;
+}
+
+/**
+ *	\brief	Expand one frame of a framed block.
+ *	
+ *	\param framed A block that openFramed() accepted
+ *	\param index Which frame to expand
+ *	\param output Replaced with the frame's original bytes
+ *	
+ *	\return False if the frame is malformed, output is then empty.
+ */
+bool decompressFrame( const FramedBlock& framed, std::uint32_t index, 
+	std::string& output )
+{
+	output.clear();
+	if( index >= framed.frameCount )
+		return false;
+
+	std::uint32_t start = 0;
+	std::uint32_t end;
+	if( index > 0 )
+		std::memcpy(&start, framed.frameEnds + (index - 1) * sizeof(start), 
+			sizeof(start));
+	std::memcpy(&end, framed.frameEnds + index * sizeof(end), sizeof(end));
+
+	if( start > end || end > framed.framesLength )
+		return false;
+
+	// Every frame has to expand to exactly its share of the original
+	const std::uint64_t offset = static_cast<std::uint64_t>(index) * 
+		framed.frameSize;
+	const std::uint64_t expected = framed.length - offset < framed.frameSize ? 
+		framed.length - offset : framed.frameSize;
+
+	if( !decompressBlock(framed.frames + start, end - start, output) || 
+		output.length() != expected )
+	{
+		output.clear();
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,131 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <functional>
+
+/**
+ *	A small LZ77 codec in the style of LZ4, used to shrink large TextFile 
+ *	bodies in the image.  A compressed block is the length of the original 
+ *	bytes (8 bytes) followed by sequences of:
+ *	
+ *		token			High 4 bits: literal count, low 4 bits: match 
+ *						length - 4.  A 15 in either is continued by extra 
+ *						bytes that are added on until one is below 255.
+ *		literals		Bytes copied straight through.
+ *		offset			2 bytes, how far back the match starts.
+ *		match length	Continuation bytes for the match length.
+ *	
+ *	The last sequence only has literals, it ends the block.
+ *	
+ *	TextFile bodies are stored as a framed block of these, so that any part 
+ *	of a body can be read back without expanding the rest of it:
+ *	
+ *		length			8 bytes, the length of the original bytes.
+ *		frame size		4 bytes, original bytes in each frame but the last.
+ *		frame count		4 bytes.
+ *		frame ends		4 bytes per frame, where each frame ends, counted 
+ *						from the first frame.
+ *		frames			One compressed block per frame.
+ */
+
+/**
+ *	\brief Where the frames of a framed block are, once its header has been 
+ *	checked.
+ */
+struct FramedBlock
+{
+	//! Length of the original bytes
+	std::uint64_t length;
+	//! Original bytes in each frame but the last
+	std::uint32_t frameSize;
+	//! Number of frames
+	std::uint32_t frameCount;
+	//! Where each frame ends, frameCount 4 byte offsets
+	const char* frameEnds;
+	//! The first frame
+	const char* frames;
+	//! Bytes in all of the frames together
+	std::size_t framesLength;
+};
+
+/**
+ *	\brief	Compress a run of bytes into a block.
+ *	
+ *	\param data The bytes to compress
+ *	\param length How many bytes there are
+ *	
+ *	\return The compressed block.  It may be bigger than the original for 
+ *	data that does not compress.
+ */
+std::string compressBlock( const char* data, std::size_t length );
+
+/**
+ *	\brief	Expand a compressed block back into the original bytes.
+ *	
+ *	\param block The compressed block
+ *	\param length How many bytes are in the block
+ *	\param output Replaced with the original bytes
+ *	
+ *	\return False if the block is malformed, output is then empty.
+ */
+bool decompressBlock( const char* block, std::size_t length, 
+	std::string& output );
+
+/**
+ *	\brief	Compress a run of bytes into a framed block.
+ *	
+ *	\param data The bytes to compress
+ *	\param length How many bytes there are
+ *	\param frameSize How many of the bytes go into each frame
+ *	
+ *	\return The framed block
+ */
+std::string compressFramed( const char* data, std::size_t length, 
+	std::uint32_t frameSize );
+
+/**
+ *	\brief	Compress bytes that are not all in one place into a framed block.
+ *	
+ *	\param length How many bytes there are
+ *	\param frameSize How many of the bytes go into each frame
+ *	\param frame Called with the offset and size of each frame in turn, it 
+ *	returns the frame's bytes
+ *	
+ *	\return The framed block
+ */
+std::string compressFramed( std::uint64_t length, std::uint32_t frameSize, 
+	const std::function<const char*( std::uint64_t, std::size_t )>& frame );
+
+/**
+ *	\brief	Check the header of a framed block and locate its frames.
+ *	
+ *	\param block The framed block
+ *	\param length How many bytes are in the block
+ *	\param framed Filled in with where the frames are
+ *	
+ *	\return False if the header does not describe the block.
+ */
+bool openFramed( const char* block, std::size_t length, FramedBlock& framed );
+
+/**
+ *	\brief	Expand one frame of a framed block.
+ *	
+ *	\param framed A block that openFramed() accepted
+ *	\param index Which frame to expand
+ *	\param output Replaced with the frame's original bytes
+ *	
+ *	\return False if the frame is malformed, output is then empty.
+ */
+bool decompressFrame( const FramedBlock& framed, std::uint32_t index, 
+	std::string& output );
+
+#endif
@@ -6,6 +6,13 @@
 
 #include "Directory.h"
 #include "TextFile.h"
+#include "ImageWriter.h"
+#include "ImageReader.h"
+#include "ThreadPool.h"
+#include "NodeArena.h"
+#include "NodeTable.h"
+
+#include <algorithm>
 
 #include <iostream>
 #include <string>
@@ -17,16 +24,155 @@
  *	
  *	A directory can contain any number of other FSObjects.
  */
-void Directory::addObject( std::shared_ptr<FSObject> obj)
+void Directory::addObject( FSObject* obj)
+{
+	// New objects go after the ones still in the image
+	inflate();
+	placeObject(obj);
+
+	SubtreeTotals added;
+	obj->tally(added);
+	adjustTotals(added, SubtreeTotals());
+}
+
+/**
+ *	\brief Add a batch of FSObjects to this directory.
+ *	
+ *	\param batch The FSObjects to add, in order.
+ *	
+ *	The same as calling addObject() on each one, but the totals of the 
+ *	Directories above are only walked once for the whole batch.
+ */
+void Directory::addObjects( const std::vector<FSObject*>& batch)
+{
+	inflate();
+	objects.reserve(objects.size() + batch.size());
+
+	SubtreeTotals added;
+	for( const auto obj : batch)
+	{
+		placeObject(obj);
+		obj->tally(added);
+	}
+
+	adjustTotals(added, SubtreeTotals());
+}
+
+/**
+ *	\brief Put a child on the end of objects, without touching totals.
+ *	
+ *	\param obj The FSObject to add.
+ */
+void Directory::placeObject( FSObject* obj)
 {
+	const NodeKind kind = obj->getKind();
+	const auto position = static_cast<std::uint32_t>(objects.size());
+	kindPositions[kind].push_back(position);
+
+	// Keep the index up to date if its kind has been looked up before
+	if( indexedKinds & (1 << kind) )
+		childIndex[kind].insert(obj->getFileName(), position);
+
 	objCount++;
-	// Create a new shared pointer in the collection
-	objects.emplace_back(obj);
+	objects.push_back(obj);
+}
+
+/**
+ *	\brief Leave this Directory's children in an indexed image until they are 
+ *	first needed.
+ *	
+ *	\param image The mapped image that holds the children.
+ *	\param totals The totals of the image's Directories, this Directory's own 
+ *	totals are taken from it.
+ *	\param index This Directory's entry in the image's node table.
+ *	
+ *	The children are inflated the first time they are looked up, listed, or 
+ *	added to.  If they are never touched, writeToFile() copies the whole 
+ *	subtree straight out of the image.
+ */
+void Directory::deferChildren( std::shared_ptr<ImageFile> image, 
+	std::shared_ptr<const ImageTotals> totals, std::uint32_t index)
+{
+	this->image = std::move(image);
+	imageTotals = std::move(totals);
+	imageIndex = index;
+
+	// Nothing has been added yet, the parent picks these up in addObject
+	this->totals = imageTotals->get(index);
+}
+
+std::uint64_t Directory::inflateCount = 0;
+
+/**
+ *	\brief Count how many Directories have inflated their children out of an 
+ *	image.
+ *	
+ *	Inflating makes new FSObjects without any change being made to the 
+ *	FileSystem, so a flat copy of it checks this to tell when it is behind.
+ *	
+ *	\return The count, which only ever goes up.
+ */
+std::uint64_t Directory::getInflateCount()
+{
+	return inflateCount;
+}
+
+/**
+ *	\brief Get what is inside of this Directory, added up over its whole 
+ *	subtree.
+ *	
+ *	\return The totals, kept up to date as FSObjects are added.
+ */
+const SubtreeTotals& Directory::getTotals() const
+{
+	return totals;
+}
+
+/**
+ *	\brief Change the totals of this Directory and every Directory above it.
+ *	
+ *	\param added What was added to this Directory's subtree.
+ *	\param removed What was taken out of it.
+ *	
+ *	Only the Directories between here and root are touched, so it costs the 
+ *	depth of this Directory, not the size of the tree.
+ */
+void Directory::adjustTotals( const SubtreeTotals& added, 
+	const SubtreeTotals& removed )
+{
+	for( Directory* d = this; d; d = d->parent)
+	{
+		d->totals += added;
+		d->totals -= removed;
+	}
+}
+
+/**
+ *	\brief Inflate the children that are still stored in the image, if there 
+ *	are any.
+ */
+void Directory::inflate()
+{
+	if( !image )
+		return;
+
+	// Drop the stub first, inflating adds the children through addObject
+	const auto source = std::move(image);
+	const auto sourceTotals = std::move(imageTotals);
+
+	// addObject counts the children again as they are inflated
+	const SubtreeTotals counted = totals;
+	adjustTotals(SubtreeTotals(), counted);
+
+	inflateCount++;
+
+	ImageReader::inflateChildren(*this, source, sourceTotals, imageIndex);
 }
 
 /**
- *	\brief Create a brand new Directory and return a shared pointer to it.
+ *	\brief Create a brand new Directory and return a pointer to it.
  *	
+ *	\param arena The NodeArena that will own the Directory
  *	\param name The name of this Directory
  *	\param parent What Directory contains this Directory
  *	\param root Is this Directory located at the root level?
@@ -34,9 +180,9 @@ void Directory::addObject( std::shared_ptr<FSObject> obj)
  *	Create a new Directory for the File System.  If this is root, then it needs 
  *	to be flagged so that it knows it has no parent.
  *	
- *	\return A shared pointer to the new Directory
+ *	\return A pointer to the new Directory, or null if the name is invalid
  */
-std::shared_ptr<Directory> Directory::CreateDirectory( std::string name, 
+Directory* Directory::CreateDirectory( NodeArena& arena, std::string name, 
 	Directory* parent, bool root)
 {
 	// Ensure that the filename is valid according to the spec
@@ -48,7 +194,9 @@ std::shared_ptr<Directory> Directory::CreateDirectory( std::string name,
 	}
 
 	// Toss back out new Dir for the FileSystem to use
-	return std::make_shared<Directory>(n, parent, root);
+	Directory* dir = arena.make<Directory>(n, parent, root);
+	dir->arena = &arena;
+	return dir;
 }
 
 /**
@@ -104,15 +252,19 @@ bool Directory::validName( std::string* name)
  *	\param root Is this Directory the root Directory?
  *	
  *	The makeDirectory() function should be used so that the new Directory is 
- *	allocated on the heap.  This is required to allow for the file system to be 
+ *	allocated in a NodeArena.  This is required to allow for the file system to be 
  *	serialized into a binary file.  If this constructor is used, the data will 
  *	likely not be saved.
  */
 Directory::Directory(const std::string& name, Directory* parent, bool root)
+	: FSObject(NODE_DIRECTORY)
 {
 	isRoot = root;
 	fileName = name;
 	this->parent = parent;
+
+	// A parent is always made before its children, so its path is ready
+	path = parent ? parent->path + "/" + fileName.str() : fileName.str();
 }
 
 /**
@@ -126,6 +278,24 @@ Directory* Directory::getParent()
 	return parent;
 }
 
+/**
+ *	\brief Return the absolute path of this Directory, like "root/a/b".
+ *	
+ *	\return The path, worked out once when this Directory was made.
+ */
+const std::string& Directory::getPath() const
+{
+	return path;
+}
+
+/**
+ *	\return The NodeArena this Directory and its children are made in.
+ */
+NodeArena& Directory::getArena() const
+{
+	return *arena;
+}
+
 /**
  *	\brief Print data for this Directory and print the data for all of it's 
  *	children.
@@ -133,15 +303,32 @@ Directory* Directory::getParent()
  *	\param tabs How many tabs to include before the file data (not used anymore)
  */
 void Directory::printData(int tabs)
-{		
+{
+	printData(tabs, LIVE_GENERATION);
+}
+
+/**
+ *	\brief Print data for the children of this Directory that are part of a 
+ *	view of the FileSystem.
+ *	
+ *	\param tabs How many tabs to include before the file data (not used anymore)
+ *	\param generation The view to list, a snapshot or LIVE_GENERATION
+ */
+void Directory::printData(int tabs, std::uint32_t generation)
+{
+	inflate();
+
 	std::cout << "Directory Name: " << fileName << std::endl;
 		
 	// Recursively print kids
 	for( auto& e : objects)
 	{
-		auto* d = dynamic_cast<Directory*>(e.get());
-		if( d )
-			std::cout << "Directory Name: " << d->getFileName() << std::endl;
+		// Anything made after the snapshot is not part of it
+		if( !e->visibleIn(generation) )
+			continue;
+
+		if( e->getKind() == NODE_DIRECTORY )
+			std::cout << "Directory Name: " << e->getFileName() << std::endl;
 
 		else
 			e->printData(0);
@@ -152,6 +339,7 @@ void Directory::printData(int tabs)
  *	\brief Search this directory for a directory that has a matching name.
  *	
  *	\param name The name of the Directory to locate.
+ *	\param generation Only look at children in this view of the FileSystem
  *	
  *	Only the first instance of a directory with a matching name is returned.  
  *	There can be multiple Directories with the same name, but only the first 
@@ -159,31 +347,22 @@ void Directory::printData(int tabs)
  *	
  *	\return A pointer to the Directory or null if not found.
  */
-Directory* Directory::getDirectory(const std::string& name)
+Directory* Directory::getDirectory(const std::string& name, 
+	std::uint32_t generation)
 {
 	// Handle special case for going up a dir
 	if( name == "..")
 		return parent;
-		
-	// Search through all children
-	for( auto& e : objects)
-	{
-		// Try to cast to a Dir, or nullptr if it fails
-		Directory* d = dynamic_cast<Directory*>(e.get());
 
-		// If the cast was valid, it's a Directory, check it's name
-		if( d && d->getFileName() == name )
-			return d;
-	}
-
-	// It was not found
-	return nullptr;
+	return static_cast<Directory*>(findChild(NODE_DIRECTORY, name, 0, 
+		generation));
 }
 
 /**
  *	\brief Search this directory for a TextFile that has a matching name.
  *	
  *	\param name The name of the TextFile to locate.
+ *	\param generation Only look at children in this view of the FileSystem
  *	
  *	Only the first instance of a TextFile with a matching name is returned.  
  *	There can be multiple TextFile with the same name, but only the first will 
@@ -191,26 +370,17 @@ Directory* Directory::getDirectory(const std::string& name)
  *	
  *	\return A pointer to the TextFile or null if not found.
  */
-TextFile* Directory::getTextfile(const std::string& name)
+TextFile* Directory::getTextfile(const std::string& name, 
+	std::uint32_t generation)
 {
-	// Search through all children to find one with a matching name
-	for( auto& e : objects)
-	{
-		// Try to cast to a TextFile
-		TextFile* t = dynamic_cast<TextFile*>(e.get());
-
-		// If the cast passes, check the name with and without an extension
-		if( t && (t->getFileName() == name || name == t->getFileName() + ".t" ))
-			return t;
-	}
-
-	return nullptr;
+	return static_cast<TextFile*>(findChild(NODE_TEXT, name, 't', generation));
 }
 
 /**
  *	\brief Search this directory for a ProgramFile that has a matching name.
  *	
  *	\param name The name of the ProgramFile to locate.
+ *	\param generation Only look at children in this view of the FileSystem
  *	
  *	Only the first instance of a ProgramFile with a matching name is returned.  
  *	There can be multiple ProgramFile with the same name, but only the first 
@@ -218,58 +388,319 @@ TextFile* Directory::getTextfile(const std::string& name)
  *	
  *	\return A pointer to the ProgramFile or null if not found.
  */
-ProgramFile* Directory::getProgramfile(const std::string& name)
+ProgramFile* Directory::getProgramfile(const std::string& name, 
+	std::uint32_t generation)
 {
-	// Search through all children to find one with a matching name
-	for( auto& e : objects)
+	return static_cast<ProgramFile*>(findChild(NODE_PROGRAM, name, 'p', 
+		generation));
+}
+
+/**
+ *	\brief Change part of the body of a TextFile in this Directory.
+ *	
+ *	\param file The TextFile, as getTextfile() found it in the live view.
+ *	\param offset The first byte to replace, past the end is the end.
+ *	\param length How many bytes to replace, 0 to only insert.
+ *	\param text What goes in their place.
+ *	\param generation The generation the change is made in.
+ *	
+ *	A TextFile that a snapshot can see is not changed.  It is replaced by a 
+ *	new TextFile made in this generation, which shares the old body rather 
+ *	than copying it, and the snapshot keeps the old one.
+ *	
+ *	\return The TextFile that has the new body.
+ */
+TextFile* Directory::editTextfile(TextFile* file, std::uint64_t offset, 
+	std::uint64_t length, const std::string& text, std::uint32_t generation)
+{
+	SubtreeTotals before;
+	file->tally(before);
+
+	// Edits made since the last snapshot are not in any snapshot
+	if( file->getGeneration() >= generation )
 	{
-		// Try to cast to a ProgramFile, or nullptr if fails
-		ProgramFile* p = dynamic_cast<ProgramFile*>(e.get());
+		file->edit(offset, length, text);
 
-		// If the cast passes, check the name with and without an extension
-		if( p && (p->getFileName() == name || name == p->getFileName() + ".p" ))
-			return p;
+		SubtreeTotals after;
+		file->tally(after);
+		adjustTotals(after, before);
+		return file;
 	}
 
-	return nullptr;
+	// addObject counts the new one, the old one is not live anymore
+	TextFile* next = file->replace(getArena(), generation);
+	next->edit(offset, length, text);
+	adjustTotals(SubtreeTotals(), before);
+	addObject(next);
+
+	return next;
 }
 
 /**
- *	\brief Flatten this Directory and write it to a Binary File Stream.
+ *	\brief Find the first child of a kind with a matching name.
+ *	
+ *	\param kind What kind of FSObject to look for.
+ *	\param name The name to look for.
+ *	\param extension The kind's extension, name can also be the child's name 
+ *	with "." and this on the end.  0 if the kind has none.
+ *	\param generation Only look at children in this view of the FileSystem
  *	
- *	\param stream The Binary File Stream to write this Directory to.
+ *	The first lookup of a kind indexes every child of that kind, every lookup 
+ *	after that is a hash lookup.
  *	
- *	This Directory will be written to the stream, which in turn will recursively 
- *	write all children of this Directory to the stream.  Calling this on a root 
- *	Directory will result in the entire FileSystem being written to the file 
- *	stream.
+ *	\return The child, or null if there is not one.
  */
-void Directory::writeToFile(std::ofstream& stream)
+FSObject* Directory::findChild(NodeKind kind, const std::string& name, 
+	char extension, std::uint32_t generation)
 {
-	// Write the Directory's name
-	stream << fileName;
+	inflate();
+
+	NameIndex& index = childIndex[kind];
+	Name key;
+	if( !(indexedKinds & (1 << kind)) )
+	{
+		// Only the first child with a name can ever be found, insert() keeps 
+		//	the earliest one
+		for( const auto position : kindPositions[kind])
+			index.insert(objects[position]->getFileName(), position);
+
+		indexedKinds |= 1 << kind;
+	}
+
+	// Anything longer than 8 chars cannot be the name of a child
+	std::uint32_t first = NameIndex::NOT_FOUND;
+	if( Name::pack(name.data(), name.length(), key) )
+		first = index.find(key);
+
+	// "name.t" finds a TextFile called "name" too, whichever came first wins
+	const std::size_t len = name.length();
+	if( extension && len > 2 && name[len - 2] == '.' && 
+		name[len - 1] == extension && Name::pack(name.data(), len - 2, key) )
+		first = std::min(first, index.find(key));
+
+	if( first == NameIndex::NOT_FOUND )
+		return nullptr;
 
-	// Fill the rest of the spaces with null chars
-	for( int i = fileName.length(); i < 8; i++)
-		stream << '\0';
+	// An edited TextFile is replaced rather than changed, follow the chain of 
+	//	replacements up to the one the view sees
+	FSObject* found = objects[first];
+	while( found && found->getReplaced() != LIVE_GENERATION && 
+		found->getReplaced() <= generation )
+		found = kind == NODE_TEXT ? 
+			static_cast<TextFile*>(found)->getReplacement() : nullptr;
 
-	// Add the extension as per spec.
-	stream << ".d";
-	stream << '\0';
+	// Children are added in order, so if the first one with the name is 
+	//	newer than the view, every other one is too
+	if( !found || !found->visibleIn(generation) )
+		return nullptr;
 
-	// Keep a track of how many objects are in the Directory
-	stream.write((char*)&objCount, sizeof(objCount));
-	
+	return found;
+}
 
-	// Recursively write all children to the stream
+/**
+ *	\brief Flatten this Directory and add it to an image.
+ *	
+ *	\param writer The image to add this Directory to.
+ *	\param parent Index of the Directory that holds this one, or NO_PARENT
+ *	
+ *	This Directory will be added to the image, which in turn will recursively 
+ *	add all children of this Directory to the image.  Calling this on a root 
+ *	Directory will result in the entire FileSystem being written to the image.
+ */
+void Directory::writeToFile(ImageWriter& writer, std::uint32_t parent)
+{
+	// Nothing under here was touched, copy it through from the old image
+	if( image )
+	{
+		writer.copySubtree(*image, imageIndex, parent);
+		return;
+	}
+
+	// Add the Directory's node, its payload is its totals
+	char payload[DIRECTORY_PAYLOAD_SIZE];
+	ImageWriter::packTotals(totals, payload);
+	const auto index = writer.addNode(NODE_DIRECTORY, fileName, parent, 
+		payload, sizeof(payload), 0, generation);
+
+	// Recursively add all children, they follow this node in the table
 	for( auto& e : objects)
-		e->writeToFile(stream);
+		e->writeToFile(writer, index);
 
+	// Now the size of the subtree is known
+	writer.closeDirectory(index, objCount);
+}
 
-	// Write the Dir Closer as per spec (no extension)
-	stream << "end" + fileName;
+/**
+ *	\brief Flatten this Directory into an image, spreading the work across a 
+ *	pool of threads.
+ *	
+ *	\param writer The image to add this Directory to.
+ *	\param parent Index of the Directory that holds this one, or NO_PARENT
+ *	\param pool The threads to do the work on.
+ *	
+ *	Large subtrees are handed out to the pool, each one encoded straight into 
+ *	its own slice of the image.  The image comes out byte-for-byte the same as 
+ *	the single threaded writeToFile().
+ *	
+ *	Splitting costs an extra measure of every child plus the tasks, about 5 
+ *	to 8 percent of the encode when it all runs on one core.  So a subtree 
+ *	smaller than PARALLEL_WRITE_NODES, or a pool with fewer than two cores 
+ *	under it, takes the single threaded path.
+ */
+void Directory::writeToFile(ImageWriter& writer, std::uint32_t parent, 
+	ThreadPool& pool)
+{
+	const int cores = std::min(pool.getThreadCount(), 
+		ThreadPool::hardwareThreads());
+
+	// An untouched subtree is one copy, and one core cannot split anything
+	if( image || cores < 2 || totals.nodes < PARALLEL_WRITE_NODES )
+	{
+		writeToFile(writer, parent);
+		return;
+	}
+
+	std::deque<ImageWriter> slices;
+	splitToFile(writer, parent, pool, slices, 0);
 
-	// Fill the rest with nulls
-	for( int i = fileName.length(); i < 8; i++)
-		stream << '\0';
+	// Every slice has to be filled before the image can be saved
+	pool.wait();
+	for( auto& part : slices)
+		writer.joinSlice(part);
+}
+
+/**
+ *	\brief Add this Directory to an image and queue its children on a pool.
+ *	
+ *	\param writer The image to add this Directory to.
+ *	\param parent Index of the Directory that holds this one.
+ *	\param pool The threads to do the work on.
+ *	\param slices Holds the slices of the image handed out to the pool.
+ *	\param grain Roughly how many nodes each task should encode, 0 to work it 
+ *	out from the size of this Directory.
+ *	
+ *	Runs of small children are batched into one slice each, a child Directory 
+ *	bigger than the grain is split up the same way instead.
+ */
+void Directory::splitToFile(ImageWriter& writer, std::uint32_t parent, 
+	ThreadPool& pool, std::deque<ImageWriter>& slices, std::uint64_t grain)
+{
+	char payload[DIRECTORY_PAYLOAD_SIZE];
+	ImageWriter::packTotals(totals, payload);
+	const auto index = writer.addNode(NODE_DIRECTORY, fileName, parent, 
+		payload, sizeof(payload), 0, generation);
+
+	// Slices are carved in order, so the children need their sizes up front
+	std::vector<ImageSize> sizes(objects.size());
+	std::uint64_t total = 0;
+	for( std::size_t i = 0; i < objects.size(); i++)
+	{
+		objects[i]->measure(sizes[i]);
+		total += sizes[i].nodeCount;
+	}
+
+	// A few tasks per thread evens out the subtrees that take longer
+	if( grain == 0 )
+		grain = std::max<std::uint64_t>(total / (pool.getThreadCount() * 8), 
+			1024);
+
+	// Hand out the children in [first, last) as one slice
+	std::size_t first = 0;
+	ImageSize batch;
+	auto flush = [&]( std::size_t last )
+	{
+		if( first < last )
+		{
+			slices.push_back(writer.slice(batch));
+			ImageWriter* part = &slices.back();
+
+			pool.submit([this, part, first, last, index]
+			{
+				for( std::size_t i = first; i < last; i++)
+					objects[i]->writeToFile(*part, index);
+			});
+		}
+
+		first = last;
+		batch = ImageSize();
+	};
+
+	for( std::size_t i = 0; i < objects.size(); i++)
+	{
+		auto* d = objects[i]->getKind() == NODE_DIRECTORY ? 
+			static_cast<Directory*>(objects[i]) : nullptr;
+		if( d && !d->image && sizes[i].nodeCount > grain )
+		{
+			flush(i);
+			d->splitToFile(writer, index, pool, slices, grain);
+			first = i + 1;
+			continue;
+		}
+
+		batch.nodeCount += sizes[i].nodeCount;
+		batch.payloadSize += sizes[i].payloadSize;
+		if( batch.nodeCount >= grain )
+			flush(i + 1);
+	}
+	flush(objects.size());
+
+	// Everything under this Directory has had its room carved out already
+	writer.closeDirectory(index, objCount);
+}
+
+/**
+ *	\brief Add up how much room this Directory and everything in it takes in an 
+ *	image.
+ *	
+ *	\param size Accumulates the node count and payload bytes.
+ */
+void Directory::measure(ImageSize& size) const
+{
+	// An untouched subtree is measured straight from the old image
+	if( image )
+	{
+		ImageWriter::measureSubtree(*image, imageIndex, size);
+		return;
+	}
+
+	size.nodeCount++;
+	size.payloadSize += DIRECTORY_PAYLOAD_SIZE;
+	for( auto& e : objects)
+		e->measure(size);
+}
+
+/**
+ *	\brief Add this Directory and everything in it to a NodeTable.
+ *	
+ *	\param table The table to add rows to.
+ *	\param parent The row of the containing Directory.
+ *	
+ *	Children that are still in an image are read straight out of its node 
+ *	table, they are not inflated.
+ */
+void Directory::flatten(NodeTable& table, std::uint32_t parent) const
+{
+	const auto row = table.addRow(NODE_DIRECTORY, fileName, parent, 
+		generation, replaced, 0, this);
+
+	if( image )
+	{
+		table.addImageSubtree(image, imageIndex, row);
+		return;
+	}
+
+	for( auto& e : objects)
+		e->flatten(table, row);
+}
+
+/**
+ *	\brief Add this Directory and everything in it to another Directory's 
+ *	totals.
+ *	
+ *	\param totals The totals to add to.
+ */
+void Directory::tally(SubtreeTotals& totals) const
+{
+	totals.nodes++;
+	totals += this->totals;
 }
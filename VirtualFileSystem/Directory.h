@@ -8,10 +8,18 @@
 #define DIRECTORY_H
 
 #include <vector>
+#include <deque>
 #include <memory>
 #include <ostream>
 #include "FSObject.h"
 #include "ProgramFile.h"
+#include "ImageFile.h"
+#include "ImageFormat.h"
+#include "NameIndex.h"
+
+class ThreadPool;
+class NodeArena;
+class ImageTotals;
 
 class File;
 class TextFile;
@@ -20,14 +28,22 @@ class TextFile;
 *	\brief The core of the FileSystem is a complex structure of directories.
 *	Directories are recursive in nature, that is, a directory can contain more
 *	Directories.  All objects inside the Dir are stored in a vector of 
-*	shared_ptr's.
+*	pointers in the order they were added, the NodeArena the Dir was made in 
+*	owns them.  The children of each kind 
+*	can also be walked on their own, and are indexed by name so they can be 
+*	looked up without searching.
 */
 class Directory : public FSObject
 {
 public:
+	//! The fewest FSObjects a subtree needs before writing it is spread 
+	//!	across a pool, smaller ones cost more to split up than they save
+	static const std::uint64_t PARALLEL_WRITE_NODES = 64 * 1024;
+
 	/**
-	 *	\brief Create a brand new Directory and return a shared pointer to it.
+	 *	\brief Create a brand new Directory and return a pointer to it.
 	 *	
+	 *	\param arena The NodeArena that will own the Directory
 	 *	\param name The name of this Directory
 	 *	\param parent What Directory contains this Directory
 	 *	\param root Is this Directory located at the root level?
@@ -35,9 +51,9 @@ public:
 	 *	Create a new Directory for the File System.  If this is root, then it 
 	 *	needs to be flagged so that it knows it has no parent.
 	 *	
-	 *	\return A shared pointer to the new Directory
+	 *	\return A pointer to the new Directory, or null if the name is invalid
 	 */
-	static std::shared_ptr<Directory> CreateDirectory( std::string name, 
+	static Directory* CreateDirectory( NodeArena& arena, std::string name, 
 		Directory* parent, bool root = false);
 	
 	/**
@@ -53,6 +69,17 @@ public:
 	 */
 	static bool validName( std::string* name);
 
+	/**
+	 *	\brief Count how many Directories have inflated their children out of 
+	 *	an image.
+	 *	
+	 *	Inflating makes new FSObjects without any change being made to the 
+	 *	FileSystem, so a flat copy of it checks this to tell when it is behind.
+	 *	
+	 *	\return The count, which only ever goes up.
+	 */
+	static std::uint64_t getInflateCount();
+
 	/**
 	 *	\brief Constructor that should NOT be used.  Instead use the 
 	 *	makeDirectory() function.
@@ -62,7 +89,7 @@ public:
 	 *	\param root Is this Directory the root Directory?
 	 *	
 	 *	The makeDirectory() function should be used so that the new Directory 
-	 *	is allocated on the heap.  This is required to allow for the file system 
+	 *	is allocated in a NodeArena.  This is required to allow for the file system 
 	 *	to be serialized into a binary file.  If this constructor is used, the 
 	 *	data will likely not be saved.
 	 */
@@ -75,7 +102,54 @@ public:
 	 *	
 	 *	A directory can contain any number of other FSObjects.
 	 */
-	void addObject( std::shared_ptr<FSObject> obj);
+	void addObject( FSObject* obj);
+
+	/**
+	 *	\brief Add a batch of FSObjects to this directory.
+	 *	
+	 *	\param batch The FSObjects to add, in order.
+	 *	
+	 *	The same as calling addObject() on each one, but the totals of the 
+	 *	Directories above are only walked once for the whole batch.
+	 */
+	void addObjects( const std::vector<FSObject*>& batch);
+
+	/**
+	 *	\brief Leave this Directory's children in an indexed image until they 
+	 *	are first needed.
+	 *	
+	 *	\param image The mapped image that holds the children.
+	 *	\param totals The totals of the image's Directories, this Directory's 
+	 *	own totals are taken from it.
+	 *	\param index This Directory's entry in the image's node table.
+	 *	
+	 *	The children are inflated the first time they are looked up, listed, 
+	 *	or added to.  If they are never touched, writeToFile() copies the 
+	 *	whole subtree straight out of the image.
+	 */
+	void deferChildren( std::shared_ptr<ImageFile> image, 
+		std::shared_ptr<const ImageTotals> totals, std::uint32_t index);
+
+	/**
+	 *	\brief Get what is inside of this Directory, added up over its whole 
+	 *	subtree.
+	 *	
+	 *	\return The totals, kept up to date as FSObjects are added.
+	 */
+	const SubtreeTotals& getTotals() const;
+
+	/**
+	 *	\brief Change the totals of this Directory and every Directory above 
+	 *	it.
+	 *	
+	 *	\param added What was added to this Directory's subtree.
+	 *	\param removed What was taken out of it.
+	 *	
+	 *	Only the Directories between here and root are touched, so it costs 
+	 *	the depth of this Directory, not the size of the tree.
+	 */
+	void adjustTotals( const SubtreeTotals& added, 
+		const SubtreeTotals& removed );
 
 	/**
 	 *	\brief Return the parent of this Directory or null if this is the root 
@@ -86,6 +160,18 @@ public:
 	 */
 	Directory* getParent();
 
+	/**
+	 *	\brief Return the absolute path of this Directory, like "root/a/b".
+	 *	
+	 *	\return The path, worked out once when this Directory was made.
+	 */
+	const std::string& getPath() const;
+
+	/**
+	 *	\return The NodeArena this Directory and its children are made in.
+	 */
+	NodeArena& getArena() const;
+
 	/**
 	 *	\brief Print data for this Directory and print the data for all of 
 	 *	it's children.
@@ -94,18 +180,73 @@ public:
 	 *	anymore)
 	 */
 	void printData(int tabs) override;
+
+	/**
+	 *	\brief Print data for the children of this Directory that are part of 
+	 *	a view of the FileSystem.
+	 *	
+	 *	\param tabs How many tabs to include before the file data (not used 
+	 *	anymore)
+	 *	\param generation The view to list, a snapshot or LIVE_GENERATION
+	 */
+	void printData(int tabs, std::uint32_t generation);
 	
 	/**
-	 *	\brief Flatten this Directory and write it to a Binary File Stream.
+	 *	\brief Flatten this Directory and add it to an image.
 	 *	
-	 *	\param stream The Binary File Stream to write this Directory to.
+	 *	\param writer The image to add this Directory to.
+	 *	\param parent Index of the Directory that holds this one, or NO_PARENT
 	 *	
-	 *	This Directory will be written to the stream, which in turn will 
-	 *	recursively write all children of this Directory to the stream.  
+	 *	This Directory will be added to the image, which in turn will 
+	 *	recursively add all children of this Directory to the image.  
 	 *	Calling this on a root Directory will result in the entire FileSystem 
-	 *	being written to the file stream.
+	 *	being written to the image.
+	 */
+	void writeToFile(ImageWriter& writer, std::uint32_t parent) override;
+
+	/**
+	 *	\brief Flatten this Directory into an image, spreading the work across 
+	 *	a pool of threads.
+	 *	
+	 *	\param writer The image to add this Directory to.
+	 *	\param parent Index of the Directory that holds this one, or NO_PARENT
+	 *	\param pool The threads to do the work on.
+	 *	
+	 *	Large subtrees are handed out to the pool, each one encoded straight 
+	 *	into its own slice of the image.  The image comes out byte-for-byte the 
+	 *	same as the single threaded writeToFile(), which is what is used when 
+	 *	this Directory holds fewer than PARALLEL_WRITE_NODES FSObjects, or 
+	 *	there are not at least two cores to run the pool on.
+	 */
+	void writeToFile(ImageWriter& writer, std::uint32_t parent, 
+		ThreadPool& pool);
+
+	/**
+	 *	\brief Add up how much room this Directory and everything in it takes 
+	 *	in an image.
+	 *	
+	 *	\param size Accumulates the node count and payload bytes.
+	 */
+	void measure(ImageSize& size) const override;
+
+	/**
+	 *	\brief Add this Directory and everything in it to a NodeTable.
+	 *	
+	 *	\param table The table to add rows to.
+	 *	\param parent The row of the containing Directory.
+	 *	
+	 *	Children that are still in an image are read straight out of its node 
+	 *	table, they are not inflated.
+	 */
+	void flatten(NodeTable& table, std::uint32_t parent) const override;
+
+	/**
+	 *	\brief Add this Directory and everything in it to another 
+	 *	Directory's totals.
+	 *	
+	 *	\param totals The totals to add to.
 	 */
-	void writeToFile(std::ofstream& stream) override;
+	void tally(SubtreeTotals& totals) const override;
 	
 	/**
 	 *	\brief Print the directory to std out using the formating from the 
@@ -118,16 +259,14 @@ public:
 	 */
 	friend std::ostream& operator<<(std::ostream& os, const Directory& obj)
 	{
-		if( obj.parent )
-			os << *obj.parent << "/";
-
-		return os << obj.fileName;
+		return os << obj.path;
 	}
 
 	/**
 	 *	\brief Search this directory for a directory that has a matching name.
 	 *	
 	 *	\param name The name of the Directory to locate.
+	 *	\param generation Only look at children in this view of the FileSystem
 	 *	
 	 *	Only the first instance of a directory with a matching name is returned.  
 	 *	There can be multiple Directories with the same name, but only the 
@@ -135,12 +274,14 @@ public:
 	 *	
 	 *	\return A pointer to the Directory or null if not found.
 	 */
-	Directory* getDirectory(const std::string& name);
+	Directory* getDirectory(const std::string& name, 
+		std::uint32_t generation = LIVE_GENERATION);
 
 	/**
 	 *	\brief Search this directory for a TextFile that has a matching name.
 	 *	
 	 *	\param name The name of the TextFile to locate.
+	 *	\param generation Only look at children in this view of the FileSystem
 	 *	
 	 *	Only the first instance of a TextFile with a matching name is returned.  
 	 *	There can be multiple TextFile with the same name, but only the first 
@@ -148,12 +289,14 @@ public:
 	 *	
 	 *	\return A pointer to the TextFile or null if not found.
 	 */
-	TextFile* getTextfile(const std::string& name);
+	TextFile* getTextfile(const std::string& name, 
+		std::uint32_t generation = LIVE_GENERATION);
 
 	/**
 	 *	\brief Search this directory for a ProgramFile that has a matching name.
 	 *	
 	 *	\param name The name of the ProgramFile to locate.
+	 *	\param generation Only look at children in this view of the FileSystem
 	 *	
 	 *	Only the first instance of a ProgramFile with a matching name is 
 	 *	returned.  There can be multiple ProgramFile with the same name, but 
@@ -161,19 +304,118 @@ public:
 	 *	
 	 *	\return A pointer to the ProgramFile or null if not found.
 	 */
-	ProgramFile* getProgramfile(const std::string& name);
+	ProgramFile* getProgramfile(const std::string& name, 
+		std::uint32_t generation = LIVE_GENERATION);
+
+	/**
+	 *	\brief Change part of the body of a TextFile in this Directory.
+	 *	
+	 *	\param file The TextFile, as getTextfile() found it in the live view.
+	 *	\param offset The first byte to replace, past the end is the end.
+	 *	\param length How many bytes to replace, 0 to only insert.
+	 *	\param text What goes in their place.
+	 *	\param generation The generation the change is made in.
+	 *	
+	 *	A TextFile that a snapshot can see is not changed.  It is replaced by a 
+	 *	new TextFile made in this generation, which shares the old body rather 
+	 *	than copying it, and the snapshot keeps the old one.
+	 *	
+	 *	\return The TextFile that has the new body.
+	 */
+	TextFile* editTextfile(TextFile* file, std::uint64_t offset, 
+		std::uint64_t length, const std::string& text, 
+		std::uint32_t generation);
 
 private:
+	/**
+	 *	\brief Inflate the children that are still stored in the image, if 
+	 *	there are any.
+	 */
+	void inflate();
+
+	/**
+	 *	\brief Find the first child of a kind with a matching name.
+	 *	
+	 *	\param kind What kind of FSObject to look for.
+	 *	\param name The name to look for.
+	 *	\param extension The kind's extension, name can also be the child's 
+	 *	name with "." and this on the end.  0 if the kind has none.
+	 *	\param generation Only look at children in this view of the FileSystem
+	 *	
+	 *	The first lookup of a kind indexes every child of that kind, every 
+	 *	lookup after that is a hash lookup.
+	 *	
+	 *	\return The child, or null if there is not one.
+	 */
+	FSObject* findChild(NodeKind kind, const std::string& name, 
+		char extension, std::uint32_t generation);
+
+	/**
+	 *	\brief Put a child on the end of objects, without touching totals.
+	 *	
+	 *	\param obj The FSObject to add.
+	 */
+	void placeObject( FSObject* obj);
+
+	/**
+	 *	\brief Add this Directory to an image and queue its children on a pool.
+	 *	
+	 *	\param writer The image to add this Directory to.
+	 *	\param parent Index of the Directory that holds this one.
+	 *	\param pool The threads to do the work on.
+	 *	\param slices Holds the slices of the image handed out to the pool.
+	 *	\param grain Roughly how many nodes each task should encode, 0 to work 
+	 *	it out from the size of this Directory.
+	 *	
+	 *	Runs of small children are batched into one slice each, a child Directory 
+	 *	bigger than the grain is split up the same way instead.
+	 */
+	void splitToFile(ImageWriter& writer, std::uint32_t parent, 
+		ThreadPool& pool, std::deque<ImageWriter>& slices, std::uint64_t grain);
+
 	//! All child objects of this DIR are stored here
-	std::vector< std::shared_ptr<FSObject> > objects;
+	std::vector<FSObject*> objects;
+
+	//! Where the children of each NodeKind are in objects, in order
+	std::vector<std::uint32_t> kindPositions[3];
+
+	//! Where the first child of each kind and name is in objects, one index 
+	//!	for each NodeKind.  Each one is built the first time that kind is 
+	//!	looked up, and kept up to date by addObject() from then on.
+	NameIndex childIndex[3];
+
+	//! Which of childIndex have been built, one bit per NodeKind
+	std::uint8_t indexedKinds = 0;
 	
 	//! The Directory that THIS Dir is stored in
 	Directory* parent = nullptr;
+
+	//! Where this Dir's children are made, it owns all of them
+	NodeArena* arena = nullptr;
+	
+	//! The parent's path with this Dir's name on the end, so printing it 
+	//!	doesn't have to walk up to root every time
+	std::string path;
 	
 	//! Flag this Dir if it's the root
 	bool isRoot = false;
 
 	//! Number of kids this Dir has
 	int objCount = 0;
+
+	//! Everything in this Dir's subtree, added up
+	SubtreeTotals totals;
+
+	//! The image that still holds this Dir's kids, null once inflated
+	std::shared_ptr<ImageFile> image;
+
+	//! The totals of the Directories in image, for the stubs made from it
+	std::shared_ptr<const ImageTotals> imageTotals;
+
+	//! This Dir's entry in the image's node table
+	std::uint32_t imageIndex = 0;
+
+	//! How many Directories have been inflated, see getInflateCount()
+	static std::uint64_t inflateCount;
 };
 #endif
\ No newline at end of file
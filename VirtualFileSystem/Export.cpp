@@ -0,0 +1,244 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "Export.h"
+#include "HostFS.h"
+#include "NodeTable.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <sstream>
+#include <unordered_set>
+
+/**
+ *	\brief Write out the sidecar for a ProgramFile.
+ *	
+ *	\param fields The time, memory and the three IO fields of the program, as 
+ *	NodeTable::readProgram() gives them.
+ *	
+ *	\return One "key=value" line for each field.
+ */
+std::string Exporter::describeProgram( const std::int32_t (&fields)[5] )
+{
+	std::stringstream ss;
+	ss << "time=" << fields[0] << "\n" 
+		<< "memory=" << fields[1] << "\n" 
+		<< "needsIO=" << fields[2] << "\n" 
+		<< "timeToDoIO=" << fields[3] << "\n" 
+		<< "amountOfIO=" << fields[4] << "\n";
+
+	return ss.str();
+}
+
+/**
+ *	\brief Write everything inside of a Directory out to the host.
+ *	
+ *	\param table A flat copy of the FileSystem.
+ *	\param start The Directory's row.
+ *	\param generation Only write out this view of the FileSystem.
+ *	\param hostPath The host directory to write into, it is made if it is not 
+ *	there.
+ *	\param pool The threads to write the files on.
+ *	
+ *	Files that are already on the host are replaced.
+ *	
+ *	\return False if the host directory could not be made.
+ */
+bool Exporter::run( const NodeTable& table, std::uint32_t start, 
+	std::uint32_t generation, const std::string& hostPath, ThreadPool& pool )
+{
+	directoryCount = 0;
+	fileCount = 0;
+	byteCount = 0;
+	skippedCount = 0;
+
+	if( !makeHostDirectory(hostPath) )
+		return false;
+
+	plan(table, start, generation, hostPath);
+
+	const std::size_t chunks = chunkStarts.size() - 1;
+	std::atomic<std::size_t> next(0);
+	std::atomic<std::uint64_t> written(0);
+	std::atomic<std::uint64_t> bytes(0);
+
+	// Each worker keeps claiming the next chunk until they are all taken
+	const int tasks = static_cast<int>(std::min<std::size_t>(chunks, 
+		pool.getThreadCount()));
+	for( int i = 0; i < tasks; i++)
+	{
+		pool.submit([&]
+		{
+			std::string scratch;
+			for( std::size_t chunk = next++; chunk < chunks; chunk = next++)
+			{
+				std::uint64_t chunkBytes = 0;
+				std::uint64_t chunkFiles = 0;
+				for( std::size_t j = chunkStarts[chunk]; 
+					j < chunkStarts[chunk + 1]; j++)
+					chunkFiles += write(table, jobs[j], scratch, chunkBytes);
+
+				written += chunkFiles;
+				bytes += chunkBytes;
+			}
+		});
+	}
+
+	pool.wait();
+
+	fileCount = written;
+	byteCount = bytes;
+	skippedCount += jobs.size() - fileCount;
+
+	std::vector<Job>().swap(jobs);
+	std::vector<std::size_t>().swap(chunkStarts);
+	return true;
+}
+
+/**
+ *	\return How many host directories the last run() made.
+ */
+std::uint64_t Exporter::getDirectoryCount() const
+{
+	return directoryCount;
+}
+
+/**
+ *	\return How many host files the last run() wrote.
+ */
+std::uint64_t Exporter::getFileCount() const
+{
+	return fileCount;
+}
+
+/**
+ *	\return How many bytes the last run() wrote.
+ */
+std::uint64_t Exporter::getByteCount() const
+{
+	return byteCount;
+}
+
+/**
+ *	\return How many directories and files the last run() could not write, 
+ *	or left out because an earlier one had the same name.
+ */
+std::uint64_t Exporter::getSkippedCount() const
+{
+	return skippedCount;
+}
+
+/**
+ *	\brief Make the host directories and work out where every file goes.
+ *	
+ *	\param table A flat copy of the FileSystem.
+ *	\param start The row of the Directory being exported.
+ *	\param generation Only write out this view of the FileSystem.
+ *	\param hostPath The host directory start goes into.
+ *	
+ *	Rows are in pre-order, so every Directory is made before anything inside 
+ *	of it.  Only the first child of each kind and name is written, the same 
+ *	one that cd, cat and start would find, so no two jobs share a host path.
+ */
+void Exporter::plan( const NodeTable& table, std::uint32_t start, 
+	std::uint32_t generation, const std::string& hostPath )
+{
+	static const char* extensions[] = { "", ".t", ".p" };
+
+	const std::uint32_t last = start + 1 + table.getSubtreeSize(start);
+
+	// The host path of each Directory that was made, empty for the rest
+	std::vector<std::string> made(last - start);
+	made[0] = hostPath;
+
+	jobs.clear();
+	for( std::uint32_t row = start; row < last; row++)
+	{
+		if( table.getKind(row) != NODE_DIRECTORY || made[row - start].empty() )
+			continue;
+
+		std::unordered_set<std::uint64_t> taken[3];
+		for( std::uint32_t child = table.getFirstChild(row); 
+			child != NodeTable::NONE; child = table.getNextSibling(child))
+		{
+			if( !table.visibleIn(child, generation) )
+				continue;
+
+			const NodeKind kind = table.getKind(child);
+			const Name& name = table.getName(child);
+			if( !taken[kind].insert(name.key()).second )
+			{
+				skippedCount++;
+				continue;
+			}
+
+			std::string path = joinHostPath(made[row - start], name.str() + 
+				extensions[kind]);
+			if( kind != NODE_DIRECTORY )
+				jobs.push_back(Job{child, std::move(path)});
+			else if( makeHostDirectory(path) )
+			{
+				made[child - start] = std::move(path);
+				directoryCount++;
+			}
+			else
+				skippedCount++;
+		}
+	}
+
+	// Cut the jobs into chunks of about the same number of bytes
+	chunkStarts.assign(1, 0);
+	std::uint64_t chunkBytes = 0;
+	for( std::size_t j = 0; j < jobs.size(); j++)
+	{
+		chunkBytes += table.getSize(jobs[j].row);
+		if( chunkBytes >= CHUNK_BYTES || 
+			j + 1 - chunkStarts.back() >= CHUNK_FILES )
+		{
+			chunkStarts.push_back(j + 1);
+			chunkBytes = 0;
+		}
+	}
+	if( chunkStarts.back() != jobs.size() )
+		chunkStarts.push_back(jobs.size());
+}
+
+/**
+ *	\brief Write one file.
+ *	
+ *	\param table A flat copy of the FileSystem.
+ *	\param job The file.
+ *	\param scratch Holds a body that has to be put together first.
+ *	\param bytes Gets how many bytes were written.
+ *	
+ *	\return False if it could not be written.
+ */
+bool Exporter::write( const NodeTable& table, const Job& job, 
+	std::string& scratch, std::uint64_t& bytes )
+{
+	std::uint64_t length = 0;
+	const char* data = nullptr;
+
+	if( table.getKind(job.row) == NODE_TEXT )
+		data = table.readText(job.row, scratch, length);
+	else
+	{
+		std::int32_t fields[5];
+		table.readProgram(job.row, fields);
+		scratch = describeProgram(fields);
+		data = scratch.data();
+		length = scratch.length();
+	}
+
+	// A damaged body is left out rather than written short
+	if( !data || !writeHostFile(job.hostPath, data, 
+		static_cast<std::size_t>(length)) )
+		return false;
+
+	bytes += length;
+	return true;
+}
@@ -0,0 +1,144 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef EXPORT_H
+#define EXPORT_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class NodeTable;
+class ThreadPool;
+
+/**
+ *	\brief Writes a subtree of the FileSystem out to the host as real 
+ *	directories and files.
+ *	
+ *	Directories become host directories, each TextFile becomes a file called 
+ *	<name>.t holding its body, and each ProgramFile becomes a small sidecar 
+ *	file called <name>.p holding its data, see describeProgram().  The 
+ *	subtree is read out of a NodeTable, so a snapshot can be exported as well 
+ *	as the live FileSystem.
+ *	
+ *	The host directories are made first, in order, on the calling thread. 
+ *	Then the files are cut into chunks of about CHUNK_BYTES, which the 
+ *	workers of a ThreadPool claim one at a time.  Each body is handed to the 
+ *	host in one write, straight out of the image where it is stored plainly.
+ */
+class Exporter
+{
+public:
+	//! Roughly how many bytes of files a worker claims at a time
+	static const std::uint64_t CHUNK_BYTES = 4 * 1024 * 1024;
+
+	//! The most files a worker claims at a time
+	static const std::uint32_t CHUNK_FILES = 256;
+
+	/**
+	 *	\brief Write out the sidecar for a ProgramFile.
+	 *	
+	 *	\param fields The time, memory and the three IO fields of the 
+	 *	program, as NodeTable::readProgram() gives them.
+	 *	
+	 *	\return One "key=value" line for each field.
+	 */
+	static std::string describeProgram( const std::int32_t (&fields)[5] );
+
+	/**
+	 *	\brief Write everything inside of a Directory out to the host.
+	 *	
+	 *	\param table A flat copy of the FileSystem.
+	 *	\param start The Directory's row.
+	 *	\param generation Only write out this view of the FileSystem.
+	 *	\param hostPath The host directory to write into, it is made if it is 
+	 *	not there.
+	 *	\param pool The threads to write the files on.
+	 *	
+	 *	\return False if the host directory could not be made.
+	 */
+	bool run( const NodeTable& table, std::uint32_t start, 
+		std::uint32_t generation, const std::string& hostPath, 
+		ThreadPool& pool );
+
+	/**
+	 *	\return How many host directories the last run() made.
+	 */
+	std::uint64_t getDirectoryCount() const;
+
+	/**
+	 *	\return How many host files the last run() wrote.
+	 */
+	std::uint64_t getFileCount() const;
+
+	/**
+	 *	\return How many bytes the last run() wrote.
+	 */
+	std::uint64_t getByteCount() const;
+
+	/**
+	 *	\return How many directories and files the last run() could not 
+	 *	write, or left out because an earlier one had the same name.
+	 */
+	std::uint64_t getSkippedCount() const;
+
+private:
+	/**
+	 *	\brief A file that is waiting to be written.
+	 */
+	struct Job
+	{
+		//! The row of the TextFile or ProgramFile
+		std::uint32_t row;
+		//! Where it goes on the host
+		std::string hostPath;
+	};
+
+	/**
+	 *	\brief Make the host directories and work out where every file goes.
+	 *	
+	 *	\param table A flat copy of the FileSystem.
+	 *	\param start The row of the Directory being exported.
+	 *	\param generation Only write out this view of the FileSystem.
+	 *	\param hostPath The host directory start goes into.
+	 */
+	void plan( const NodeTable& table, std::uint32_t start, 
+		std::uint32_t generation, const std::string& hostPath );
+
+	/**
+	 *	\brief Write one file.
+	 *	
+	 *	\param table A flat copy of the FileSystem.
+	 *	\param job The file.
+	 *	\param scratch Holds a body that has to be put together first.
+	 *	\param bytes Gets how many bytes were written.
+	 *	
+	 *	\return False if it could not be written.
+	 */
+	static bool write( const NodeTable& table, const Job& job, 
+		std::string& scratch, std::uint64_t& bytes );
+
+	//! Every file to write, in the order they are in the tree
+	std::vector<Job> jobs;
+
+	//! Where each chunk of jobs starts, with one more at the end
+	std::vector<std::size_t> chunkStarts;
+
+	//! How many host directories the last run() made
+	std::uint64_t directoryCount = 0;
+
+	//! How many host files the last run() wrote
+	std::uint64_t fileCount = 0;
+
+	//! How many bytes the last run() wrote
+	std::uint64_t byteCount = 0;
+
+	//! How many directories and files were not written
+	std::uint64_t skippedCount = 0;
+};
+
+#endif
@@ -6,10 +6,29 @@
 
 #include "FSObject.h"
 
+/**
+ *	\brief	Tag the new FSObject with its kind, so it can be told apart from 
+ *	the others without RTTI.
+ *	
+ *	\param kind What kind of FSObject this is
+ */
+FSObject::FSObject( NodeKind kind)
+	: kind(kind)
+{
+}
+
+/**
+ *	\return What kind of FSObject this is.
+ */
+NodeKind FSObject::getKind() const
+{
+	return kind;
+}
+
 /**
  *	\return The name of this FileSystem Object
  */
-const std::string& FSObject::getFileName() const
+const Name& FSObject::getFileName() const
 {
 	return fileName;
 }
@@ -20,7 +39,66 @@ const std::string& FSObject::getFileName() const
  *	
  *	\param name The filename of this FSObject
  */
-void FSObject::setFileName(const std::string& name)
+void FSObject::setFileName(const Name& name)
 {
 	fileName = name;
 }
+
+/**
+ *	\return The generation this FSObject was made in, how many snapshots had 
+ *	been taken at the time.
+ */
+std::uint32_t FSObject::getGeneration() const
+{
+	return generation;
+}
+
+/**
+ *	\brief	Stamp this FSObject with the generation it was made in.
+ *	
+ *	\param generation How many snapshots had been taken when it was made
+ */
+void FSObject::setGeneration( std::uint32_t generation)
+{
+	this->generation = generation;
+}
+
+/**
+ *	\return The generation this FSObject was replaced in, LIVE_GENERATION if 
+ *	it never was.
+ */
+std::uint32_t FSObject::getReplaced() const
+{
+	return replaced;
+}
+
+/**
+ *	\brief	Mark this FSObject as replaced by a newer one, views from then on 
+ *	see the newer one instead.
+ *	
+ *	\param generation How many snapshots had been taken when it was replaced
+ */
+void FSObject::setReplaced( std::uint32_t generation)
+{
+	replaced = generation;
+}
+
+/**
+ *	\brief	Is this FSObject part of a view of the FileSystem?
+ *	
+ *	\param generation The generation of the view, a snapshot's number or 
+ *	LIVE_GENERATION
+ *	
+ *	Nothing is ever removed, so a snapshot is everything that was made before 
+ *	it was taken.  An edit that a snapshot would see replaces the FSObject 
+ *	instead of changing it, the old one stays in every view from before the 
+ *	edit.
+ *	
+ *	\return True if this FSObject already existed in that view, and had not 
+ *	been replaced yet.
+ */
+bool FSObject::visibleIn( std::uint32_t generation) const
+{
+	return this->generation <= generation && 
+		(replaced == LIVE_GENERATION || generation < replaced);
+}
@@ -8,7 +8,49 @@
 #define FSOBJECT_H
 
 #include <string>
-#include <fstream>
+#include <cstdint>
+#include "ImageFormat.h"
+#include "Name.h"
+
+class ImageWriter;
+class NodeTable;
+struct ImageSize;
+
+//! The generation the live FileSystem is viewed through, it sees everything
+const std::uint32_t LIVE_GENERATION = 0xFFFFFFFF;
+
+/**
+ *	\brief What is inside of a Directory, added up over its whole subtree.
+ */
+struct SubtreeTotals
+{
+	//! Number of FSObjects, at any depth
+	std::uint64_t nodes = 0;
+	//! Bytes in the bodies of the TextFiles
+	std::uint64_t textBytes = 0;
+	//! Number of ProgramFiles
+	std::uint64_t programs = 0;
+	//! Memory the ProgramFiles say they need to run
+	std::int64_t programMemory = 0;
+
+	SubtreeTotals& operator+=( const SubtreeTotals& other )
+	{
+		nodes += other.nodes;
+		textBytes += other.textBytes;
+		programs += other.programs;
+		programMemory += other.programMemory;
+		return *this;
+	}
+
+	SubtreeTotals& operator-=( const SubtreeTotals& other )
+	{
+		nodes -= other.nodes;
+		textBytes -= other.textBytes;
+		programs -= other.programs;
+		programMemory -= other.programMemory;
+		return *this;
+	}
+};
 
 /**
  *	\brief Abstract class the is the super class of all File System objects, 
@@ -17,12 +59,27 @@
 class FSObject
 {
 public:
-	FSObject() = default;
+	/**
+	 *	\brief	Tag the new FSObject with its kind, so it can be told apart 
+	 *	from the others without RTTI.
+	 *	\param kind What kind of FSObject this is
+	 */
+	explicit FSObject( NodeKind kind);
+
+	/**
+	 *	\brief	FSObjects are destroyed through this base by their NodeArena.
+	 */
+	virtual ~FSObject() = default;
+
+	/**
+	 *	\return What kind of FSObject this is.
+	 */
+	NodeKind getKind() const;
 
 	/**
 	 *	\return The name of this FileSystem Object
 	 */
-	const std::string& getFileName() const;
+	const Name& getFileName() const;
 	
 	/**
 	 *	\brief	Set the name of the file for the system.  This will be used
@@ -30,7 +87,42 @@ public:
 	 *	
 	 *	\param name The filename of this FSObject
 	 */
-	void setFileName( const std::string& name);
+	void setFileName( const Name& name);
+
+	/**
+	 *	\return The generation this FSObject was made in, how many snapshots 
+	 *	had been taken at the time.
+	 */
+	std::uint32_t getGeneration() const;
+
+	/**
+	 *	\brief	Stamp this FSObject with the generation it was made in.
+	 *	\param generation How many snapshots had been taken when it was made
+	 */
+	void setGeneration( std::uint32_t generation);
+
+	/**
+	 *	\return The generation this FSObject was replaced in, LIVE_GENERATION 
+	 *	if it never was.
+	 */
+	std::uint32_t getReplaced() const;
+
+	/**
+	 *	\brief	Mark this FSObject as replaced by a newer one, views from then 
+	 *	on see the newer one instead.
+	 *	\param generation How many snapshots had been taken when it was 
+	 *	replaced
+	 */
+	void setReplaced( std::uint32_t generation);
+
+	/**
+	 *	\brief	Is this FSObject part of a view of the FileSystem?
+	 *	\param generation The generation of the view, a snapshot's number or 
+	 *	LIVE_GENERATION
+	 *	\return True if this FSObject already existed in that view, and had 
+	 *	not been replaced yet.
+	 */
+	bool visibleIn( std::uint32_t generation) const;
 
 	/**
 	 *	\brief	All FSObjects must have a way of displaying their internal data.
@@ -46,16 +138,55 @@ public:
 	 *	\brief All FSObjects need to have a way of writing them to a binary 
 	 *	File.
 	 *	
-	 *	\param stream Where to write the FSObject to.
+	 *	\param writer The image that the FSObject is added to.
+	 *	\param parent Index of the containing Directory in the image.
 	 *	
 	 *	All FSObjects must implement this function.  The point is to have a 
 	 *	recursive way of serializing the entire FileSystem.
 	 */
-	virtual void writeToFile( std::ofstream& stream ) = 0;
+	virtual void writeToFile( ImageWriter& writer, std::uint32_t parent ) = 0;
+
+	/**
+	 *	\brief Add up how much room this FSObject takes in an image.
+	 *	
+	 *	\param size Accumulates the node count and payload bytes.
+	 *	
+	 *	The image is sized exactly from this before writeToFile() fills it, 
+	 *	so every FSObject must count precisely what it writes.
+	 */
+	virtual void measure( ImageSize& size ) const = 0;
+
+	/**
+	 *	\brief Add this FSObject, and everything in it, to a NodeTable.
+	 *	
+	 *	\param table The table to add rows to.
+	 *	\param parent The row of the containing Directory, NodeTable::NONE 
+	 *	for root.
+	 */
+	virtual void flatten( NodeTable& table, std::uint32_t parent ) const = 0;
+
+	/**
+	 *	\brief Add this FSObject, and everything in it, to a Directory's 
+	 *	totals.
+	 *	
+	 *	\param totals The totals to add to.
+	 */
+	virtual void tally( SubtreeTotals& totals ) const = 0;
 
 protected:
 	//! The name of this FSObject
-	std::string fileName;
+	Name fileName;
+
+	//! How many snapshots had been taken when this FSObject was made
+	std::uint32_t generation = 0;
+
+	//! The generation this FSObject was replaced in, LIVE_GENERATION if it 
+	//!	never was
+	std::uint32_t replaced = LIVE_GENERATION;
+
+private:
+	//! What kind of FSObject this is, set once when it is made
+	NodeKind kind;
 };
 
 #endif
\ No newline at end of file
@@ -4,4 +4,12 @@
  *	4/19/2018
 */
 
-#include "File.h"
\ No newline at end of file
+#include "File.h"
+
+/**
+ *	\param kind What kind of File this is
+ */
+File::File( NodeKind kind )
+	: FSObject(kind)
+{
+}
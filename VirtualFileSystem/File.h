@@ -16,6 +16,11 @@
 class File : public FSObject
 {
 public:
+	/**
+	 *	\param kind What kind of File this is
+	 */
+	explicit File( NodeKind kind );
+
 	virtual ~File() = default;
 };
 
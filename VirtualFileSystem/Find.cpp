@@ -0,0 +1,219 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "Find.h"
+#include "NodeTable.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+/**
+ *	\brief Set up a search.
+ *	
+ *	\param pattern What names have to look like, "*" matches any run of 
+ *	characters and "?" matches any one.
+ *	\param kinds Which NodeKinds to look for, one bit each.
+ */
+Finder::Finder( const std::string& pattern, std::uint8_t kinds )
+	: pattern(pattern), kinds(kinds)
+{
+}
+
+/**
+ *	\brief Does a name match a pattern?
+ *	
+ *	\param pattern The pattern, "*" and "?" are wildcards.
+ *	\param name The name to check.
+ *	\param length How many characters are in the name.
+ *	
+ *	\return True if the whole name matches.
+ */
+bool Finder::match( const std::string& pattern, const char* name, 
+	std::size_t length )
+{
+	std::size_t p = 0;
+	std::size_t n = 0;
+
+	// Where to go back to when the text after the last "*" stops matching
+	std::size_t star = std::string::npos;
+	std::size_t resume = 0;
+
+	while( n < length )
+	{
+		if( p < pattern.size() && (pattern[p] == '?' || pattern[p] == name[n]) )
+		{
+			p++;
+			n++;
+		}
+		else if( p < pattern.size() && pattern[p] == '*' )
+		{
+			star = p++;
+			resume = n;
+		}
+		else if( star != std::string::npos )
+		{
+			// Let the last "*" swallow one more character and try again
+			p = star + 1;
+			n = ++resume;
+		}
+		else
+			return false;
+	}
+
+	// Anything left in the pattern has to be able to match nothing
+	while( p < pattern.size() && pattern[p] == '*' )
+		p++;
+
+	return p == pattern.size();
+}
+
+/**
+ *	\brief Search everything inside of a Directory.
+ *	
+ *	\param table A flat copy of the FileSystem.
+ *	\param start The Directory's row.
+ *	\param generation Only search this view of the FileSystem.
+ *	\param pool The threads to search on.
+ *	\param out Where to print the path of each match, in the order they are 
+ *	in the tree.  Each chunk is printed as soon as it and the chunks before it 
+ *	are done.
+ *	
+ *	\return How many rows were searched.
+ */
+std::uint64_t Finder::run( const NodeTable& table, std::uint32_t start, 
+	std::uint32_t generation, ThreadPool& pool, std::ostream& out )
+{
+	// Everything inside of start is the run of rows right after it
+	const std::uint32_t first = start + 1;
+	const std::uint32_t last = first + table.getSubtreeSize(start);
+	const std::uint32_t chunks = (last - first + CHUNK_ROWS - 1) / CHUNK_ROWS;
+
+	std::vector<std::string> found(chunks);
+	std::vector<bool> done(chunks, false);
+	std::mutex lock;
+	std::condition_variable finished;
+
+	std::atomic<std::uint32_t> next(0);
+	std::atomic<std::uint64_t> matches(0);
+
+	// Each worker keeps claiming the next chunk until they are all taken
+	const int tasks = std::min<std::uint32_t>(chunks, pool.getThreadCount());
+	for( int i = 0; i < tasks; i++)
+	{
+		pool.submit([&]
+		{
+			for( std::uint32_t chunk = next++; chunk < chunks; chunk = next++)
+			{
+				const std::uint32_t from = first + chunk * CHUNK_ROWS;
+				const std::uint32_t to = std::min(last, from + CHUNK_ROWS);
+				matches += search(table, from, to, generation, found[chunk]);
+
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					done[chunk] = true;
+				}
+				finished.notify_all();
+			}
+		});
+	}
+
+	// Print the chunks in order, while the later ones are still running
+	for( std::uint32_t chunk = 0; chunk < chunks; chunk++)
+	{
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			finished.wait(guard, [&]{ return done[chunk]; });
+		}
+
+		if( !found[chunk].empty() )
+		{
+			out << found[chunk];
+			out.flush();
+			std::string().swap(found[chunk]);
+		}
+	}
+
+	pool.wait();
+
+	matchCount = matches;
+	return last - first;
+}
+
+/**
+ *	\brief Set what goes in front of every path printed.
+ *	
+ *	\param prefix Like "@before/" when a snapshot is being viewed, so the 
+ *	paths look like the ones pwd prints.  Empty by default.
+ */
+void Finder::setPrefix( const std::string& prefix )
+{
+	this->prefix = prefix;
+}
+
+/**
+ *	\return How many matches the last run() found.
+ */
+std::uint64_t Finder::getMatchCount() const
+{
+	return matchCount;
+}
+
+/**
+ *	\brief Search a chunk of rows.
+ *	
+ *	\param table A flat copy of the FileSystem.
+ *	\param first The first row to search.
+ *	\param last One past the last row to search.
+ *	\param generation Only search this view of the FileSystem.
+ *	\param out Gets the path of each match, one per line.
+ *	
+ *	A name matches with or without its extension, so "notes" finds notes.t.
+ *	
+ *	\return How many matches were found.
+ */
+std::uint64_t Finder::search( const NodeTable& table, std::uint32_t first, 
+	std::uint32_t last, std::uint32_t generation, std::string& out ) const
+{
+	static const char extensions[] = { 0, 't', 'p' };
+
+	std::uint64_t found = 0;
+	char name[Name::SIZE + 2];
+
+	for( std::uint32_t row = first; row < last; row++)
+	{
+		// Anything inside of a newer Directory is newer too, so it is left 
+		//	out as well
+		const NodeKind kind = table.getKind(row);
+		if( !(kinds & (1 << kind)) || !table.visibleIn(row, generation) )
+			continue;
+
+		const Name& packed = table.getName(row);
+		std::size_t length = packed.length();
+		std::copy(packed.data(), packed.data() + length, name);
+
+		bool matched = match(pattern, name, length);
+		if( !matched && extensions[kind] )
+		{
+			name[length++] = '.';
+			name[length++] = extensions[kind];
+			matched = match(pattern, name, length);
+		}
+
+		if( matched )
+		{
+			out += prefix;
+			table.appendPath(row, out);
+			out += '\n';
+			found++;
+		}
+	}
+
+	return found;
+}
@@ -0,0 +1,111 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef FIND_H
+#define FIND_H
+
+#include <string>
+#include <ostream>
+#include <cstdint>
+#include "ImageFormat.h"
+
+class NodeTable;
+class ThreadPool;
+
+/**
+ *	\brief Searches a whole subtree for FSObjects whose names match a 
+ *	pattern, spread across a ThreadPool.
+ *	
+ *	The subtree is a run of rows in a NodeTable, so it is cut into chunks that 
+ *	the workers claim one at a time until there are none left.  A worker that 
+ *	gets through its chunks quickly just takes more, so a lopsided tree keeps 
+ *	every worker busy without any one of them owning a branch.
+ */
+class Finder
+{
+public:
+	//! How many rows a worker claims at a time
+	static const std::uint32_t CHUNK_ROWS = 16 * 1024;
+
+	/**
+	 *	\brief Set up a search.
+	 *	
+	 *	\param pattern What names have to look like, "*" matches any run of 
+	 *	characters and "?" matches any one.
+	 *	\param kinds Which NodeKinds to look for, one bit each.
+	 */
+	Finder( const std::string& pattern, std::uint8_t kinds );
+
+	/**
+	 *	\brief Does a name match a pattern?
+	 *	
+	 *	\param pattern The pattern, "*" and "?" are wildcards.
+	 *	\param name The name to check.
+	 *	\param length How many characters are in the name.
+	 *	
+	 *	\return True if the whole name matches.
+	 */
+	static bool match( const std::string& pattern, const char* name, 
+		std::size_t length );
+
+	/**
+	 *	\brief Search everything inside of a Directory.
+	 *	
+	 *	\param table A flat copy of the FileSystem.
+	 *	\param start The Directory's row.
+	 *	\param generation Only search this view of the FileSystem.
+	 *	\param pool The threads to search on.
+	 *	\param out Where to print the path of each match, in the order they 
+	 *	are in the tree.  Each chunk is printed as soon as it and the chunks 
+	 *	before it are done.
+	 *	
+	 *	\return How many rows were searched.
+	 */
+	std::uint64_t run( const NodeTable& table, std::uint32_t start, 
+		std::uint32_t generation, ThreadPool& pool, std::ostream& out );
+
+	/**
+	 *	\brief Set what goes in front of every path printed.
+	 *	
+	 *	\param prefix Like "@before/" when a snapshot is being viewed, so 
+	 *	the paths look like the ones pwd prints.  Empty by default.
+	 */
+	void setPrefix( const std::string& prefix );
+
+	/**
+	 *	\return How many matches the last run() found.
+	 */
+	std::uint64_t getMatchCount() const;
+
+private:
+	/**
+	 *	\brief Search a chunk of rows.
+	 *	
+	 *	\param table A flat copy of the FileSystem.
+	 *	\param first The first row to search.
+	 *	\param last One past the last row to search.
+	 *	\param generation Only search this view of the FileSystem.
+	 *	\param out Gets the path of each match, one per line.
+	 *	
+	 *	\return How many matches were found.
+	 */
+	std::uint64_t search( const NodeTable& table, std::uint32_t first, 
+		std::uint32_t last, std::uint32_t generation, std::string& out ) const;
+
+	//! What names have to look like
+	std::string pattern;
+
+	//! Which NodeKinds to look for, one bit each
+	std::uint8_t kinds;
+
+	//! What goes in front of every path printed
+	std::string prefix;
+
+	//! How many matches the last run() found
+	std::uint64_t matchCount = 0;
+};
+
+#endif
@@ -0,0 +1,256 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "Grep.h"
+#include "NodeTable.h"
+#include "TextSearch.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+
+// std::min takes CHUNK_BYTES by reference, so it needs to be defined somewhere
+const std::uint64_t Grepper::CHUNK_BYTES;
+
+/**
+ *	\brief Set up a search.
+ *	
+ *	\param literal The string to look for, exactly as it is.
+ */
+Grepper::Grepper( const std::string& literal )
+	: literal(literal)
+{
+}
+
+/**
+ *	\brief Search every TextFile inside of a Directory.
+ *	
+ *	\param table A flat copy of the FileSystem, with its text loaded.
+ *	\param start The Directory's row.
+ *	\param generation Only search this view of the FileSystem.
+ *	\param pool The threads to search on.
+ *	\param out Where to print each line that has the string, after the path 
+ *	of its file.  Lines are printed in the order they are in the tree, each 
+ *	chunk as soon as it and the chunks before it are done.
+ *	
+ *	\return How many bytes of text were searched.
+ */
+std::uint64_t Grepper::run( const NodeTable& table, std::uint32_t start, 
+	std::uint32_t generation, ThreadPool& pool, std::ostream& out )
+{
+	const std::uint32_t first = start + 1;
+	const std::uint32_t last = first + table.getSubtreeSize(start);
+	const std::vector<std::uint32_t> bounds = split(table, first, last);
+	const std::uint32_t chunks = static_cast<std::uint32_t>(bounds.size() - 1);
+
+	std::vector<std::string> found(chunks);
+	std::vector<bool> done(chunks, false);
+	std::mutex lock;
+	std::condition_variable finished;
+
+	std::atomic<std::uint32_t> next(0);
+	std::atomic<std::uint64_t> matches(0);
+	std::atomic<std::uint64_t> files(0);
+
+	// Each worker keeps claiming the next chunk until they are all taken
+	const int tasks = std::min<std::uint32_t>(chunks, pool.getThreadCount());
+	for( int i = 0; i < tasks; i++)
+	{
+		pool.submit([&]
+		{
+			for( std::uint32_t chunk = next++; chunk < chunks; chunk = next++)
+			{
+				std::uint64_t chunkFiles = 0;
+				matches += search(table, bounds[chunk], bounds[chunk + 1], 
+					generation, found[chunk], chunkFiles);
+				files += chunkFiles;
+
+				{
+					std::lock_guard<std::mutex> guard(lock);
+					done[chunk] = true;
+				}
+				finished.notify_all();
+			}
+		});
+	}
+
+	// Print the chunks in order, while the later ones are still running
+	for( std::uint32_t chunk = 0; chunk < chunks; chunk++)
+	{
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			finished.wait(guard, [&]{ return done[chunk]; });
+		}
+
+		if( !found[chunk].empty() )
+		{
+			out << found[chunk];
+			out.flush();
+			std::string().swap(found[chunk]);
+		}
+	}
+
+	pool.wait();
+
+	matchCount = matches;
+	fileCount = files;
+
+	std::uint64_t length = 0;
+	return first == last ? 0 : table.getText(last - 1, length) + length - 
+		table.getText(first, length);
+}
+
+/**
+ *	\brief Set what goes in front of every path printed.
+ *	
+ *	\param prefix Like "@before/" when a snapshot is being viewed, so the 
+ *	paths look like the ones pwd prints.  Empty by default.
+ */
+void Grepper::setPrefix( const std::string& prefix )
+{
+	this->prefix = prefix;
+}
+
+/**
+ *	\return How many lines the last run() printed.
+ */
+std::uint64_t Grepper::getMatchCount() const
+{
+	return matchCount;
+}
+
+/**
+ *	\return How many TextFiles the last run() found the string in.
+ */
+std::uint64_t Grepper::getFileCount() const
+{
+	return fileCount;
+}
+
+/**
+ *	\brief Cut a run of rows into chunks of about CHUNK_BYTES of text.
+ *	
+ *	\param table A flat copy of the FileSystem, with its text loaded.
+ *	\param first The first row.
+ *	\param last One past the last row.
+ *	
+ *	A file is never split, so a chunk can go over by one file.
+ *	
+ *	\return The first row of each chunk, and then last.
+ */
+std::vector<std::uint32_t> Grepper::split( const NodeTable& table, 
+	std::uint32_t first, std::uint32_t last )
+{
+	std::vector<std::uint32_t> bounds;
+	if( first == last )
+	{
+		bounds.push_back(last);
+		return bounds;
+	}
+
+	std::uint64_t length = 0;
+	const char* chunkStart = table.getText(first, length);
+	bounds.push_back(first);
+
+	for( std::uint32_t row = first + 1; row < last; row++)
+	{
+		const char* body = table.getText(row, length);
+		if( static_cast<std::uint64_t>(body - chunkStart) >= CHUNK_BYTES )
+		{
+			bounds.push_back(row);
+			chunkStart = body;
+		}
+	}
+
+	bounds.push_back(last);
+	return bounds;
+}
+
+/**
+ *	\brief Search a chunk of rows.
+ *	
+ *	\param table A flat copy of the FileSystem, with its text loaded.
+ *	\param first The first row to search.
+ *	\param last One past the last row to search.
+ *	\param generation Only search this view of the FileSystem.
+ *	\param out Gets each matching line, after the path of its file.
+ *	\param files Counts the TextFiles the string was found in.
+ *	
+ *	The bodies of the chunk are searched as one block, a hit that runs from 
+ *	one body into the next is not a match.
+ *	
+ *	\return How many lines were found.
+ */
+std::uint64_t Grepper::search( const NodeTable& table, std::uint32_t first, 
+	std::uint32_t last, std::uint32_t generation, std::string& out, 
+	std::uint64_t& files ) const
+{
+	std::uint64_t length = 0;
+	const char* at = table.getText(first, length);
+	std::uint64_t lastLength = 0;
+	const char* end = table.getText(last - 1, lastLength) + lastLength;
+
+	std::uint64_t found = 0;
+	std::uint32_t row = first;
+	const char* body = at;
+	const char* bodyEnd = body + length;
+	std::uint32_t counted = NodeTable::NONE;
+
+	while( at < end )
+	{
+		const char* hit = findText(at, end - at, literal.data(), 
+			literal.size());
+		if( !hit )
+			break;
+
+		// Catch up to the body the hit is in, Directories and ProgramFiles 
+		//	have empty bodies so they are passed right over
+		while( hit >= bodyEnd )
+		{
+			body = table.getText(++row, length);
+			bodyEnd = body + length;
+		}
+
+		// Anything inside of a newer Directory is newer too, so it is left 
+		//	out as well
+		if( hit + literal.size() > bodyEnd || 
+			!table.visibleIn(row, generation) )
+		{
+			at = bodyEnd;
+			continue;
+		}
+
+		const char* lineStart = hit;
+		while( lineStart > body && lineStart[-1] != '\n' )
+			lineStart--;
+
+		const char* lineEnd = static_cast<const char*>(std::memchr(
+			hit + literal.size(), '\n', bodyEnd - hit - literal.size()));
+		if( !lineEnd )
+			lineEnd = bodyEnd;
+
+		out += prefix;
+		table.appendPath(row, out);
+		out += ": ";
+		out.append(lineStart, lineEnd);
+		out += '\n';
+		found++;
+
+		if( counted != row )
+		{
+			counted = row;
+			files++;
+		}
+
+		// The rest of the line has already been printed
+		at = lineEnd;
+	}
+
+	return found;
+}
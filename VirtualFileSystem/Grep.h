@@ -0,0 +1,117 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef GREP_H
+#define GREP_H
+
+#include <string>
+#include <ostream>
+#include <vector>
+#include <cstdint>
+
+class NodeTable;
+class ThreadPool;
+
+/**
+ *	\brief Searches the bodies of every TextFile in a subtree for a string, 
+ *	spread across a ThreadPool.
+ *	
+ *	A NodeTable keeps the bodies of a subtree one after another in its text 
+ *	blob, so the subtree is cut into chunks of whole files with about the same 
+ *	number of bytes each.  Workers claim the chunks one at a time and search 
+ *	each one with a single findText() pass, only stopping to work out which 
+ *	file a hit is in.
+ */
+class Grepper
+{
+public:
+	//! About how many bytes of text a worker claims at a time
+	static const std::uint64_t CHUNK_BYTES = 1024 * 1024;
+
+	/**
+	 *	\brief Set up a search.
+	 *	
+	 *	\param literal The string to look for, exactly as it is.
+	 */
+	explicit Grepper( const std::string& literal );
+
+	/**
+	 *	\brief Search every TextFile inside of a Directory.
+	 *	
+	 *	\param table A flat copy of the FileSystem, with its text loaded.
+	 *	\param start The Directory's row.
+	 *	\param generation Only search this view of the FileSystem.
+	 *	\param pool The threads to search on.
+	 *	\param out Where to print each line that has the string, after the 
+	 *	path of its file.  Lines are printed in the order they are in the tree, 
+	 *	each chunk as soon as it and the chunks before it are done.
+	 *	
+	 *	\return How many bytes of text were searched.
+	 */
+	std::uint64_t run( const NodeTable& table, std::uint32_t start, 
+		std::uint32_t generation, ThreadPool& pool, std::ostream& out );
+
+	/**
+	 *	\brief Set what goes in front of every path printed.
+	 *	
+	 *	\param prefix Like "@before/" when a snapshot is being viewed, so 
+	 *	the paths look like the ones pwd prints.  Empty by default.
+	 */
+	void setPrefix( const std::string& prefix );
+
+	/**
+	 *	\return How many lines the last run() printed.
+	 */
+	std::uint64_t getMatchCount() const;
+
+	/**
+	 *	\return How many TextFiles the last run() found the string in.
+	 */
+	std::uint64_t getFileCount() const;
+
+private:
+	/**
+	 *	\brief Cut a run of rows into chunks of about CHUNK_BYTES of text.
+	 *	
+	 *	\param table A flat copy of the FileSystem, with its text loaded.
+	 *	\param first The first row.
+	 *	\param last One past the last row.
+	 *	
+	 *	\return The first row of each chunk, and then last.
+	 */
+	static std::vector<std::uint32_t> split( const NodeTable& table, 
+		std::uint32_t first, std::uint32_t last );
+
+	/**
+	 *	\brief Search a chunk of rows.
+	 *	
+	 *	\param table A flat copy of the FileSystem, with its text loaded.
+	 *	\param first The first row to search.
+	 *	\param last One past the last row to search.
+	 *	\param generation Only search this view of the FileSystem.
+	 *	\param out Gets each matching line, after the path of its file.
+	 *	\param files Counts the TextFiles the string was found in.
+	 *	
+	 *	\return How many lines were found.
+	 */
+	std::uint64_t search( const NodeTable& table, std::uint32_t first, 
+		std::uint32_t last, std::uint32_t generation, std::string& out, 
+		std::uint64_t& files ) const;
+
+	//! The string to look for
+	std::string literal;
+
+	//! What goes in front of every path printed
+	std::string prefix;
+
+	//! How many lines the last run() printed
+	std::uint64_t matchCount = 0;
+
+	//! How many TextFiles the last run() found the string in
+	std::uint64_t fileCount = 0;
+};
+
+#endif
@@ -0,0 +1,335 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "HostFS.h"
+
+#include <algorithm>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#endif
+
+/**
+ *	\brief Put a name on the end of a host path.
+ *	
+ *	\param path The directory.
+ *	\param name What is in it.
+ *	
+ *	\return The path of name.
+ */
+std::string joinHostPath( const std::string& path, const std::string& name )
+{
+	if( path.empty() || path.back() == '/' || path.back() == '\\' )
+		return path + name;
+
+	return path + '/' + name;
+}
+
+#ifdef _WIN32
+/**
+ *	\brief Is there a directory at a host path?
+ *	
+ *	\param path The path to check.
+ *	
+ *	\return True if it is a directory, following links.
+ */
+bool isHostDirectory( const std::string& path )
+{
+	const DWORD attributes = GetFileAttributesA(path.c_str());
+	return attributes != INVALID_FILE_ATTRIBUTES && 
+		(attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+/**
+ *	\brief List the files and directories in a host directory.
+ *	
+ *	\param path The directory.
+ *	\param entries Set to what is in it, sorted by name.
+ *	
+ *	\return False if the directory could not be read.
+ */
+bool listHostDirectory( const std::string& path, 
+	std::vector<HostEntry>& entries )
+{
+	entries.clear();
+
+	WIN32_FIND_DATAA found;
+	const HANDLE search = FindFirstFileA(joinHostPath(path, "*").c_str(), 
+		&found);
+	if( search == INVALID_HANDLE_VALUE )
+		return false;
+
+	do
+	{
+		const std::string name = found.cFileName;
+		if( name == "." || name == ".." || 
+			(found.dwFileAttributes & (FILE_ATTRIBUTE_REPARSE_POINT | 
+				FILE_ATTRIBUTE_DEVICE)) )
+			continue;
+
+		entries.push_back(HostEntry{name, 
+			(found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0});
+	} while( FindNextFileA(search, &found) );
+
+	FindClose(search);
+
+	std::sort(entries.begin(), entries.end(), 
+		[]( const HostEntry& a, const HostEntry& b ){ return a.name < b.name; });
+	return true;
+}
+
+/**
+ *	\brief Read a whole host file, if it is not too large.
+ *	
+ *	\param path The file.
+ *	\param limit The most bytes the file can have.
+ *	\param contents Set to the bytes of the file.
+ *	
+ *	\return How it went, contents is only set for HOST_READ_OK.
+ */
+HostRead readHostFile( const std::string& path, std::size_t limit, 
+	std::string& contents )
+{
+	const int fd = _open(path.c_str(), _O_RDONLY | _O_BINARY);
+	if( fd < 0 )
+		return HOST_READ_FAILED;
+
+	struct _stat64 info = {};
+	if( _fstat64(fd, &info) != 0 || !(info.st_mode & _S_IFREG) )
+	{
+		_close(fd);
+		return HOST_READ_FAILED;
+	}
+	if( static_cast<std::uint64_t>(info.st_size) > limit )
+	{
+		_close(fd);
+		return HOST_READ_TOO_LARGE;
+	}
+
+	// Read straight into the string, it is sized to the file up front
+	contents.resize(static_cast<std::size_t>(info.st_size));
+	std::size_t total = 0;
+	while( total < contents.size() )
+	{
+		const int got = _read(fd, &contents[total], 
+			static_cast<unsigned>(contents.size() - total));
+		if( got <= 0 )
+			break;
+		total += got;
+	}
+	contents.resize(total);
+
+	_close(fd);
+	return HOST_READ_OK;
+}
+
+/**
+ *	\brief Make a host directory, unless there already is one.
+ *	
+ *	\param path The directory.
+ *	
+ *	\return False if there is no directory at path afterwards.
+ */
+bool makeHostDirectory( const std::string& path )
+{
+	return CreateDirectoryA(path.c_str(), nullptr) || isHostDirectory(path);
+}
+
+/**
+ *	\brief Write a whole host file, replacing whatever was there.
+ *	
+ *	\param path The file.
+ *	\param data The bytes to write.
+ *	\param length How many bytes there are.
+ *	
+ *	\return False if the file could not be written.
+ */
+bool writeHostFile( const std::string& path, const char* data, 
+	std::size_t length )
+{
+	const int fd = _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | 
+		_O_BINARY, _S_IREAD | _S_IWRITE);
+	if( fd < 0 )
+		return false;
+
+	// _write() takes at most an unsigned int at a time
+	bool written = true;
+	while( length > 0 && written )
+	{
+		const unsigned piece = static_cast<unsigned>(
+			std::min<std::size_t>(length, 1u << 30));
+		const int put = _write(fd, data, piece);
+		written = put > 0;
+		if( written )
+		{
+			data += put;
+			length -= put;
+		}
+	}
+
+	return _close(fd) == 0 && written;
+}
+#else
+/**
+ *	\brief Is there a directory at a host path?
+ *	
+ *	\param path The path to check.
+ *	
+ *	\return True if it is a directory, following links.
+ */
+bool isHostDirectory( const std::string& path )
+{
+	struct stat info = {};
+	return ::stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+/**
+ *	\brief List the files and directories in a host directory.
+ *	
+ *	\param path The directory.
+ *	\param entries Set to what is in it, sorted by name.
+ *	
+ *	The kind of each entry comes from the listing itself where the host file 
+ *	system gives it, so most entries are never stat()ed.
+ *	
+ *	\return False if the directory could not be read.
+ */
+bool listHostDirectory( const std::string& path, 
+	std::vector<HostEntry>& entries )
+{
+	entries.clear();
+
+	DIR* dir = ::opendir(path.c_str());
+	if( !dir )
+		return false;
+
+	while( const dirent* entry = ::readdir(dir) )
+	{
+		const std::string name = entry->d_name;
+		if( name == "." || name == ".." )
+			continue;
+
+		unsigned char type = entry->d_type;
+		if( type == DT_UNKNOWN )
+		{
+			struct stat info = {};
+			if( ::lstat(joinHostPath(path, name).c_str(), &info) != 0 )
+				continue;
+			type = S_ISDIR(info.st_mode) ? DT_DIR : 
+				S_ISREG(info.st_mode) ? DT_REG : DT_UNKNOWN;
+		}
+
+		if( type == DT_DIR || type == DT_REG )
+			entries.push_back(HostEntry{name, type == DT_DIR});
+	}
+
+	::closedir(dir);
+
+	// The order readdir() gives is whatever the host file system keeps
+	std::sort(entries.begin(), entries.end(), 
+		[]( const HostEntry& a, const HostEntry& b ){ return a.name < b.name; });
+	return true;
+}
+
+/**
+ *	\brief Read a whole host file, if it is not too large.
+ *	
+ *	\param path The file.
+ *	\param limit The most bytes the file can have.
+ *	\param contents Set to the bytes of the file.
+ *	
+ *	\return How it went, contents is only set for HOST_READ_OK.
+ */
+HostRead readHostFile( const std::string& path, std::size_t limit, 
+	std::string& contents )
+{
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if( fd < 0 )
+		return HOST_READ_FAILED;
+
+	struct stat info = {};
+	if( ::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) )
+	{
+		::close(fd);
+		return HOST_READ_FAILED;
+	}
+	if( static_cast<std::uint64_t>(info.st_size) > limit )
+	{
+		::close(fd);
+		return HOST_READ_TOO_LARGE;
+	}
+
+	// Read straight into the string, it is sized to the file up front
+	contents.resize(static_cast<std::size_t>(info.st_size));
+	std::size_t total = 0;
+	while( total < contents.size() )
+	{
+		const ssize_t got = ::read(fd, &contents[total], 
+			contents.size() - total);
+		if( got <= 0 )
+			break;
+		total += got;
+	}
+	contents.resize(total);
+
+	::close(fd);
+	return HOST_READ_OK;
+}
+
+/**
+ *	\brief Make a host directory, unless there already is one.
+ *	
+ *	\param path The directory.
+ *	
+ *	\return False if there is no directory at path afterwards.
+ */
+bool makeHostDirectory( const std::string& path )
+{
+	return ::mkdir(path.c_str(), 0755) == 0 || isHostDirectory(path);
+}
+
+/**
+ *	\brief Write a whole host file, replacing whatever was there.
+ *	
+ *	\param path The file.
+ *	\param data The bytes to write.
+ *	\param length How many bytes there are.
+ *	
+ *	The bytes go straight from data to the host, in as few write()s as it 
+ *	takes, with no buffer in between.
+ *	
+ *	\return False if the file could not be written.
+ */
+bool writeHostFile( const std::string& path, const char* data, 
+	std::size_t length )
+{
+	const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if( fd < 0 )
+		return false;
+
+	bool written = true;
+	while( length > 0 && written )
+	{
+		const ssize_t put = ::write(fd, data, length);
+		written = put > 0;
+		if( written )
+		{
+			data += put;
+			length -= put;
+		}
+	}
+
+	return ::close(fd) == 0 && written;
+}
+#endif
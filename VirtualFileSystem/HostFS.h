@@ -0,0 +1,106 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef HOST_FS_H
+#define HOST_FS_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ *	The few calls into the host's own file system that import and export 
+ *	need, which are spelled differently on Windows.  Only plain files and 
+ *	directories are ever reported, links and devices are left out so that a 
+ *	walk of the host cannot loop or block.
+ */
+
+/**
+ *	\brief One thing in a host directory.
+ */
+struct HostEntry
+{
+	//! The name, without the directory it is in
+	std::string name;
+	//! Is it a directory rather than a file?
+	bool directory;
+};
+
+/**
+ *	\brief How reading a host file went.
+ */
+enum HostRead : std::uint8_t
+{
+	HOST_READ_OK		= 0,
+	HOST_READ_TOO_LARGE	= 1,
+	HOST_READ_FAILED	= 2
+};
+
+/**
+ *	\brief Put a name on the end of a host path.
+ *	
+ *	\param path The directory.
+ *	\param name What is in it.
+ *	
+ *	\return The path of name.
+ */
+std::string joinHostPath( const std::string& path, const std::string& name );
+
+/**
+ *	\brief Is there a directory at a host path?
+ *	
+ *	\param path The path to check.
+ *	
+ *	\return True if it is a directory, following links.
+ */
+bool isHostDirectory( const std::string& path );
+
+/**
+ *	\brief List the files and directories in a host directory.
+ *	
+ *	\param path The directory.
+ *	\param entries Set to what is in it, sorted by name.
+ *	
+ *	\return False if the directory could not be read.
+ */
+bool listHostDirectory( const std::string& path, 
+	std::vector<HostEntry>& entries );
+
+/**
+ *	\brief Read a whole host file, if it is not too large.
+ *	
+ *	\param path The file.
+ *	\param limit The most bytes the file can have.
+ *	\param contents Set to the bytes of the file.
+ *	
+ *	\return How it went, contents is only set for HOST_READ_OK.
+ */
+HostRead readHostFile( const std::string& path, std::size_t limit, 
+	std::string& contents );
+
+/**
+ *	\brief Make a host directory, unless there already is one.
+ *	
+ *	\param path The directory.
+ *	
+ *	\return False if there is no directory at path afterwards.
+ */
+bool makeHostDirectory( const std::string& path );
+
+/**
+ *	\brief Write a whole host file, replacing whatever was there.
+ *	
+ *	\param path The file.
+ *	\param data The bytes to write.
+ *	\param length How many bytes there are.
+ *	
+ *	\return False if the file could not be written.
+ */
+bool writeHostFile( const std::string& path, const char* data, 
+	std::size_t length );
+
+#endif
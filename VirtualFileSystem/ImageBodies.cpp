@@ -0,0 +1,147 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "ImageBodies.h"
+#include "ImageReader.h"
+#include "ImageFormat.h"
+#include "Checksum.h"
+
+#include <cstring>
+#include <unordered_set>
+
+/**
+ *	\brief Add a body to the image, unless it already has the same bytes.
+ *	
+ *	\param data The body as it is stored in the image.
+ *	\param length How many bytes there are.
+ *	\param flags The NodeFlags that say how the body is stored.
+ *	
+ *	The bytes have to stay where they are until the image is written.
+ */
+void ImageBodies::add( const char* data, std::size_t length, 
+	std::uint8_t flags )
+{
+	// The same bytes again, like every TextFile that shares a Blob
+	if( lookUp(data, length, flags) != bodies.size() )
+		return;
+
+	// Different bytes with the same hash are rare, but they are not the same
+	const std::uint64_t hash = contentHash(data, length);
+	const auto range = byContent.equal_range(hash);
+	for( auto it = range.first; it != range.second; ++it)
+	{
+		const Body& body = bodies[it->second];
+		if( body.length == length && body.flags == flags && 
+			std::memcmp(body.data, data, length) == 0 )
+		{
+			byAddress.emplace(data, it->second);
+			return;
+		}
+	}
+
+	byAddress.emplace(data, bodies.size());
+	byContent.emplace(hash, bodies.size());
+	bodies.push_back(Body{data, length, flags, size});
+	size += length;
+}
+
+/**
+ *	\brief Find where a body that was added went in the payload region.
+ *	
+ *	\param data The body, at the address it was added with.
+ *	\param length How many bytes there are.
+ *	\param flags The NodeFlags that say how the body is stored.
+ *	\param offset Set to the body's offset in the payload region.
+ *	
+ *	\return False if the body was never added.
+ */
+bool ImageBodies::find( const char* data, std::size_t length, 
+	std::uint8_t flags, std::uint64_t& offset ) const
+{
+	const std::size_t index = lookUp(data, length, flags);
+	if( index == bodies.size() )
+		return false;
+
+	offset = bodies[index].offset;
+	return true;
+}
+
+/**
+ *	\return How many bytes the distinct bodies take up.
+ */
+std::uint64_t ImageBodies::getSize() const
+{
+	return size;
+}
+
+/**
+ *	\brief Copy every distinct body into place.
+ *	
+ *	\param payload The first byte of the payload region, getSize() bytes are 
+ *	written.
+ */
+void ImageBodies::copyTo( char* payload ) const
+{
+	for( const auto& body : bodies)
+		if( body.length )
+			std::memcpy(payload + body.offset, body.data, body.length);
+}
+
+/**
+ *	\brief Find a body by where its bytes are.
+ *	
+ *	\return The body's index in bodies, or bodies.size() if there is none.
+ */
+std::size_t ImageBodies::lookUp( const char* data, std::size_t length, 
+	std::uint8_t flags ) const
+{
+	// A body can start where a longer one does, so the length has to match
+	const auto range = byAddress.equal_range(data);
+	for( auto it = range.first; it != range.second; ++it)
+	{
+		const Body& body = bodies[it->second];
+		if( body.length == length && body.flags == flags )
+			return it->second;
+	}
+
+	return bodies.size();
+}
+
+/**
+ *	\brief Add up how much sharing bodies saves in an image on disk.
+ *	
+ *	\param image The mapped image.
+ *	\param stats Accumulates every TextFile node and the distinct payloads 
+ *	they point at.
+ *	
+ *	\return False if the image is not an indexed image.
+ */
+bool ImageBodies::survey( const ImageFile& image, SharingStats& stats )
+{
+	ImageLayout layout;
+	if( !ImageReader::getLayout(image, layout) )
+		return false;
+
+	// Nodes that share a body point at the very same payload
+	std::unordered_set<std::uint64_t> seen;
+	for( std::uint32_t i = 0; i < layout.nodeCount; i++)
+	{
+		const ImageNode& node = layout.table[i];
+		if( node.kind != NODE_TEXT || node.payloadOffset > layout.payloadSize || 
+			node.payloadLength > layout.payloadSize - node.payloadOffset )
+			continue;
+
+		stats.references++;
+		stats.referencedBytes += node.payloadLength;
+		if( node.payloadLength && seen.insert(node.payloadOffset).second )
+		{
+			stats.distinct++;
+			stats.storedBytes += node.payloadLength;
+		}
+	}
+
+	return true;
+}
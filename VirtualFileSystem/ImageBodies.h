@@ -0,0 +1,120 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef IMAGE_BODIES_H
+#define IMAGE_BODIES_H
+
+#include <vector>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+#include "BlobStore.h"
+
+class ImageFile;
+
+/**
+ *	\brief The TextFile bodies of an image that is being written, each 
+ *	distinct one stored only once at the front of the payload region.
+ *	
+ *	Bodies are added while the FileSystem is measured, with the same bytes 
+ *	that writeToFile() will point at, whether those are in a Blob or still in 
+ *	the old image.  A body is looked up by its address first, so the bodies 
+ *	that are already shared cost nothing, and then by its contentHash(). 
+ *	Every node whose body has the same bytes and the same NodeFlags is given 
+ *	the same payload.
+ *	
+ *	Once the whole FileSystem has been measured it is only read from, so the 
+ *	threads that fill in an image can look bodies up at the same time.
+ */
+class ImageBodies
+{
+public:
+	/**
+	 *	\brief Add a body to the image, unless it already has the same bytes.
+	 *	
+	 *	\param data The body as it is stored in the image.
+	 *	\param length How many bytes there are.
+	 *	\param flags The NodeFlags that say how the body is stored.
+	 *	
+	 *	The bytes have to stay where they are until the image is written.
+	 */
+	void add( const char* data, std::size_t length, std::uint8_t flags );
+
+	/**
+	 *	\brief Find where a body that was added went in the payload region.
+	 *	
+	 *	\param data The body, at the address it was added with.
+	 *	\param length How many bytes there are.
+	 *	\param flags The NodeFlags that say how the body is stored.
+	 *	\param offset Set to the body's offset in the payload region.
+	 *	
+	 *	\return False if the body was never added.
+	 */
+	bool find( const char* data, std::size_t length, std::uint8_t flags, 
+		std::uint64_t& offset ) const;
+
+	/**
+	 *	\return How many bytes the distinct bodies take up.
+	 */
+	std::uint64_t getSize() const;
+
+	/**
+	 *	\brief Copy every distinct body into place.
+	 *	
+	 *	\param payload The first byte of the payload region, getSize() bytes 
+	 *	are written.
+	 */
+	void copyTo( char* payload ) const;
+
+	/**
+	 *	\brief Add up how much sharing bodies saves in an image on disk.
+	 *	
+	 *	\param image The mapped image.
+	 *	\param stats Accumulates every TextFile node and the distinct 
+	 *	payloads they point at.
+	 *	
+	 *	\return False if the image is not an indexed image.
+	 */
+	static bool survey( const ImageFile& image, SharingStats& stats );
+
+private:
+	/**
+	 *	\brief One distinct body.
+	 */
+	struct Body
+	{
+		//! The first byte, where it was added from
+		const char* data;
+		//! How many bytes there are
+		std::size_t length;
+		//! The NodeFlags that say how the body is stored
+		std::uint8_t flags;
+		//! Where the body goes in the payload region
+		std::uint64_t offset;
+	};
+
+	/**
+	 *	\brief Find a body by where its bytes are.
+	 *	
+	 *	\return The body's index in bodies, or bodies.size() if there is none.
+	 */
+	std::size_t lookUp( const char* data, std::size_t length, 
+		std::uint8_t flags ) const;
+
+	//! Every distinct body, in the order they go in the payload region
+	std::vector<Body> bodies;
+
+	//! Indices into bodies, by the address of every copy that was added
+	std::unordered_multimap<const char*, std::size_t> byAddress;
+
+	//! Indices into bodies, by the contentHash() of their bytes
+	std::unordered_multimap<std::uint64_t, std::size_t> byContent;
+
+	//! Bytes the distinct bodies take up
+	std::uint64_t size = 0;
+};
+
+#endif
@@ -0,0 +1,120 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "ImageFile.h"
+
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/**
+ *	\brief Map an image file from disk into memory.
+ *	
+ *	\param filename The name of the image on disk.
+ *	
+ *	\return A shared pointer to the mapped image, or null if the file could not 
+ *	be opened.
+ */
+std::shared_ptr<ImageFile> ImageFile::open( const std::string& filename )
+{
+	auto image = std::make_shared<ImageFile>(filename);
+	if( !image->isOpen() )
+		return nullptr;
+
+	return image;
+}
+
+/**
+ *	\brief Constructor that should NOT be used.  Instead use the open() 
+ *	function, which reports failure by returning null.
+ *	
+ *	\param filename The name of the image on disk.
+ */
+ImageFile::ImageFile( const std::string& filename )
+{
+#ifndef _WIN32
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if( fd < 0 )
+		return;
+
+	opened = true;
+
+	struct stat info = {};
+	if( fstat(fd, &info) == 0 && info.st_size > 0 )
+	{
+		void* m = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if( m != MAP_FAILED )
+		{
+			// The loader walks the image front to back exactly once
+			madvise(m, info.st_size, MADV_SEQUENTIAL);
+
+			data = static_cast<const char*>(m);
+			size = info.st_size;
+			mapped = true;
+		}
+	}
+
+	// The mapping stays valid after the descriptor is closed
+	::close(fd);
+
+	if( mapped || info.st_size == 0 )
+		return;
+#endif
+
+	// No mapping available, pull the whole image in with a single read
+	std::ifstream stream{ filename, std::ios::in | std::ios::binary };
+	if( !stream )
+		return;
+
+	opened = true;
+	stream.seekg(0, std::ios::end);
+	buffer.resize(static_cast<std::size_t>(stream.tellg()));
+	stream.seekg(0, std::ios::beg);
+	stream.read(buffer.data(), buffer.size());
+
+	data = buffer.data();
+	size = buffer.size();
+}
+
+/**
+ *	\brief Release the mapping.
+ */
+ImageFile::~ImageFile()
+{
+#ifndef _WIN32
+	if( mapped )
+		munmap(const_cast<char*>(data), size);
+#endif
+}
+
+/**
+ *	\return Was the image successfully opened?
+ */
+bool ImageFile::isOpen() const
+{
+	return opened;
+}
+
+/**
+ *	\return Pointer to the first byte of the image.
+ */
+const char* ImageFile::getData() const
+{
+	return data;
+}
+
+/**
+ *	\return How many bytes are in the image.
+ */
+std::size_t ImageFile::getSize() const
+{
+	return size;
+}
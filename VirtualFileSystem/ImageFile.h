@@ -0,0 +1,85 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef IMAGE_FILE_H
+#define IMAGE_FILE_H
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+/**
+ *	\brief A read-only view of a FileSystem image on disk.  The image is 
+ *	memory-mapped so that the loader can parse records straight out of the 
+ *	mapping, and so that TextFiles can reference their bodies in place instead 
+ *	of copying them onto the heap.
+ *	
+ *	The mapping lives for as long as something holds a shared pointer to the 
+ *	ImageFile, so any FSObject that still points into it must keep one.
+ */
+class ImageFile
+{
+public:
+	/**
+	 *	\brief Map an image file from disk into memory.
+	 *	
+	 *	\param filename The name of the image on disk.
+	 *	
+	 *	\return A shared pointer to the mapped image, or null if the file could 
+	 *	not be opened.
+	 */
+	static std::shared_ptr<ImageFile> open( const std::string& filename );
+
+	/**
+	 *	\brief Constructor that should NOT be used.  Instead use the open() 
+	 *	function, which reports failure by returning null.
+	 *	
+	 *	\param filename The name of the image on disk.
+	 */
+	explicit ImageFile( const std::string& filename );
+
+	/**
+	 *	\brief Release the mapping.
+	 */
+	~ImageFile();
+
+	ImageFile( const ImageFile& ) = delete;
+	ImageFile& operator=( const ImageFile& ) = delete;
+
+	/**
+	 *	\return Was the image successfully opened?
+	 */
+	bool isOpen() const;
+
+	/**
+	 *	\return Pointer to the first byte of the image.
+	 */
+	const char* getData() const;
+
+	/**
+	 *	\return How many bytes are in the image.
+	 */
+	std::size_t getSize() const;
+
+private:
+	//! First byte of the image, either in the mapping or in the buffer
+	const char* data = nullptr;
+
+	//! Total size of the image in bytes
+	std::size_t size = 0;
+
+	//! Was the image mapped (true) or read into the buffer (false)?
+	bool mapped = false;
+
+	//! Was the file opened at all?
+	bool opened = false;
+
+	//! Fallback storage when the platform cannot map the file
+	std::vector<char> buffer;
+};
+
+#endif
@@ -0,0 +1,203 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef IMAGE_FORMAT_H
+#define IMAGE_FORMAT_H
+
+#include <cstdint>
+
+class ImageBodies;
+
+/**
+ *	The layout of an indexed FileSystem image.  An indexed image is made of 
+ *	five regions:
+ *	
+ *		ImageHeader		Identifies the image and locates the other regions.
+ *		Node table		One fixed-size ImageNode per FSObject, in pre-order, 
+ *						so every Directory comes before its children and a 
+ *						Directory's subtree is a contiguous run of entries.
+ *		Payload			TextFile bodies, ProgramFile data and the totals of 
+ *						each Directory's subtree, referenced by 
+ *						offset and length from the node table.  Large 
+ *						TextFile bodies are stored as framed compressed 
+ *						blocks (see Compression.h), flagged NODE_COMPRESSED 
+ *						and NODE_FRAMED.  Each distinct TextFile body is 
+ *						stored once, at the front of the region, and every 
+ *						node with the same body points at it (see 
+ *						ImageBodies.h).
+ *		Snapshots		The name of every snapshot in the order they were 
+ *						taken, 8 null padded chars each.  Each node records 
+ *						the generation (see Snapshots.h) it was made in.
+ *		Checksums		One CRC32C per IMAGE_BLOCK_SIZE block of everything 
+ *						before the checksums, header included.
+ *	
+ *	Only one version of the indexed format, IMAGE_VERSION, is read or 
+ *	written.  Version 1 images are the original sequential 
+ *	name.d/objCount/endname records.  They have no header and are still 
+ *	accepted by the loader.
+ *	All integers are stored in the host's (little-endian) byte order, just as 
+ *	the version 1 records always were.
+ */
+
+//! First 8 bytes of every indexed image
+const char IMAGE_MAGIC[8] = { 'R', 'U', 'I', 'N', 'V', 'F', 'S', '2' };
+
+//! The version of the indexed format, an indexed image with any other 
+//!	version is not loaded
+const std::uint32_t IMAGE_VERSION = 10;
+
+//! Bytes of each name in the snapshot region
+const std::uint32_t SNAPSHOT_NAME_SIZE = 8;
+
+//! Bytes covered by each block checksum
+const std::uint32_t IMAGE_BLOCK_SIZE = 64 * 1024;
+
+//! TextFile bodies this long or longer are compressed in the image
+const std::uint64_t TEXT_COMPRESS_THRESHOLD = 1024;
+
+//! Bytes of a TextFile body in each compressed frame, this is also how much 
+//!	of a body is read at a time when it is printed
+const std::uint32_t TEXT_FRAME_SIZE = 64 * 1024;
+
+//! Marks the parent of the root node
+const std::uint32_t NO_PARENT = 0xFFFFFFFF;
+
+//! Bytes of payload for a ProgramFile: time, memory and the three IO ints
+const std::uint64_t PROGRAM_PAYLOAD_SIZE = 5 * sizeof(std::int32_t);
+
+//! Bytes of payload for a Directory: the node count, text bytes, program 
+//!	count and program memory of its subtree, as four 64 bit ints
+const std::uint64_t DIRECTORY_PAYLOAD_SIZE = 4 * sizeof(std::uint64_t);
+
+//! What kind of FSObject a node in the table describes, FSObjects carry the 
+//!	same tag in memory
+enum NodeKind : std::uint8_t {
+	NODE_DIRECTORY	= 0,
+	NODE_TEXT		= 1,
+	NODE_PROGRAM	= 2
+};
+
+//! Bits in the flags of a node in the table
+enum NodeFlags : std::uint8_t {
+	//! The payload is a compressed block rather than the raw bytes
+	NODE_COMPRESSED	= 0x01,
+	//! The compressed block is split into frames
+	NODE_FRAMED		= 0x02,
+	//! The node was replaced by a newer one with the same name, its 
+	//!	childCount holds the generation it was replaced in
+	NODE_REPLACED	= 0x04
+};
+
+/**
+ *	\brief Fixed-size header at the very start of an indexed image.
+ */
+struct ImageHeader
+{
+	//! Always IMAGE_MAGIC
+	char magic[8];
+	//! Format version, IMAGE_VERSION
+	std::uint32_t version;
+	//! Number of entries in the node table
+	std::uint32_t nodeCount;
+	//! Byte offset of the node table from the start of the image
+	std::uint64_t tableOffset;
+	//! Byte offset of the payload region from the start of the image
+	std::uint64_t payloadOffset;
+	//! Number of bytes in the payload region
+	std::uint64_t payloadSize;
+	//! The last journal record that has been folded into this image
+	std::uint64_t journalSequence;
+	//! Byte offset of the checksums, every byte before it is checksummed
+	std::uint64_t checksumOffset;
+	//! Bytes covered by each checksum
+	std::uint32_t blockSize;
+	//! Number of checksums
+	std::uint32_t blockCount;
+	//! Byte offset of the snapshot names
+	std::uint64_t snapshotOffset;
+	//! Number of snapshot names
+	std::uint32_t snapshotCount;
+	//! Reserved, always 0
+	std::uint32_t reserved;
+};
+
+/**
+ *	\brief One entry of the node table.  Every FSObject in the image has 
+ *	exactly one.
+ */
+struct ImageNode
+{
+	//! Index of the Directory that holds this node, NO_PARENT for root
+	std::uint32_t parent;
+	//! One of NodeKind
+	std::uint8_t kind;
+	//! Any of NodeFlags
+	std::uint8_t flags;
+	//! How many snapshots had been taken when the FSObject was made
+	std::uint16_t generation;
+	//! The name, null padded exactly like a version 1 record
+	char name[8];
+	//! Number of direct children (Directories only), or the generation a 
+	//!	NODE_REPLACED node was replaced in
+	std::uint32_t childCount;
+	//! Number of entries in this node's subtree, not counting itself
+	std::uint32_t subtreeSize;
+	//! Offset of this node's payload from the start of the payload region
+	std::uint64_t payloadOffset;
+	//! Number of bytes of payload
+	std::uint64_t payloadLength;
+};
+
+/**
+ *	\brief Where the regions of a mapped indexed image are, once its header 
+ *	has been checked.
+ */
+struct ImageLayout
+{
+	//! First entry of the node table
+	const ImageNode* table;
+	//! Number of entries in the node table
+	std::uint32_t nodeCount;
+	//! First byte of the payload region
+	const char* payload;
+	//! Number of bytes in the payload region
+	std::uint64_t payloadSize;
+	//! The last journal record that has been folded into the image
+	std::uint64_t journalSequence;
+	//! First block checksum, null if the image has none
+	const char* checksums;
+	//! Bytes covered by each checksum
+	std::uint32_t blockSize;
+	//! Number of checksums
+	std::uint32_t blockCount;
+	//! Number of bytes the checksums cover, from the start of the image
+	std::uint64_t checkedSize;
+	//! First snapshot name, null if the image has none
+	const char* snapshots;
+	//! Number of snapshot names
+	std::uint32_t snapshotCount;
+};
+
+/**
+ *	\brief How much room part of a FileSystem takes up in an indexed image.
+ */
+struct ImageSize
+{
+	//! Number of entries in the node table
+	std::uint64_t nodeCount = 0;
+	//! Number of bytes in the payload region
+	std::uint64_t payloadSize = 0;
+	//! Number of snapshot names, only ever set for a whole image
+	std::uint64_t snapshotCount = 0;
+	//! Collects the TextFile bodies, which are not in payloadSize since 
+	//!	each distinct one is only stored once.  Only set for a whole image.
+	ImageBodies* bodies = nullptr;
+};
+
+static_assert(sizeof(ImageHeader) == 80, "ImageHeader must be 80 bytes");
+static_assert(sizeof(ImageNode) == 40, "ImageNode must be 40 bytes");
+
+#endif
@@ -0,0 +1,508 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "ImageReader.h"
+#include "ImageFormat.h"
+#include "TextFile.h"
+#include "ProgramFile.h"
+#include "NodeArena.h"
+#include "ThreadPool.h"
+#include "Checksum.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/**
+ *	\brief Inflate the FileSystem stored in an image.
+ *	
+ *	\param image The mapped image to read from.
+ *	\param arena The NodeArena to make the FileSystem's nodes in.
+ *	
+ *	\return The root Directory of the FileSystem, or null if the image did not 
+ *	contain one.
+ */
+Directory* ImageReader::load( const std::shared_ptr<ImageFile>& image, 
+	NodeArena& arena )
+{
+	if( isIndexed(*image) )
+		return loadIndexed(image, arena);
+
+	return loadLegacy(image, arena);
+}
+
+/**
+ *	\brief Is this image in the indexed format?
+ *	
+ *	\param image The mapped image to check.
+ *	
+ *	\return True if the image starts with an indexed header, of any version.
+ */
+bool ImageReader::isIndexed( const ImageFile& image )
+{
+	return image.getSize() >= sizeof(ImageHeader) &&
+		std::memcmp(image.getData(), IMAGE_MAGIC, sizeof(IMAGE_MAGIC)) == 0;
+}
+
+/**
+ *	\brief Get the version of an indexed image.
+ *	
+ *	\param image The mapped image to check.
+ *	
+ *	\return The version in its header, or 1 for a sequential image.
+ */
+std::uint32_t ImageReader::getVersion( const ImageFile& image )
+{
+	if( !isIndexed(image) )
+		return 1;
+
+	ImageHeader header;
+	std::memcpy(&header, image.getData(), sizeof(header));
+	return header.version;
+}
+
+/**
+ *	\brief Locate the node table and payload region of an indexed image.
+ *	
+ *	\param image The mapped image to check.
+ *	\param layout Filled in with the regions of the image.
+ *	
+ *	\return False if the image is not indexed, is not IMAGE_VERSION, or its 
+ *	header describes regions that are not in the image.
+ */
+bool ImageReader::getLayout( const ImageFile& image, ImageLayout& layout )
+{
+	if( !isIndexed(image) )
+		return false;
+
+	ImageHeader header;
+	std::memcpy(&header, image.getData(), sizeof(header));
+
+	// Make sure the regions the header describes are really in the image
+	const std::uint64_t size = image.getSize();
+	if( header.version != IMAGE_VERSION || header.nodeCount == 0 ||
+		header.tableOffset > size ||
+		header.nodeCount > (size - header.tableOffset) / sizeof(ImageNode) ||
+		header.payloadOffset > size ||
+		header.payloadSize > size - header.payloadOffset )
+		return false;
+
+	layout.table = reinterpret_cast<const ImageNode*>(
+		image.getData() + header.tableOffset);
+	layout.nodeCount = header.nodeCount;
+	layout.payload = image.getData() + header.payloadOffset;
+	layout.payloadSize = header.payloadSize;
+	layout.journalSequence = header.journalSequence;
+
+	// The checksums have to cover the header, the table and the payload
+	if( header.blockSize == 0 || header.checksumOffset > size ||
+		header.checksumOffset < header.tableOffset + 
+			header.nodeCount * sizeof(ImageNode) ||
+		header.checksumOffset < header.payloadOffset + header.payloadSize ||
+		header.blockCount != (header.checksumOffset + header.blockSize - 1) / 
+			header.blockSize ||
+		header.blockCount > (size - header.checksumOffset) / 
+			sizeof(std::uint32_t) )
+		return false;
+
+	layout.checksums = image.getData() + header.checksumOffset;
+	layout.blockSize = header.blockSize;
+	layout.blockCount = header.blockCount;
+	layout.checkedSize = header.checksumOffset;
+
+	// The snapshot names sit between the payload and the checksums
+	if( header.snapshotOffset < header.payloadOffset + header.payloadSize ||
+		header.snapshotOffset > header.checksumOffset ||
+		header.snapshotCount > (header.checksumOffset - header.snapshotOffset) / 
+			SNAPSHOT_NAME_SIZE )
+		return false;
+
+	layout.snapshots = image.getData() + header.snapshotOffset;
+	layout.snapshotCount = header.snapshotCount;
+
+	return true;
+}
+
+/**
+ *	\brief Check an image against its block checksums, spreading the blocks 
+ *	across a pool of threads.
+ *	
+ *	\param image The mapped image to check.
+ *	\param pool The threads to do the work on.
+ *	\param damaged Filled in with the byte ranges that do not match their 
+ *	checksums, adjacent blocks are merged into one range.
+ *	
+ *	Sequential images have no checksums and always pass.  An indexed image 
+ *	whose header does not describe a valid layout is damaged as a whole.
+ *	
+ *	\return True if nothing is damaged.
+ */
+bool ImageReader::verify( const ImageFile& image, ThreadPool& pool, 
+	std::vector<ImageRange>& damaged )
+{
+	damaged.clear();
+	if( !isIndexed(image) )
+		return true;
+
+	ImageLayout layout;
+	if( !getLayout(image, layout) )
+	{
+		damaged.push_back(ImageRange{ 0, image.getSize() });
+		return false;
+	}
+
+	// Each task checks its own run of blocks and marks the ones that fail
+	const std::uint32_t blocks = layout.blockCount;
+	std::vector<char> failed(blocks, 0);
+
+	const std::uint32_t tasks = std::min<std::uint32_t>(blocks, 
+		static_cast<std::uint32_t>(pool.getThreadCount()) * 4);
+	for( std::uint32_t t = 0; t < tasks; t++)
+	{
+		const std::uint32_t first = static_cast<std::uint32_t>(
+			static_cast<std::uint64_t>(blocks) * t / tasks);
+		const std::uint32_t last = static_cast<std::uint32_t>(
+			static_cast<std::uint64_t>(blocks) * (t + 1) / tasks);
+
+		pool.submit([&image, &layout, &failed, first, last]
+		{
+			for( std::uint32_t b = first; b < last; b++)
+			{
+				const std::uint64_t offset = 
+					static_cast<std::uint64_t>(b) * layout.blockSize;
+				const std::uint64_t length = std::min<std::uint64_t>(
+					layout.blockSize, layout.checkedSize - offset);
+
+				std::uint32_t expected;
+				std::memcpy(&expected, layout.checksums + 
+					b * sizeof(std::uint32_t), sizeof(expected));
+
+				failed[b] = crc32c(image.getData() + offset, length) != expected;
+			}
+		});
+	}
+	pool.wait();
+
+	// Report runs of bad blocks as single ranges
+	for( std::uint32_t b = 0; b < blocks; b++)
+	{
+		if( !failed[b] )
+			continue;
+
+		const std::uint64_t offset = static_cast<std::uint64_t>(b) * 
+			layout.blockSize;
+		const std::uint64_t end = std::min<std::uint64_t>(
+			offset + layout.blockSize, layout.checkedSize);
+
+		if( !damaged.empty() && 
+			damaged.back().offset + damaged.back().length == offset )
+			damaged.back().length = end - damaged.back().offset;
+		else
+			damaged.push_back(ImageRange{ offset, end - offset });
+	}
+
+	return damaged.empty();
+}
+
+/**
+ *	\brief Inflate the root of an indexed image.  The rest of the 
+ *	tree stays in the image until it is used.
+ *	
+ *	\param image The mapped image to read from.
+ *	\param arena The NodeArena to make the root in.
+ *	
+ *	\return The root Directory, or null if the image is malformed.
+ */
+Directory* ImageReader::loadIndexed( const std::shared_ptr<ImageFile>& image, 
+	NodeArena& arena )
+{
+	ImageLayout layout;
+	if( !getLayout(*image, layout) )
+		return nullptr;
+
+	// The first node is always root
+	const ImageNode& node = layout.table[0];
+	if( node.kind != NODE_DIRECTORY )
+		return nullptr;
+
+	std::string name(node.name, strnlen(node.name, sizeof(node.name)));
+	auto root = Directory::CreateDirectory(arena, name, nullptr, true);
+
+	// Root's children are only read once something looks inside of it
+	if( root )
+		root->deferChildren(image, std::make_shared<const ImageTotals>(image), 
+			0);
+
+	return root;
+}
+
+/**
+ *	\brief Inflate the direct children of a Directory that is still stored in 
+ *	an indexed image.
+ *	
+ *	\param dir The Directory to add the children to.
+ *	\param image The mapped image that holds the Directory.
+ *	\param totals The totals of the image's Directories.
+ *	\param index The Directory's entry in the node table.
+ *	
+ *	Child Directories are not inflated, they are left as stubs that point back 
+ *	at their own entry in the table.  A TextFile that was replaced is linked 
+ *	to the one that replaced it, which always comes after it.
+ */
+void ImageReader::inflateChildren( Directory& dir, 
+	const std::shared_ptr<ImageFile>& image, 
+	const std::shared_ptr<const ImageTotals>& totals, std::uint32_t index )
+{
+	ImageLayout layout;
+	if( !getLayout(*image, layout) || index >= layout.nodeCount )
+		return;
+
+	// The subtree is the run of entries right after the Directory
+	const std::uint64_t last = std::min<std::uint64_t>(
+		index + static_cast<std::uint64_t>(layout.table[index].subtreeSize), 
+		layout.nodeCount - 1);
+
+	std::string name;
+	NodeArena& arena = dir.getArena();
+
+	// Replaced TextFiles that have not met their replacement yet, by name
+	std::unordered_map<std::uint64_t, TextFile*> replacedFiles;
+
+	// Step from child to child, jumping over each child Directory's subtree
+	std::uint64_t i = index + 1;
+	while( i <= last )
+	{
+		const ImageNode& node = layout.table[i];
+		const std::uint64_t next = i + 1 + 
+			(node.kind == NODE_DIRECTORY ? node.subtreeSize : 0);
+
+		// Skip anything that is not a direct child, or has a bad payload
+		if( node.parent != index || 
+			node.payloadOffset > layout.payloadSize || 
+			node.payloadLength > layout.payloadSize - node.payloadOffset )
+		{
+			i = next;
+			continue;
+		}
+
+		name.assign(node.name, strnlen(node.name, sizeof(node.name)));
+		const char* data = layout.payload + node.payloadOffset;
+
+		switch( node.kind )
+		{
+			case NODE_DIRECTORY:
+			{
+				auto d = Directory::CreateDirectory(arena, name, &dir);
+				if( d )
+				{
+					d->deferChildren(image, totals, 
+						static_cast<std::uint32_t>(i));
+					d->setGeneration(node.generation);
+					dir.addObject(d);
+				}
+				break;
+			}
+
+			case NODE_TEXT:
+			{
+				auto t = TextFile::inflateTextFile(arena, name, image, data, 
+					node.payloadLength, node.flags & ~NODE_REPLACED);
+				t->setGeneration(node.generation);
+
+				// The replacement is made in the generation the old one ends
+				const auto previous = replacedFiles.find(t->getFileName().key());
+				if( previous != replacedFiles.end() && 
+					previous->second->getReplaced() == node.generation )
+				{
+					previous->second->setReplacement(t);
+					replacedFiles.erase(previous);
+				}
+
+				if( node.flags & NODE_REPLACED )
+				{
+					t->setReplaced(node.childCount);
+					replacedFiles[t->getFileName().key()] = t;
+				}
+
+				dir.addObject(t);
+				break;
+			}
+
+			case NODE_PROGRAM:
+			{
+				const char* cursor = data;
+				if( node.payloadLength == PROGRAM_PAYLOAD_SIZE )
+				{
+					auto p = ProgramFile::inflateProgramFile(arena, name, *image, 
+						cursor);
+					if( p )
+					{
+						p->setGeneration(node.generation);
+						dir.addObject(p);
+					}
+				}
+				break;
+			}
+		}
+
+		i = next;
+	}
+}
+
+/**
+ *	\brief Inflate a sequential (version 1) image one record at a time.
+ *	
+ *	\param image The mapped image to read from.
+ *	\param arena The NodeArena to make the FileSystem's nodes in.
+ *	
+ *	\return The root Directory, or null if the image is empty.
+ */
+Directory* ImageReader::loadLegacy( const std::shared_ptr<ImageFile>& image, 
+	NodeArena& arena )
+{
+	Directory* root = nullptr;
+	Directory* current = nullptr;
+
+	const char* cursor = image->getData();
+	const char* end = cursor + image->getSize();
+
+	// 11 char token to pull from the file.  All files/directories are 
+	//	identified by 11 chars, 8 for name, a period, a 1 char extension 
+	//	and then a null character.  Closers are "end" + the padded name.
+	const std::size_t tokenSize = 11;
+
+	// The name of the current record, at most 8 chars so it never allocates
+	std::string parsed;
+
+	bool running = true;
+	while( running && static_cast<std::size_t>(end - cursor) >= tokenSize)
+	{
+		// Grab a token
+		const char* token = cursor;
+		cursor += tokenSize;
+
+		// Only records have a period where the extension goes
+		const char extension = token[8] == '.' ? token[9] : '\0';
+
+		// The name is everything before the null padding
+		parsed.assign(token, strnlen(token, 8));
+
+		// We found a directory
+		if( extension == 'd' )
+		{
+			// Special case for root.d
+			if( !current )
+			{
+				root = Directory::CreateDirectory( arena, parsed, nullptr, true);
+				current = root;
+			}
+			else
+			{
+				// Try to inflate the flat directory back into the linked 
+				//	structure
+				auto d = Directory::CreateDirectory(arena, parsed, current );
+
+				// Swap current only if d was created
+				if( d )
+				{
+					current->addObject( d );
+					current = d;
+				}
+			}
+
+			// We get the number of files under the directory, but it's not used
+			cursor += std::min<std::size_t>(sizeof(int), end - cursor);
+		}
+
+		// Everything else needs a directory to live in
+		else if( !current )
+			break;
+
+		// We found a textfile
+		else if( extension == 't' )
+		{
+			// The body runs up to the next null, or the end of a truncated image
+			const char* terminator = static_cast<const char*>(
+				std::memchr(cursor, '\0', end - cursor));
+			if( !terminator )
+				terminator = end;
+
+			current->addObject( TextFile::inflateTextFile(arena, parsed, 
+				image, cursor, terminator - cursor, 0));
+
+			cursor = terminator == end ? end : terminator + 1;
+		}
+
+		// We found a program
+		else if( extension == 'p')
+		{
+			auto p = ProgramFile::inflateProgramFile(arena, parsed, *image, 
+				cursor);
+			if( p )
+				current->addObject( p );
+		}
+
+		// found an endX token, close the current directory
+		else if( token[0] == 'e' && token[1] == 'n' && token[2] == 'd' )
+		{
+			if( current == root )
+				running = false;
+			else
+				current = current->getParent();
+		}
+	}
+
+	return root;
+}
+
+/**
+ *	\brief Get ready to read the totals out of an image.
+ *	
+ *	\param image The mapped image, kept open as long as this is.
+ */
+ImageTotals::ImageTotals( std::shared_ptr<ImageFile> image )
+	: image(std::move(image))
+{
+	if( !ImageReader::getLayout(*this->image, layout) )
+		layout.nodeCount = 0;
+}
+
+/**
+ *	\brief Get the totals of a Directory.
+ *	
+ *	\param index The Directory's entry in the node table.
+ *	
+ *	\return Its totals, or empty totals if the entry is not a Directory or 
+ *	its payload is damaged.
+ */
+SubtreeTotals ImageTotals::get( std::uint32_t index ) const
+{
+	if( index >= layout.nodeCount || 
+		layout.table[index].kind != NODE_DIRECTORY )
+		return SubtreeTotals();
+
+	// The payload is nodes, text bytes, programs and program memory
+	const ImageNode& node = layout.table[index];
+	if( node.payloadLength == DIRECTORY_PAYLOAD_SIZE && 
+		node.payloadOffset <= layout.payloadSize && 
+		DIRECTORY_PAYLOAD_SIZE <= layout.payloadSize - node.payloadOffset )
+	{
+		std::uint64_t fields[4];
+		std::memcpy(fields, layout.payload + node.payloadOffset, sizeof(fields));
+
+		SubtreeTotals totals;
+		totals.nodes = fields[0];
+		totals.textBytes = fields[1];
+		totals.programs = fields[2];
+		totals.programMemory = static_cast<std::int64_t>(fields[3]);
+		return totals;
+	}
+
+	// A damaged payload gives no totals
+	return SubtreeTotals();
+}
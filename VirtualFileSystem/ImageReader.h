@@ -0,0 +1,175 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef IMAGE_READER_H
+#define IMAGE_READER_H
+
+#include <memory>
+#include <vector>
+#include "ImageFile.h"
+#include "Directory.h"
+#include "ImageFormat.h"
+
+class ThreadPool;
+class NodeArena;
+
+/**
+ *	\brief A run of bytes in an image.
+ */
+struct ImageRange
+{
+	//! Offset of the first byte from the start of the image
+	std::uint64_t offset;
+	//! Number of bytes in the run
+	std::uint64_t length;
+};
+
+/**
+ *	\brief The SubtreeTotals of the Directories in an indexed image, so a 
+ *	Directory that is still in the image knows its totals without being 
+ *	inflated.
+ *	
+ *	Each Directory's payload holds its totals, so they are read straight out 
+ *	of the image.
+ */
+class ImageTotals
+{
+public:
+	/**
+	 *	\brief Get ready to read the totals out of an image.
+	 *	
+	 *	\param image The mapped image, kept open as long as this is.
+	 */
+	explicit ImageTotals( std::shared_ptr<ImageFile> image );
+
+	/**
+	 *	\brief Get the totals of a Directory.
+	 *	
+	 *	\param index The Directory's entry in the node table.
+	 *	
+	 *	\return Its totals, or empty totals if the entry is not a Directory or 
+	 *	its payload is damaged.
+	 */
+	SubtreeTotals get( std::uint32_t index ) const;
+
+private:
+	//! The image the totals are in
+	std::shared_ptr<ImageFile> image;
+
+	//! Where the node table and payload are in the image
+	ImageLayout layout;
+};
+
+/**
+ *	\brief Rebuilds a FileSystem from a memory-mapped image.  Both the indexed 
+ *	format and the original sequential (version 1) records are understood, 
+ *	the format is picked by looking for the indexed header.
+ */
+class ImageReader
+{
+public:
+	/**
+	 *	\brief Inflate the FileSystem stored in an image.
+	 *	
+	 *	\param image The mapped image to read from.
+	 *	\param arena The NodeArena to make the FileSystem's nodes in.
+	 *	
+	 *	\return The root Directory of the FileSystem, or null if the image did 
+	 *	not contain one.
+	 */
+	static Directory* load( const std::shared_ptr<ImageFile>& image, 
+		NodeArena& arena );
+
+	/**
+	 *	\brief Is this image in the indexed format?
+	 *	
+	 *	\param image The mapped image to check.
+	 *	
+	 *	\return True if the image starts with an indexed header, of any 
+	 *	version.
+	 */
+	static bool isIndexed( const ImageFile& image );
+
+	/**
+	 *	\brief Get the version of an indexed image.
+	 *	
+	 *	\param image The mapped image to check.
+	 *	
+	 *	\return The version in its header, or 1 for a sequential image.
+	 */
+	static std::uint32_t getVersion( const ImageFile& image );
+
+	/**
+	 *	\brief Locate the node table and payload region of an indexed image.
+	 *	
+	 *	\param image The mapped image to check.
+	 *	\param layout Filled in with the regions of the image.
+	 *	
+	 *	\return False if the image is not indexed, is not IMAGE_VERSION, or 
+	 *	its header describes regions that are not in the image.
+	 */
+	static bool getLayout( const ImageFile& image, ImageLayout& layout );
+
+	/**
+	 *	\brief Check an image against its block checksums, spreading the 
+	 *	blocks across a pool of threads.
+	 *	
+	 *	\param image The mapped image to check.
+	 *	\param pool The threads to do the work on.
+	 *	\param damaged Filled in with the byte ranges that do not match their 
+	 *	checksums, adjacent blocks are merged into one range.
+	 *	
+	 *	Sequential images have no checksums and always pass.  An indexed 
+	 *	image whose header does not describe a valid layout is damaged as a 
+	 *	whole.
+	 *	
+	 *	\return True if nothing is damaged.
+	 */
+	static bool verify( const ImageFile& image, ThreadPool& pool, 
+		std::vector<ImageRange>& damaged );
+
+	/**
+	 *	\brief Inflate the direct children of a Directory that is still stored 
+	 *	in an indexed image.
+	 *	
+	 *	\param dir The Directory to add the children to.
+	 *	\param image The mapped image that holds the Directory.
+	 *	\param totals The totals of the image's Directories.
+	 *	\param index The Directory's entry in the node table.
+	 *	
+	 *	Child Directories are not inflated, they are left as stubs that point 
+	 *	back at their own entry in the table.
+	 */
+	static void inflateChildren( Directory& dir, 
+		const std::shared_ptr<ImageFile>& image, 
+		const std::shared_ptr<const ImageTotals>& totals, std::uint32_t index );
+
+private:
+	/**
+	 *	\brief Inflate the root of an indexed image.  The rest of the tree 
+	 *	stays in the image until it is used.
+	 *	
+	 *	\param image The mapped image to read from.
+	 *	\param arena The NodeArena to make the root in.
+	 *	
+	 *	\return The root Directory, or null if the image is malformed.
+	 */
+	static Directory* loadIndexed( const std::shared_ptr<ImageFile>& image, 
+		NodeArena& arena );
+
+	/**
+	 *	\brief Inflate a sequential (version 1) image one record at a time.
+	 *	
+	 *	\param image The mapped image to read from.
+	 *	\param arena The NodeArena to make the FileSystem's nodes in.
+	 *	
+	 *	\return The root Directory, or null if the image is empty.
+	 */
+	static Directory* loadLegacy( const std::shared_ptr<ImageFile>& image, 
+		NodeArena& arena );
+};
+
+#endif
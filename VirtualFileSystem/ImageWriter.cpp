@@ -0,0 +1,613 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "ImageWriter.h"
+#include "ImageReader.h"
+#include "ImageBodies.h"
+#include "Checksum.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/**
+ *	A new image only takes the old one's place once it is on the disk, and 
+ *	the journal is only emptied after that, so a crash part way through never 
+ *	leaves less than the old image and its journal.  These wrap the few calls 
+ *	that are spelled differently on Windows.
+ */
+#ifdef _WIN32
+static bool writeImageFile( const std::string& name, const char* data, 
+	std::size_t length )
+{
+	const HANDLE file = CreateFileA(name.c_str(), GENERIC_WRITE, 0, nullptr, 
+		CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if( file == INVALID_HANDLE_VALUE )
+		return false;
+
+	// WriteFile() takes at most a DWORD at a time
+	bool written = true;
+	while( length > 0 && written )
+	{
+		DWORD put = 0;
+		const DWORD piece = static_cast<DWORD>(
+			std::min<std::size_t>(length, 1u << 30));
+		written = WriteFile(file, data, piece, &put, nullptr) && put > 0;
+		data += put;
+		length -= put;
+	}
+
+	written = written && FlushFileBuffers(file);
+	return CloseHandle(file) && written;
+}
+static bool replaceImageFile( const std::string& from, const std::string& to )
+{
+	// Replaces to in one step, and only returns once the move is on the disk
+	return MoveFileExA(from.c_str(), to.c_str(), 
+		MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+#else
+static bool writeImageFile( const std::string& name, const char* data, 
+	std::size_t length )
+{
+	const int fd = ::open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if( fd < 0 )
+		return false;
+
+	bool written = true;
+	while( length > 0 && written )
+	{
+		const ssize_t put = ::write(fd, data, length);
+		written = put > 0;
+		if( written )
+		{
+			data += put;
+			length -= put;
+		}
+	}
+
+	written = written && ::fsync(fd) == 0;
+	return ::close(fd) == 0 && written;
+}
+static bool replaceImageFile( const std::string& from, const std::string& to )
+{
+	if( ::rename(from.c_str(), to.c_str()) != 0 )
+		return false;
+
+	// The rename is only on the disk once the directory holding it is synced
+	const auto slash = to.rfind('/');
+	const std::string dir = slash == std::string::npos ? "." : 
+		slash == 0 ? "/" : to.substr(0, slash);
+	const int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+	if( fd < 0 )
+		return false;
+
+	const bool synced = ::fsync(fd) == 0;
+	::close(fd);
+	return synced;
+}
+#endif
+
+/**
+ *	\brief Allocate an image that holds exactly the given size.
+ *	
+ *	\param size The measured size of the FileSystem, see FSObject::measure
+ *	
+ *	The bodies in size.bodies go at the front of the payload region, so they 
+ *	have to stay alive and unchanged until the image is filled.
+ */
+ImageWriter::ImageWriter( const ImageSize& size )
+	: bodies(size.bodies), nodeCount(size.nodeCount), 
+	payloadSize(size.payloadSize), snapshotCount(size.snapshotCount), 
+	nodeLimit(size.nodeCount)
+{
+	// The bodies are not part of the measured payload, they go before it
+	if( bodies )
+		payloadSize += bodies->getSize();
+	payloadLimit = payloadSize;
+
+	checkedSize = sizeof(ImageHeader) + nodeCount * sizeof(ImageNode) + 
+		payloadSize + snapshotCount * SNAPSHOT_NAME_SIZE;
+	blockCount = static_cast<std::uint32_t>(
+		(checkedSize + IMAGE_BLOCK_SIZE - 1) / IMAGE_BLOCK_SIZE);
+	bufferSize = checkedSize + blockCount * sizeof(std::uint32_t);
+	buffer.reset(new char[bufferSize]);
+
+	table = reinterpret_cast<ImageNode*>(buffer.get() + sizeof(ImageHeader));
+	payload = buffer.get() + sizeof(ImageHeader) + 
+		nodeCount * sizeof(ImageNode);
+	snapshots = payload + payloadSize;
+
+	if( bodies )
+	{
+		bodies->copyTo(payload);
+		payloadUsed = bodies->getSize();
+	}
+}
+
+/**
+ *	\brief Carve the next part of the image off into its own writer.
+ *	
+ *	\param size How many nodes and payload bytes the slice holds, measured just 
+ *	like the whole image.
+ *	
+ *	The slice fills in exactly the table entries and payload that this writer 
+ *	would have filled in next, and this writer skips past them.  Slices never 
+ *	overlap, so each one can be filled in by its own thread.  Once they are 
+ *	full, hand them back through joinSlice().
+ *	
+ *	\return A writer for just that part of the image.
+ */
+ImageWriter ImageWriter::slice( const ImageSize& size )
+{
+	ImageWriter part;
+	part.table = table;
+	part.payload = payload;
+	part.bodies = bodies;
+	part.nodesUsed = nodesUsed;
+	part.payloadUsed = payloadUsed;
+
+	// A slice that does not fit starts out overflowed, and so does the image
+	if( !claim(size.nodeCount, size.payloadSize) )
+	{
+		part.overflowed = true;
+		return part;
+	}
+
+	part.nodeLimit = nodesUsed + size.nodeCount;
+	part.payloadLimit = payloadUsed + size.payloadSize;
+
+	nodesUsed = part.nodeLimit;
+	payloadUsed = part.payloadLimit;
+
+	return part;
+}
+
+/**
+ *	\brief Check a slice back in once it has been filled.
+ *	
+ *	\param part A writer that slice() returned.
+ *	
+ *	If the slice did not come out exactly the size it was measured as, the whole 
+ *	image is refused by save().
+ */
+void ImageWriter::joinSlice( const ImageWriter& part )
+{
+	if( part.overflowed || part.nodesUsed != part.nodeLimit || 
+		part.payloadUsed != part.payloadLimit )
+		overflowed = true;
+}
+
+/**
+ *	\brief Claim room for more nodes and payload.
+ *	
+ *	\param nodes How many table entries are needed
+ *	\param bytes How many payload bytes are needed
+ *	
+ *	\return False if the image was measured too small for them.
+ */
+bool ImageWriter::claim( std::uint64_t nodes, std::uint64_t bytes )
+{
+	if( overflowed || nodes > nodeLimit - nodesUsed || 
+		bytes > payloadLimit - payloadUsed )
+	{
+		overflowed = true;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ *	\brief Append a node to the node table.
+ *	
+ *	\param kind What kind of FSObject the node is
+ *	\param name The name of the FSObject, at most 8 characters
+ *	\param parent Index of the Directory holding the node, or NO_PARENT
+ *	\param payload The bytes to store in the payload region, may be null
+ *	\param length How many bytes of payload there are
+ *	\param flags Any of NodeFlags, describing the payload
+ *	\param generation The generation the FSObject was made in
+ *	\param replaced The generation the FSObject was replaced in, 
+ *	LIVE_GENERATION if it never was
+ *	
+ *	A null payload leaves the node's payload for the caller to fill in through 
+ *	getPayload().
+ *	
+ *	\return The index of the new node in the table
+ */
+std::uint32_t ImageWriter::addNode( NodeKind kind, const Name& name, 
+	std::uint32_t parent, const char* payload, std::size_t length, 
+	std::uint8_t flags, std::uint32_t generation, std::uint32_t replaced )
+{
+	if( !claim(1, length) )
+		return 0;
+
+	ImageNode& node = table[nodesUsed];
+	std::memset(&node, 0, sizeof(node));
+	node.parent = parent;
+	node.kind = kind;
+	node.flags = flags;
+	node.generation = static_cast<std::uint16_t>(generation);
+
+	// Only Directories have children, so the count doubles as the generation
+	if( replaced != LIVE_GENERATION )
+	{
+		node.flags |= NODE_REPLACED;
+		node.childCount = replaced;
+	}
+
+	// Names are already null padded to 8 chars, just like the version 1 
+	//	records
+	std::memcpy(node.name, name.data(), Name::SIZE);
+
+	// Text and program data goes into the payload region
+	node.payloadOffset = payloadUsed;
+	node.payloadLength = length;
+	if( length && payload )
+		std::memcpy(this->payload + payloadUsed, payload, length);
+	payloadUsed += length;
+
+	return static_cast<std::uint32_t>(nodesUsed++);
+}
+
+/**
+ *	\brief Append a TextFile node, whose body is already in the image.
+ *	
+ *	\param name The name of the TextFile, at most 8 characters
+ *	\param parent Index of the Directory holding the node
+ *	\param body The body, exactly as it was added to the ImageBodies
+ *	\param length How many bytes are in the body
+ *	\param flags Any of NodeFlags, describing the body
+ *	\param generation The generation the TextFile was made in
+ *	\param replaced The generation the TextFile was replaced in, 
+ *	LIVE_GENERATION if it never was
+ *	
+ *	The node takes up no payload of its own, it points at the copy of the body 
+ *	that every TextFile with the same bytes shares.
+ *	
+ *	\return The index of the new node in the table
+ */
+std::uint32_t ImageWriter::addText( const Name& name, std::uint32_t parent, 
+	const char* body, std::size_t length, std::uint8_t flags, 
+	std::uint32_t generation, std::uint32_t replaced )
+{
+	// A body that was never measured would have no room in the image
+	std::uint64_t offset;
+	if( !bodies || !bodies->find(body, length, flags, offset) )
+	{
+		overflowed = true;
+		return 0;
+	}
+
+	const auto index = addNode(NODE_TEXT, name, parent, nullptr, 0, flags, 
+		generation, replaced);
+	if( !overflowed )
+	{
+		table[index].payloadOffset = offset;
+		table[index].payloadLength = length;
+	}
+
+	return index;
+}
+
+/**
+ *	\brief Find where a node's payload goes.
+ *	
+ *	\param index The index that addNode() returned for the node
+ *	
+ *	\return The first byte of the payload, null if the image overflowed.
+ */
+char* ImageWriter::getPayload( std::uint32_t index )
+{
+	if( overflowed )
+		return nullptr;
+
+	return payload + table[index].payloadOffset;
+}
+
+/**
+ *	\brief Finish a Directory once all of its children have been added.
+ *	
+ *	\param index The index that addNode() returned for the Directory
+ *	\param childCount How many direct children the Directory has
+ */
+void ImageWriter::closeDirectory( std::uint32_t index, std::uint32_t childCount )
+{
+	if( overflowed )
+		return;
+
+	// Everything added since the Directory is part of its subtree
+	table[index].childCount = childCount;
+	table[index].subtreeSize = static_cast<std::uint32_t>(nodesUsed - index - 1);
+}
+
+//! The NodeFlags that say how a TextFile body is stored, rather than 
+//!	anything about the node
+static const std::uint8_t BODY_FLAGS = NODE_COMPRESSED | NODE_FRAMED;
+
+/**
+ *	\brief Does a node in an existing image have a payload that is really 
+ *	inside of that image's payload region?
+ *	
+ *	\param node The node to check
+ *	\param layout The layout of the image the node came from
+ *	
+ *	\return True if the payload can be copied.
+ */
+static bool validPayload( const ImageNode& node, const ImageLayout& layout )
+{
+	return node.payloadOffset <= layout.payloadSize && 
+		node.payloadLength <= layout.payloadSize - node.payloadOffset;
+}
+
+/**
+ *	\brief How many entries make up a subtree of an existing image.
+ *	
+ *	\param layout The layout of the image
+ *	\param index The entry of the subtree's root
+ *	
+ *	\return The subtree's root plus all of its descendants that are in the 
+ *	table.
+ */
+static std::uint32_t subtreeCount( const ImageLayout& layout, 
+	std::uint32_t index )
+{
+	return static_cast<std::uint32_t>(std::min<std::uint64_t>(
+		layout.table[index].subtreeSize, layout.nodeCount - index - 1) + 1);
+}
+
+/**
+ *	\brief Measure a subtree that is still stored in an existing image.
+ *	
+ *	\param image The image that holds the subtree.
+ *	\param index The entry of the subtree's root in the image's table.
+ *	\param size Accumulates what copySubtree() will write for it, and the 
+ *	TextFile bodies it shares.
+ */
+void ImageWriter::measureSubtree( const ImageFile& image, std::uint32_t index, 
+	ImageSize& size )
+{
+	ImageLayout layout;
+	if( !ImageReader::getLayout(image, layout) || index >= layout.nodeCount )
+		return;
+
+	const std::uint32_t count = subtreeCount(layout, index);
+	size.nodeCount += count;
+
+	for( std::uint32_t i = 0; i < count; i++)
+	{
+		const ImageNode& node = layout.table[index + i];
+
+		// Bodies are stored once for the whole image, not in the subtree
+		if( node.kind == NODE_TEXT )
+		{
+			if( size.bodies && validPayload(node, layout) )
+				size.bodies->add(layout.payload + node.payloadOffset, 
+					static_cast<std::size_t>(node.payloadLength), 
+					node.flags & BODY_FLAGS);
+			continue;
+		}
+
+		if( validPayload(node, layout) )
+			size.payloadSize += node.payloadLength;
+	}
+}
+
+/**
+ *	\brief Copy a whole subtree out of an existing indexed image.
+ *	
+ *	\param image The image that holds the subtree.
+ *	\param index The entry of the subtree's root in the image's table.
+ *	\param parent Index of the Directory that the subtree is added to
+ *	
+ *	The subtree's payload is copied through byte-for-byte and its table entries 
+ *	are copied as one block, only their parent indices and payload offsets are 
+ *	moved to their new positions.  TextFile bodies are pointed at the image's 
+ *	shared copies instead.
+ */
+void ImageWriter::copySubtree( const ImageFile& image, std::uint32_t index, 
+	std::uint32_t parent )
+{
+	ImageLayout layout;
+	if( !ImageReader::getLayout(image, layout) || index >= layout.nodeCount )
+		return;
+
+	const ImageNode* first = layout.table + index;
+	const std::uint32_t count = subtreeCount(layout, index);
+
+	// Payloads written in pre-order follow each other with no gaps, so the 
+	//	subtree's payload is usually one span that can be copied whole
+	bool contiguous = true;
+	bool found = false;
+	std::uint64_t low = 0;
+	std::uint64_t high = 0;
+	std::uint64_t total = 0;
+	for( std::uint32_t i = 0; i < count; i++)
+	{
+		const ImageNode& node = first[i];
+		if( node.kind == NODE_TEXT )
+			continue;
+
+		if( node.payloadLength == 0 || !validPayload(node, layout) )
+			continue;
+
+		if( !found )
+			low = high = node.payloadOffset;
+		found = true;
+
+		contiguous = contiguous && node.payloadOffset == high;
+		high = node.payloadOffset + node.payloadLength;
+		total += node.payloadLength;
+	}
+
+	if( !claim(count, total) )
+		return;
+
+	const std::uint64_t base = nodesUsed;
+	const std::uint64_t start = payloadUsed;
+	if( contiguous && found )
+	{
+		std::memcpy(payload + payloadUsed, layout.payload + low, high - low);
+		payloadUsed += high - low;
+	}
+
+	std::memcpy(table + base, first, count * sizeof(ImageNode));
+	nodesUsed += count;
+
+	table[base].parent = parent;
+	table[base].subtreeSize = count - 1;
+
+	for( std::uint32_t i = 0; i < count; i++)
+	{
+		ImageNode& node = table[base + i];
+
+		// Parents are inside the subtree, so they all move by the same amount
+		if( i > 0 )
+			node.parent = static_cast<std::uint32_t>(
+				node.parent >= index && node.parent < index + i ? 
+				node.parent - index + base : base);
+
+		// Bodies were added to the image while the subtree was measured
+		if( first[i].kind == NODE_TEXT )
+		{
+			std::uint64_t offset = 0;
+			if( !validPayload(first[i], layout) )
+				node.payloadLength = 0;
+			else if( !bodies || !bodies->find(
+				layout.payload + first[i].payloadOffset, 
+				static_cast<std::size_t>(first[i].payloadLength), 
+				first[i].flags & BODY_FLAGS, offset) )
+				overflowed = true;
+			node.payloadOffset = offset;
+			continue;
+		}
+
+		if( !validPayload(node, layout) )
+			node.payloadLength = 0;
+
+		// Inside the copied span, everything moves by the same amount
+		if( contiguous && found && node.payloadOffset >= low && 
+			node.payloadOffset + node.payloadLength <= high )
+			node.payloadOffset = node.payloadOffset - low + start;
+		else if( node.payloadLength == 0 )
+			node.payloadOffset = contiguous ? start : payloadUsed;
+		else
+		{
+			// Scattered payloads are copied one at a time
+			std::memcpy(payload + payloadUsed, 
+				layout.payload + node.payloadOffset, node.payloadLength);
+			node.payloadOffset = payloadUsed;
+			payloadUsed += node.payloadLength;
+		}
+	}
+}
+
+/**
+ *	\brief Write the totals of a Directory's subtree as its payload.
+ *	
+ *	\param totals The totals.
+ *	\param payload Gets DIRECTORY_PAYLOAD_SIZE bytes: the node count, text 
+ *	bytes, program count and program memory.
+ */
+void ImageWriter::packTotals( const SubtreeTotals& totals, char* payload )
+{
+	const std::uint64_t fields[4] = { totals.nodes, totals.textBytes, 
+		totals.programs, static_cast<std::uint64_t>(totals.programMemory) };
+	std::memcpy(payload, fields, sizeof(fields));
+}
+
+/**
+ *	\brief Append a name to the snapshot region.
+ *	
+ *	\param name The snapshot's name, at most 8 characters
+ *	
+ *	Snapshots have to be added in the order they were taken, since a 
+ *	snapshot's generation is its position.
+ */
+void ImageWriter::addSnapshot( const std::string& name )
+{
+	if( !buffer || snapshotsUsed >= snapshotCount )
+	{
+		overflowed = true;
+		return;
+	}
+
+	char* entry = snapshots + snapshotsUsed++ * SNAPSHOT_NAME_SIZE;
+	std::memset(entry, 0, SNAPSHOT_NAME_SIZE);
+	std::memcpy(entry, name.data(), 
+		std::min<std::size_t>(name.length(), SNAPSHOT_NAME_SIZE));
+}
+
+/**
+ *	\brief Record which journal records are folded into this image.
+ *	
+ *	\param sequence The last journal record the image includes.
+ */
+void ImageWriter::setJournalSequence( std::uint64_t sequence )
+{
+	journalSequence = sequence;
+}
+
+/**
+ *	\brief Write the image to disk.
+ *	
+ *	\param filename Where to write the image.
+ *	
+ *	The image is written beside the destination, synced, and renamed over it 
+ *	once it is complete, so the old image stays intact (and safe to keep 
+ *	mapped) until the new one is ready.  The rename is synced too, so when 
+ *	this returns true the new image is on the disk for good.
+ *	
+ *	\return True if the image was saved.
+ */
+bool ImageWriter::save( const std::string& filename )
+{
+	// Never write an image that does not match what was measured
+	if( !buffer || overflowed || nodesUsed != nodeCount || 
+		payloadUsed != payloadSize || snapshotsUsed != snapshotCount )
+		return false;
+
+	// The table follows the header, the payload follows the table and the 
+	//	snapshot names follow the payload
+	ImageHeader header = {};
+	std::memcpy(header.magic, IMAGE_MAGIC, sizeof(header.magic));
+	header.version = IMAGE_VERSION;
+	header.nodeCount = static_cast<std::uint32_t>(nodeCount);
+	header.tableOffset = sizeof(ImageHeader);
+	header.payloadOffset = header.tableOffset + nodeCount * sizeof(ImageNode);
+	header.payloadSize = payloadSize;
+	header.journalSequence = journalSequence;
+	header.checksumOffset = checkedSize;
+	header.blockSize = IMAGE_BLOCK_SIZE;
+	header.blockCount = blockCount;
+	header.snapshotOffset = header.payloadOffset + payloadSize;
+	header.snapshotCount = static_cast<std::uint32_t>(snapshotCount);
+	std::memcpy(buffer.get(), &header, sizeof(header));
+
+	// The checksums follow everything they cover, header included
+	for( std::uint32_t b = 0; b < blockCount; b++)
+	{
+		const std::size_t offset = static_cast<std::size_t>(b) * IMAGE_BLOCK_SIZE;
+		const std::uint32_t crc = crc32c(buffer.get() + offset, 
+			std::min<std::size_t>(IMAGE_BLOCK_SIZE, checkedSize - offset));
+		std::memcpy(buffer.get() + checkedSize + b * sizeof(crc), &crc, 
+			sizeof(crc));
+	}
+
+	// The whole image goes out in one write
+	const std::string tempName = filename + ".tmp";
+	if( !writeImageFile(tempName, buffer.get(), bufferSize) )
+		return false;
+
+	return replaceImageFile(tempName, filename);
+}
@@ -0,0 +1,267 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <string>
+#include <memory>
+#include <cstddef>
+#include "ImageFormat.h"
+#include "Name.h"
+#include "ImageFile.h"
+#include "FSObject.h"
+
+/**
+ *	\brief Encodes a FileSystem into the current indexed image format.
+ *	
+ *	The FileSystem is measured first, so the writer can allocate the exact 
+ *	image as one contiguous buffer.  FSObjects then copy themselves into it in 
+ *	pre-order through writeToFile(), and save() checksums the buffer and 
+ *	writes it to disk with a single write.  The distinct TextFile bodies that 
+ *	were collected while measuring are copied in first, and TextFiles point 
+ *	at them through addText().
+ */
+class ImageWriter
+{
+public:
+	/**
+	 *	\brief Allocate an image that holds exactly the given size.
+	 *	
+	 *	\param size The measured size of the FileSystem, see FSObject::measure
+	 *	
+	 *	The bodies in size.bodies go at the front of the payload region, so 
+	 *	they have to stay alive and unchanged until the image is filled.
+	 */
+	explicit ImageWriter( const ImageSize& size );
+
+	/**
+	 *	\brief Carve the next part of the image off into its own writer.
+	 *	
+	 *	\param size How many nodes and payload bytes the slice holds, measured 
+	 *	just like the whole image.
+	 *	
+	 *	The slice fills in exactly the table entries and payload that this 
+	 *	writer would have filled in next, and this writer skips past them.  
+	 *	Slices never overlap, so each one can be filled in by its own thread.  
+	 *	Once they are full, hand them back through joinSlice().
+	 *	
+	 *	\return A writer for just that part of the image.
+	 */
+	ImageWriter slice( const ImageSize& size );
+
+	/**
+	 *	\brief Check a slice back in once it has been filled.
+	 *	
+	 *	\param part A writer that slice() returned.
+	 *	
+	 *	If the slice did not come out exactly the size it was measured as, the 
+	 *	whole image is refused by save().
+	 */
+	void joinSlice( const ImageWriter& part );
+
+	/**
+	 *	\brief Append a node to the node table.
+	 *	
+	 *	\param kind What kind of FSObject the node is
+	 *	\param name The name of the FSObject, at most 8 characters
+	 *	\param parent Index of the Directory holding the node, or NO_PARENT
+	 *	\param payload The bytes to store in the payload region, may be null
+	 *	\param length How many bytes of payload there are
+	 *	\param flags Any of NodeFlags, describing the payload
+	 *	\param generation The generation the FSObject was made in
+	 *	\param replaced The generation the FSObject was replaced in, 
+	 *	LIVE_GENERATION if it never was
+	 *	
+	 *	A null payload leaves the node's payload for the caller to fill in 
+	 *	through getPayload().
+	 *	
+	 *	\return The index of the new node in the table
+	 */
+	std::uint32_t addNode( NodeKind kind, const Name& name, 
+		std::uint32_t parent, const char* payload, std::size_t length, 
+		std::uint8_t flags = 0, std::uint32_t generation = 0, 
+		std::uint32_t replaced = LIVE_GENERATION );
+
+	/**
+	 *	\brief Append a TextFile node, whose body is already in the image.
+	 *	
+	 *	\param name The name of the TextFile, at most 8 characters
+	 *	\param parent Index of the Directory holding the node
+	 *	\param body The body, exactly as it was added to the ImageBodies
+	 *	\param length How many bytes are in the body
+	 *	\param flags Any of NodeFlags, describing the body
+	 *	\param generation The generation the TextFile was made in
+	 *	\param replaced The generation the TextFile was replaced in, 
+	 *	LIVE_GENERATION if it never was
+	 *	
+	 *	The node takes up no payload of its own, it points at the copy of the 
+	 *	body that every TextFile with the same bytes shares.
+	 *	
+	 *	\return The index of the new node in the table
+	 */
+	std::uint32_t addText( const Name& name, std::uint32_t parent, 
+		const char* body, std::size_t length, std::uint8_t flags, 
+		std::uint32_t generation, std::uint32_t replaced );
+
+	/**
+	 *	\brief Find where a node's payload goes.
+	 *	
+	 *	\param index The index that addNode() returned for the node
+	 *	
+	 *	\return The first byte of the payload, null if the image overflowed.
+	 */
+	char* getPayload( std::uint32_t index );
+
+	/**
+	 *	\brief Finish a Directory once all of its children have been added.
+	 *	
+	 *	\param index The index that addNode() returned for the Directory
+	 *	\param childCount How many direct children the Directory has
+	 */
+	void closeDirectory( std::uint32_t index, std::uint32_t childCount );
+
+	/**
+	 *	\brief Copy a whole subtree out of an existing indexed image.
+	 *	
+	 *	\param image The image that holds the subtree.
+	 *	\param index The entry of the subtree's root in the image's table.
+	 *	\param parent Index of the Directory that the subtree is added to
+	 *	
+	 *	The subtree's payload is copied through byte-for-byte and its table 
+	 *	entries are copied as one block, only their parent indices and payload 
+	 *	offsets are moved to their new positions.  TextFile bodies are pointed 
+	 *	at the image's shared copies instead.
+	 */
+	void copySubtree( const ImageFile& image, std::uint32_t index, 
+		std::uint32_t parent );
+
+	/**
+	 *	\brief Measure a subtree that is still stored in an existing image.
+	 *	
+	 *	\param image The image that holds the subtree.
+	 *	\param index The entry of the subtree's root in the image's table.
+	 *	\param size Accumulates what copySubtree() will write for it, and 
+	 *	the TextFile bodies it shares.
+	 */
+	static void measureSubtree( const ImageFile& image, std::uint32_t index, 
+		ImageSize& size );
+
+	/**
+	 *	\brief Write the totals of a Directory's subtree as its payload.
+	 *	
+	 *	\param totals The totals.
+	 *	\param payload Gets DIRECTORY_PAYLOAD_SIZE bytes: the node count, 
+	 *	text bytes, program count and program memory.
+	 */
+	static void packTotals( const SubtreeTotals& totals, char* payload );
+
+	/**
+	 *	\brief Write the image to disk.
+	 *	
+	 *	\param filename Where to write the image.
+	 *	
+	 *	The image is written beside the destination and renamed over it once it 
+	 *	is complete, so the old image stays intact (and safe to keep mapped) 
+	 *	until the new one is ready.
+	 *	
+	 *	\return True if the image was saved.
+	 */
+	bool save( const std::string& filename );
+
+	/**
+	 *	\brief Append a name to the snapshot region.
+	 *	
+	 *	\param name The snapshot's name, at most 8 characters
+	 *	
+	 *	Snapshots have to be added in the order they were taken, since a 
+	 *	snapshot's generation is its position.
+	 */
+	void addSnapshot( const std::string& name );
+
+	/**
+	 *	\brief Record which journal records are folded into this image.
+	 *	
+	 *	\param sequence The last journal record the image includes.
+	 */
+	void setJournalSequence( std::uint64_t sequence );
+
+private:
+	/**
+	 *	\brief Claim room for more nodes and payload.
+	 *	
+	 *	\param nodes How many table entries are needed
+	 *	\param bytes How many payload bytes are needed
+	 *	
+	 *	\return False if the image was measured too small for them.
+	 */
+	bool claim( std::uint64_t nodes, std::uint64_t bytes );
+
+	/**
+	 *	\brief A writer over part of another writer's buffer, see slice().
+	 */
+	ImageWriter() = default;
+
+	//! The whole image: header, node table and then payload.  It is left 
+	//!	uninitialized since every byte of it gets written.  Slices do not own 
+	//!	a buffer.
+	std::unique_ptr<char[]> buffer;
+
+	//! Number of bytes in the buffer
+	std::size_t bufferSize = 0;
+
+	//! Number of bytes covered by the block checksums, the rest of the 
+	//!	buffer holds the checksums themselves
+	std::size_t checkedSize = 0;
+
+	//! Number of block checksums at the end of the buffer
+	std::uint32_t blockCount = 0;
+
+	//! The node table inside of the buffer
+	ImageNode* table = nullptr;
+
+	//! The payload region inside of the buffer
+	char* payload = nullptr;
+
+	//! The snapshot names inside of the buffer
+	char* snapshots = nullptr;
+
+	//! The TextFile bodies at the front of the payload region, null if the 
+	//!	image has none
+	const ImageBodies* bodies = nullptr;
+
+	//! Number of entries the table was measured to hold
+	std::uint64_t nodeCount = 0;
+
+	//! Number of bytes the payload region was measured to hold
+	std::uint64_t payloadSize = 0;
+
+	//! Entries filled in so far
+	std::uint64_t nodesUsed = 0;
+
+	//! Payload bytes filled in so far
+	std::uint64_t payloadUsed = 0;
+
+	//! Number of snapshot names the image was measured to hold
+	std::uint64_t snapshotCount = 0;
+
+	//! Snapshot names filled in so far
+	std::uint64_t snapshotsUsed = 0;
+
+	//! Entry that this writer has to stop before
+	std::uint64_t nodeLimit = 0;
+
+	//! Payload byte that this writer has to stop before
+	std::uint64_t payloadLimit = 0;
+
+	//! Set if something did not fit in the measured image
+	bool overflowed = false;
+
+	//! The last journal record folded into the image
+	std::uint64_t journalSequence = 0;
+};
+
+#endif
@@ -0,0 +1,330 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "Import.h"
+#include "HostFS.h"
+#include "Directory.h"
+#include "TextFile.h"
+#include "Journal.h"
+#include "NodeArena.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+/**
+ *	\brief Make a host name into one that validName() accepts.
+ *	
+ *	\param hostName The name on the host, like "main.cpp".
+ *	\param directory Is it for a Directory?  Their names can only have 
+ *	letters, TextFile names can have digits too.
+ *	
+ *	The extension is dropped, along with every character that is not 
+ *	allowed, and what is left is cut to 8 characters.
+ *	
+ *	\return The name, never empty.
+ */
+std::string Importer::sanitize( const std::string& hostName, bool directory )
+{
+	// A leading dot is a hidden file, not an extension
+	std::string stem = hostName;
+	const auto dot = stem.rfind('.');
+	if( dot != std::string::npos && dot > 0 )
+		stem.erase(dot);
+
+	std::string name;
+	for( const char c : stem)
+	{
+		const bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+		const bool digit = c >= '0' && c <= '9';
+		if( letter || (digit && !directory) )
+			name += c;
+
+		if( name.length() == Name::SIZE )
+			break;
+	}
+
+	if( name.empty() )
+		name = directory ? "dir" : "file";
+
+	return name;
+}
+
+/**
+ *	\brief Copy everything in a host directory into a Directory.
+ *	
+ *	\param hostPath The host directory.
+ *	\param into The Directory to copy it into, in the live FileSystem.
+ *	\param generation The generation the new FSObjects are made in.
+ *	\param pool The threads to read the host files on.
+ *	\param journal Gets a record of every new FSObject, as one batch.
+ *	
+ *	\return False if the host directory could not be read.
+ */
+bool Importer::run( const std::string& hostPath, Directory* into, 
+	std::uint32_t generation, ThreadPool& pool, Journal& journal )
+{
+	directoryCount = 0;
+	fileCount = 0;
+	byteCount = 0;
+	skippedCount = 0;
+
+	if( !isHostDirectory(hostPath) )
+		return false;
+
+	entries.clear();
+	entries.push_back(Entry{hostPath, Name(), true, 0, 0, nullptr});
+
+	scan(into);
+	readFiles(pool);
+	build(into, generation, journal);
+
+	// The TextFiles hold on to the bodies they need
+	std::vector<Entry>().swap(entries);
+	return true;
+}
+
+/**
+ *	\return How many Directories the last run() made.
+ */
+std::uint64_t Importer::getDirectoryCount() const
+{
+	return directoryCount;
+}
+
+/**
+ *	\return How many TextFiles the last run() made.
+ */
+std::uint64_t Importer::getFileCount() const
+{
+	return fileCount;
+}
+
+/**
+ *	\return How many bytes the TextFiles the last run() made hold.
+ */
+std::uint64_t Importer::getByteCount() const
+{
+	return byteCount;
+}
+
+/**
+ *	\return How many host files and directories the last run() left out, 
+ *	because they were too large, not text or could not be read.
+ */
+std::uint64_t Importer::getSkippedCount() const
+{
+	return skippedCount;
+}
+
+/**
+ *	\brief List every host directory under the first entry, adding what is 
+ *	in each one to entries.
+ *	
+ *	\param into The Directory the first entry is imported into, its 
+ *	children's names are already taken.
+ *	
+ *	Directories are listed in the order they were found, so the children of 
+ *	each one end up together and always after their parent.
+ */
+void Importer::scan( Directory* into )
+{
+	std::vector<HostEntry> listed;
+
+	for( std::size_t i = 0; i < entries.size(); i++)
+	{
+		if( !entries[i].directory )
+			continue;
+
+		// An unreadable directory is still made, it is just left empty
+		entries[i].firstChild = static_cast<std::uint32_t>(entries.size());
+		if( !listHostDirectory(entries[i].hostPath, listed) )
+		{
+			skippedCount++;
+			continue;
+		}
+
+		// Directories and TextFiles are looked up separately, so they can 
+		//	share a name
+		std::unordered_set<std::uint64_t> taken[2];
+		Directory* existing = i == 0 ? into : nullptr;
+
+		for( const auto& host : listed)
+		{
+			const Name name = pickName(host.name, host.directory, 
+				taken[host.directory], existing);
+			entries.push_back(Entry{joinHostPath(entries[i].hostPath, 
+				host.name), name, host.directory, 0, 0, nullptr});
+		}
+
+		entries[i].childCount = static_cast<std::uint32_t>(entries.size()) - 
+			entries[i].firstChild;
+	}
+}
+
+/**
+ *	\brief Pick the name a host entry gets, one that nothing else in its 
+ *	Directory has.
+ *	
+ *	\param hostName The name on the host.
+ *	\param directory Is it a directory?
+ *	\param taken The names already used in the Directory, gets the new one.
+ *	\param existing The Directory, if it already has children, or null.
+ *	
+ *	A name that is taken gets a number on the end, or letters for a 
+ *	Directory, cutting it short if it has to.
+ *	
+ *	\return The name.
+ */
+Name Importer::pickName( const std::string& hostName, bool directory, 
+	std::unordered_set<std::uint64_t>& taken, Directory* existing )
+{
+	const std::string base = sanitize(hostName, directory);
+	std::string candidate = base;
+
+	for( std::uint32_t n = 1; ; n++)
+	{
+		const Name name(candidate);
+		const bool used = taken.count(name.key()) || (existing && 
+			(directory ? static_cast<FSObject*>(existing->getDirectory( 
+				candidate)) : existing->getTextfile(candidate)));
+		if( !used )
+		{
+			taken.insert(name.key());
+			return name;
+		}
+
+		std::string suffix;
+		if( directory )
+			for( std::uint32_t k = n; k > 0; k = (k - 1) / 26)
+				suffix.insert(suffix.begin(), static_cast<char>('a' + 
+					(k - 1) % 26));
+		else
+			suffix = std::to_string(n);
+
+		candidate = base.substr(0, Name::SIZE - suffix.length()) + suffix;
+	}
+}
+
+/**
+ *	\brief Read every file in entries, spread across a pool.
+ *	
+ *	\param pool The threads to read on.
+ *	
+ *	Each body is interned on the worker that read it, so hashing it does not 
+ *	hold up the thread that builds the tree.  A file with a null byte in it is 
+ *	not text, and is left out.
+ */
+void Importer::readFiles( ThreadPool& pool )
+{
+	std::vector<std::uint32_t> files;
+	for( std::uint32_t i = 0; i < entries.size(); i++)
+		if( !entries[i].directory )
+			files.push_back(i);
+
+	const std::uint32_t count = static_cast<std::uint32_t>(files.size());
+	const std::uint32_t chunks = (count + CHUNK_FILES - 1) / CHUNK_FILES;
+	std::atomic<std::uint32_t> next(0);
+
+	// Each worker keeps claiming the next chunk until they are all taken
+	const int tasks = std::min<std::uint32_t>(chunks, pool.getThreadCount());
+	for( int i = 0; i < tasks; i++)
+	{
+		pool.submit([&]
+		{
+			std::string contents;
+			for( std::uint32_t chunk = next++; chunk < chunks; chunk = next++)
+			{
+				const std::uint32_t last = std::min(count, 
+					(chunk + 1) * CHUNK_FILES);
+				for( std::uint32_t f = chunk * CHUNK_FILES; f < last; f++)
+				{
+					Entry& entry = entries[files[f]];
+					if( readHostFile(entry.hostPath, MAX_TEXT_SIZE, contents)
+						== HOST_READ_OK && !std::memchr(contents.data(), '\0', 
+							contents.length()) )
+						entry.body = BlobStore::intern(std::move(contents));
+
+					contents.clear();
+				}
+			}
+		});
+	}
+
+	pool.wait();
+}
+
+/**
+ *	\brief Make the FSObjects for entries, and journal them.
+ *	
+ *	\param into The Directory the first entry is imported into.
+ *	\param generation The generation they are made in.
+ *	\param journal Gets a record of every new FSObject.
+ *	
+ *	The names were picked to be valid, so nothing is checked or printed 
+ *	again.  Each Directory gets all of its children in one addObjects(), and 
+ *	the records are written out as one batch.
+ */
+void Importer::build( Directory* into, std::uint32_t generation, 
+	Journal& journal )
+{
+	NodeArena& arena = into->getArena();
+
+	// The Directory made for each directory entry
+	std::vector<Directory*> made(entries.size(), nullptr);
+	made[0] = into;
+
+	std::vector<FSObject*> batch;
+	journal.beginBatch();
+
+	for( std::size_t i = 0; i < entries.size(); i++)
+	{
+		Directory* parent = made[i];
+		if( !parent )
+			continue;
+
+		batch.clear();
+		const Entry& dir = entries[i];
+		for( std::uint32_t c = dir.firstChild;
+			c < dir.firstChild + dir.childCount; c++)
+		{
+			Entry& child = entries[c];
+			if( child.directory )
+			{
+				Directory* d = Directory::CreateDirectory(arena, 
+					child.name.str(), parent);
+				d->setGeneration(generation);
+				made[c] = d;
+				batch.push_back(d);
+				directoryCount++;
+			}
+			else if( child.body )
+			{
+				byteCount += child.body->getBytes().length();
+				TextFile* t = arena.make<TextFile>(child.name.str(), 
+					std::move(child.body));
+				t->setGeneration(generation);
+				batch.push_back(t);
+				fileCount++;
+			}
+			else
+				skippedCount++;
+		}
+
+		parent->addObjects(batch);
+
+		for( const auto obj : batch)
+		{
+			if( obj->getKind() == NODE_DIRECTORY )
+				journal.recordDirectory(parent, *static_cast<Directory*>(obj));
+			else
+				journal.recordTextFile(parent, *static_cast<TextFile*>(obj));
+		}
+	}
+
+	journal.endBatch();
+}
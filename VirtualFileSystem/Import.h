@@ -0,0 +1,167 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef IMPORT_H
+#define IMPORT_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_set>
+#include <cstddef>
+#include <cstdint>
+#include "Name.h"
+#include "BlobStore.h"
+
+class Directory;
+class Journal;
+class ThreadPool;
+
+/**
+ *	\brief Copies a directory tree from the host into the FileSystem, host 
+ *	directories become Directories and small text files become TextFiles.
+ *	
+ *	The host tree is listed first, and every name is made to fit the rules of 
+ *	validName() on the way.  Then the files are read across a ThreadPool, each 
+ *	worker claiming CHUNK_FILES at a time, and their bodies are interned there 
+ *	too.  Last, the FSObjects are made on the calling thread and added to each 
+ *	Directory as one batch, without any of the prompts or printing that 
+ *	making them one at a time has.
+ */
+class Importer
+{
+public:
+	//! The largest host file that is made into a TextFile
+	static const std::size_t MAX_TEXT_SIZE = 1024 * 1024;
+
+	//! How many files a worker claims at a time
+	static const std::uint32_t CHUNK_FILES = 64;
+
+	/**
+	 *	\brief Make a host name into one that validName() accepts.
+	 *	
+	 *	\param hostName The name on the host, like "main.cpp".
+	 *	\param directory Is it for a Directory?  Their names can only have 
+	 *	letters, TextFile names can have digits too.
+	 *	
+	 *	The extension is dropped, along with every character that is not 
+	 *	allowed, and what is left is cut to 8 characters.
+	 *	
+	 *	\return The name, never empty.
+	 */
+	static std::string sanitize( const std::string& hostName, bool directory );
+
+	/**
+	 *	\brief Copy everything in a host directory into a Directory.
+	 *	
+	 *	\param hostPath The host directory.
+	 *	\param into The Directory to copy it into, in the live FileSystem.
+	 *	\param generation The generation the new FSObjects are made in.
+	 *	\param pool The threads to read the host files on.
+	 *	\param journal Gets a record of every new FSObject, as one batch.
+	 *	
+	 *	\return False if the host directory could not be read.
+	 */
+	bool run( const std::string& hostPath, Directory* into, 
+		std::uint32_t generation, ThreadPool& pool, Journal& journal );
+
+	/**
+	 *	\return How many Directories the last run() made.
+	 */
+	std::uint64_t getDirectoryCount() const;
+
+	/**
+	 *	\return How many TextFiles the last run() made.
+	 */
+	std::uint64_t getFileCount() const;
+
+	/**
+	 *	\return How many bytes the TextFiles the last run() made hold.
+	 */
+	std::uint64_t getByteCount() const;
+
+	/**
+	 *	\return How many host files and directories the last run() left out, 
+	 *	because they were too large, not text or could not be read.
+	 */
+	std::uint64_t getSkippedCount() const;
+
+private:
+	/**
+	 *	\brief Something on the host that is being imported.
+	 */
+	struct Entry
+	{
+		//! Where it is on the host
+		std::string hostPath;
+		//! What it will be called in the FileSystem
+		Name name;
+		//! Is it a directory?
+		bool directory;
+		//! Where a directory's children start in entries
+		std::uint32_t firstChild;
+		//! How many children a directory has
+		std::uint32_t childCount;
+		//! The body of a file, null if it was left out
+		std::shared_ptr<const Blob> body;
+	};
+
+	/**
+	 *	\brief List every host directory under the first entry, adding what 
+	 *	is in each one to entries.
+	 *	
+	 *	\param into The Directory the first entry is imported into, its 
+	 *	children's names are already taken.
+	 */
+	void scan( Directory* into );
+
+	/**
+	 *	\brief Pick the name a host entry gets, one that nothing else in its 
+	 *	Directory has.
+	 *	
+	 *	\param hostName The name on the host.
+	 *	\param directory Is it a directory?
+	 *	\param taken The names already used in the Directory, gets the new one.
+	 *	\param existing The Directory, if it already has children, or null.
+	 *	
+	 *	\return The name.
+	 */
+	static Name pickName( const std::string& hostName, bool directory, 
+		std::unordered_set<std::uint64_t>& taken, Directory* existing );
+
+	/**
+	 *	\brief Read every file in entries, spread across a pool.
+	 *	
+	 *	\param pool The threads to read on.
+	 */
+	void readFiles( ThreadPool& pool );
+
+	/**
+	 *	\brief Make the FSObjects for entries, and journal them.
+	 *	
+	 *	\param into The Directory the first entry is imported into.
+	 *	\param generation The generation they are made in.
+	 *	\param journal Gets a record of every new FSObject.
+	 */
+	void build( Directory* into, std::uint32_t generation, Journal& journal );
+
+	//! Everything being imported, the children of each directory together
+	std::vector<Entry> entries;
+
+	//! How many Directories the last run() made
+	std::uint64_t directoryCount = 0;
+
+	//! How many TextFiles the last run() made
+	std::uint64_t fileCount = 0;
+
+	//! How many bytes the TextFiles hold
+	std::uint64_t byteCount = 0;
+
+	//! How many host files and directories were left out
+	std::uint64_t skippedCount = 0;
+};
+
+#endif
@@ -0,0 +1,494 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "Journal.h"
+#include "ImageFile.h"
+#include "Directory.h"
+#include "TextFile.h"
+#include "ProgramFile.h"
+#include "Snapshots.h"
+#include "NodeArena.h"
+
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/**
+ *	The journal is written with unbuffered descriptor I/O so that every record 
+ *	reaches the OS as soon as it is made, and so that it can be synced and cut 
+ *	short.  These wrap the few calls that are spelled differently on Windows.
+ */
+#ifdef _WIN32
+static int openLog( const char* name )
+{
+	return _open(name, _O_RDWR | _O_CREAT | _O_APPEND | _O_BINARY, 
+		_S_IREAD | _S_IWRITE);
+}
+static void writeLog( int fd, const char* data, std::size_t length )
+{
+	_write(fd, data, static_cast<unsigned>(length));
+}
+static void syncLog( int fd ) { _commit(fd); }
+static void truncateLog( int fd, std::size_t length ) { _chsize(fd, length); }
+static void closeLog( int fd ) { _close(fd); }
+#else
+static int openLog( const char* name )
+{
+	return ::open(name, O_RDWR | O_CREAT | O_APPEND, 0644);
+}
+static void writeLog( int fd, const char* data, std::size_t length )
+{
+	while( length > 0 )
+	{
+		const ssize_t written = ::write(fd, data, length);
+		if( written <= 0 )
+			return;
+		data += written;
+		length -= written;
+	}
+}
+static void syncLog( int fd ) { ::fsync(fd); }
+static void truncateLog( int fd, std::size_t length ) 
+{
+	// If this fails the next replay just stops at the same torn record
+	if( ::ftruncate(fd, length) != 0 )
+		return;
+}
+static void closeLog( int fd ) { ::close(fd); }
+#endif
+
+/**
+ *	\brief The frame in front of every record in the journal.
+ */
+struct RecordFrame
+{
+	//! Number of bytes in the body that follows
+	std::uint32_t length;
+	//! Checksum of the sequence number and the body
+	std::uint32_t checksum;
+	//! The record's number, increasing through the journal
+	std::uint64_t sequence;
+};
+
+/**
+ *	\brief FNV-1a checksum of a record, used to spot records that were only 
+ *	partly written.
+ *	
+ *	\param sequence The record's number
+ *	\param body The record's body
+ *	\param length Number of bytes in the body
+ *	
+ *	\return The checksum
+ */
+static std::uint32_t checksumRecord( std::uint64_t sequence, const char* body, 
+	std::size_t length )
+{
+	std::uint32_t hash = 2166136261u;
+	const unsigned char* seq = reinterpret_cast<const unsigned char*>(&sequence);
+	for( std::size_t i = 0; i < sizeof(sequence); i++)
+		hash = (hash ^ seq[i]) * 16777619u;
+
+	const unsigned char* data = reinterpret_cast<const unsigned char*>(body);
+	for( std::size_t i = 0; i < length; i++)
+		hash = (hash ^ data[i]) * 16777619u;
+
+	return hash;
+}
+
+/**
+ *	\brief Close the journal, syncing anything that is left.
+ */
+Journal::~Journal()
+{
+	if( fd >= 0 )
+	{
+		sync();
+		closeLog(fd);
+	}
+}
+
+/**
+ *	\brief Open the journal for an image and replay it onto the FileSystem.
+ *	
+ *	\param imageName The name of the image the journal belongs to.
+ *	\param root The root of the FileSystem loaded from the image.
+ *	\param baseSequence The last record already folded into the image.
+ *	\param snapshots The snapshots loaded from the image.
+ *	
+ *	Records after baseSequence are applied to root.  A record that was only 
+ *	partly written when the program died is cut off the end of the file.
+ *	
+ *	\return The number of records that were replayed.
+ */
+int Journal::open( const std::string& imageName, Directory* root, 
+	std::uint64_t baseSequence, Snapshots& snapshots )
+{
+	filename = imageName + ".journal";
+	sequence = baseSequence;
+
+	int replayed = 0;
+	std::size_t validEnd = 0;
+
+	// Walk the records that are already in the journal
+	{
+		const auto log = ImageFile::open(filename);
+		const char* data = log ? log->getData() : nullptr;
+		const std::size_t size = log ? log->getSize() : 0;
+
+		while( size - validEnd >= sizeof(RecordFrame) )
+		{
+			RecordFrame frame;
+			std::memcpy(&frame, data + validEnd, sizeof(frame));
+
+			// Stop at the first record that was not completely written
+			const char* body = data + validEnd + sizeof(frame);
+			if( frame.length > size - validEnd - sizeof(frame) ||
+				frame.checksum != checksumRecord(frame.sequence, body, 
+					frame.length) )
+				break;
+
+			// Records already in the image are skipped
+			if( frame.sequence > sequence )
+			{
+				if( apply(root, snapshots, body, frame.length) )
+					replayed++;
+				sequence = frame.sequence;
+			}
+
+			validEnd += sizeof(frame) + frame.length;
+		}
+	}
+
+	fd = openLog(filename.c_str());
+
+	// Cut off a torn record so new records follow the last good one
+	if( fd >= 0 )
+		truncateLog(fd, validEnd);
+
+	return replayed;
+}
+
+/**
+ *	\brief Record that a Directory was made.
+ *	
+ *	\param where The Directory it was made in.
+ *	\param dir The new Directory.
+ */
+void Journal::recordDirectory( Directory* where, const Directory& dir )
+{
+	append(MAKE_DIRECTORY, where, dir.getFileName(), nullptr, 0);
+}
+
+/**
+ *	\brief Record that a TextFile was made.
+ *	
+ *	\param where The Directory it was made in.
+ *	\param file The new TextFile.
+ */
+void Journal::recordTextFile( Directory* where, const TextFile& file )
+{
+	// The body is read where it is, a TextFile keeps no copy of it for this
+	std::string contents;
+	file.appendContents(contents);
+	append(MAKE_TEXT, where, file.getFileName(), contents.data(), 
+		contents.length());
+}
+
+/**
+ *	\brief Record that a ProgramFile was made.
+ *	
+ *	\param where The Directory it was made in.
+ *	\param program The new ProgramFile.
+ */
+void Journal::recordProgramFile( Directory* where, const ProgramFile& program )
+{
+	const int fields[5] = { program.getTimeRequirements(), 
+		program.getMemoryRequirements(), program.getNeedsIO(), 
+		program.getTimeToDoIO(), program.getAmoutOfIO() };
+
+	append(MAKE_PROGRAM, where, program.getFileName(), 
+		reinterpret_cast<const char*>(fields), sizeof(fields));
+}
+
+/**
+ *	\brief Record that a snapshot was taken.
+ *	
+ *	\param name The name of the new snapshot.
+ *	
+ *	Snapshots belong to the whole FileSystem, so the record's path is empty.
+ */
+void Journal::recordSnapshot( const std::string& name )
+{
+	append(TAKE_SNAPSHOT, nullptr, Name(name), nullptr, 0);
+}
+
+/**
+ *	\brief Record that part of a TextFile's body was replaced.
+ *	
+ *	\param where The Directory the TextFile is in.
+ *	\param file The TextFile.
+ *	\param offset The first byte that was replaced.
+ *	\param length How many bytes were replaced.
+ *	\param text What went in their place.
+ *	
+ *	Only the change is written, an append to a large log costs as much as the 
+ *	appended text.
+ */
+void Journal::recordEdit( Directory* where, const TextFile& file, 
+	std::uint64_t offset, std::uint64_t length, const std::string& text )
+{
+	std::string data(reinterpret_cast<const char*>(&offset), sizeof(offset));
+	data.append(reinterpret_cast<const char*>(&length), sizeof(length));
+	data += text;
+
+	append(EDIT_TEXT, where, file.getFileName(), data.data(), data.length());
+}
+
+/**
+ *	\brief Start holding records back so they are written out together.
+ *	
+ *	Used while a large number of changes are made at once, like an import.  
+ *	Records are written in BATCH_SIZE pieces instead of one write each, and 
+ *	are only synced when endBatch() is called.  Each record keeps its own 
+ *	frame, so a batch cut short by a crash still replays up to its last whole 
+ *	record.
+ */
+void Journal::beginBatch()
+{
+	batching = true;
+}
+
+/**
+ *	\brief Write out every record held back since beginBatch() and sync them 
+ *	to the disk.
+ */
+void Journal::endBatch()
+{
+	batching = false;
+
+	if( fd >= 0 && !batch.empty() )
+		writeLog(fd, batch.data(), batch.size());
+	std::string().swap(batch);
+
+	sync();
+}
+
+/**
+ *	\brief Force every record written so far onto the disk.
+ */
+void Journal::sync()
+{
+	if( fd >= 0 && unsynced > 0 )
+		syncLog(fd);
+
+	unsynced = 0;
+}
+
+/**
+ *	\brief Throw away every record, they have been folded into the image.
+ */
+void Journal::clear()
+{
+	if( fd < 0 )
+		return;
+
+	truncateLog(fd, 0);
+	syncLog(fd);
+	unsynced = 0;
+}
+
+/**
+ *	\return The sequence number of the last record in the journal.
+ */
+std::uint64_t Journal::getSequence() const
+{
+	return sequence;
+}
+
+/**
+ *	\brief Frame a record and append it to the journal.
+ *	
+ *	\param op What kind of change the record describes.
+ *	\param where The Directory the change was made in.
+ *	\param name The name of the new FSObject.
+ *	\param data Any extra data the change needs, may be null.
+ *	\param length How many bytes of extra data there are.
+ *	
+ *	The body is the operation, how deep where is as 32 bits, the names of the 
+ *	Directories from root down to where, the new name and then the extra 
+ *	data.  Names are null padded to 8 chars like everywhere else in the image.
+ */
+void Journal::append( Operation op, Directory* where, const Name& name, 
+	const char* data, std::size_t length )
+{
+	if( fd < 0 )
+		return;
+
+	// Collect the path from root down to where
+	std::vector<Directory*> path;
+	for( Directory* d = where; d && d->getParent(); d = d->getParent())
+		path.push_back(d);
+
+	std::string record(sizeof(RecordFrame), '\0');
+	const std::uint32_t depth = static_cast<std::uint32_t>(path.size());
+	record += static_cast<char>(op | WIDE_DEPTH);
+	record.append(reinterpret_cast<const char*>(&depth), sizeof(depth));
+	for( auto d = path.rbegin(); d != path.rend(); ++d)
+		record.append((*d)->getFileName().data(), Name::SIZE);
+	record.append(name.data(), Name::SIZE);
+	record.append(data, length);
+
+	// Fill in the frame now that the body is known
+	RecordFrame frame;
+	frame.length = static_cast<std::uint32_t>(record.size() - sizeof(frame));
+	frame.sequence = ++sequence;
+	frame.checksum = checksumRecord(frame.sequence, 
+		record.data() + sizeof(frame), frame.length);
+	std::memcpy(&record[0], &frame, sizeof(frame));
+
+	// A batch is written out in large pieces, and synced once at the end
+	if( batching )
+	{
+		batch += record;
+		if( batch.size() >= BATCH_SIZE )
+		{
+			writeLog(fd, batch.data(), batch.size());
+			batch.clear();
+		}
+		unsynced++;
+		return;
+	}
+
+	// One write per record keeps it whole even if the program dies
+	writeLog(fd, record.data(), record.size());
+
+	if( ++unsynced >= SYNC_GROUP )
+		sync();
+}
+
+/**
+ *	\brief Apply one record to the FileSystem.
+ *	
+ *	\param root The root of the FileSystem.
+ *	\param snapshots The snapshots taken so far.
+ *	\param body The record body, after the frame.
+ *	\param length The number of bytes in the body.
+ *	
+ *	New FSObjects are stamped with the generation they were first made in, 
+ *	which is however many snapshot records came before them.  Edits are made 
+ *	in that generation too, so they replace the same TextFiles they did the 
+ *	first time.  Records from before WIDE_DEPTH hold the depth in one byte.
+ *	
+ *	\return False if the record could not be understood.
+ */
+bool Journal::apply( Directory* root, Snapshots& snapshots, const char* body, 
+	std::size_t length )
+{
+	if( length < 2 )
+		return false;
+
+	const bool wide = (body[0] & WIDE_DEPTH) != 0;
+	const Operation op = static_cast<Operation>(body[0] & ~WIDE_DEPTH);
+	const std::size_t header = wide ? 1 + sizeof(std::uint32_t) : 2;
+	if( length < header )
+		return false;
+
+	std::size_t depth = static_cast<unsigned char>(body[1]);
+	if( wide )
+	{
+		std::uint32_t wideDepth;
+		std::memcpy(&wideDepth, body + 1, sizeof(wideDepth));
+		depth = wideDepth;
+	}
+
+	if( (length - header) / 8 < depth + 1 )
+		return false;
+
+	// Walk down to the Directory the change was made in
+	std::string component;
+	const char* cursor = body + header;
+	Directory* where = root;
+	for( std::size_t i = 0; i < depth && where; i++, cursor += 8)
+	{
+		component.assign(cursor, strnlen(cursor, 8));
+		where = where->getDirectory(component);
+	}
+
+	if( !where )
+		return false;
+
+	std::string name(cursor, strnlen(cursor, 8));
+	cursor += 8;
+
+	const char* data = cursor;
+	const std::size_t dataLength = length - (cursor - body);
+
+	// New objects are made alongside the rest of the tree
+	NodeArena& arena = where->getArena();
+
+	switch( op )
+	{
+		case MAKE_DIRECTORY:
+		{
+			auto d = Directory::CreateDirectory(arena, name, where);
+			if( !d )
+				return false;
+			d->setGeneration(snapshots.getGeneration());
+			where->addObject(d);
+			return true;
+		}
+
+		case MAKE_TEXT:
+		{
+			auto t = arena.make<TextFile>(name, 
+				std::string(data, dataLength));
+			t->setGeneration(snapshots.getGeneration());
+			where->addObject(t);
+			return true;
+		}
+
+		case MAKE_PROGRAM:
+		{
+			int fields[5];
+			if( dataLength != sizeof(fields) )
+				return false;
+			std::memcpy(fields, data, sizeof(fields));
+
+			auto p = arena.make<ProgramFile>(name, fields[0], 
+				fields[1], fields[2], fields[3], fields[4]);
+			p->setGeneration(snapshots.getGeneration());
+			where->addObject(p);
+			return true;
+		}
+
+		case TAKE_SNAPSHOT:
+			return depth == 0 && snapshots.take(name);
+
+		case EDIT_TEXT:
+		{
+			std::uint64_t range[2];
+			TextFile* file = where->getTextfile(name);
+			if( !file || dataLength < sizeof(range) )
+				return false;
+			std::memcpy(range, data, sizeof(range));
+
+			where->editTextfile(file, range[0], range[1], 
+				std::string(data + sizeof(range), dataLength - sizeof(range)), 
+				snapshots.getGeneration());
+			return true;
+		}
+	}
+
+	return false;
+}
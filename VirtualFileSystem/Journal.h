@@ -0,0 +1,196 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include "Name.h"
+
+class Directory;
+class TextFile;
+class ProgramFile;
+class Snapshots;
+
+/**
+ *	\brief An append-only log of every change made to the FileSystem, kept 
+ *	next to the image as <image>.journal.
+ *	
+ *	Each mkdir, createTextfile, addProgram, snapshot and text edit is written to 
+ *	the journal as soon as it happens, so quitting only has to flush the journal instead of 
+ *	rewriting the whole image.  Records are numbered, and an image remembers 
+ *	the last record that was folded into it, so loading is the image plus a 
+ *	replay of whatever records came after it.
+ *	
+ *	Every record is written to the journal immediately, unless a batch is 
+ *	being held back.  They are synced to the disk in groups of SYNC_GROUP, 
+ *	and whenever sync() is called.
+ */
+class Journal
+{
+public:
+	//! How many records are written before the journal is synced to disk
+	static const int SYNC_GROUP = 16;
+
+	//! How many bytes of records a batch holds before writing them out
+	static const std::size_t BATCH_SIZE = 1024 * 1024;
+
+	//! Set on the operation of every record written with a 32 bit depth.  
+	//!	Records without it are from older journals, with an 8 bit depth.
+	static const std::uint8_t WIDE_DEPTH = 0x80;
+
+	//! The kinds of changes that are journaled
+	enum Operation : std::uint8_t {
+		MAKE_DIRECTORY	= 1,
+		MAKE_TEXT		= 2,
+		MAKE_PROGRAM	= 3,
+		TAKE_SNAPSHOT	= 4,
+		EDIT_TEXT		= 5
+	};
+
+	Journal() = default;
+	~Journal();
+
+	Journal( const Journal& ) = delete;
+	Journal& operator=( const Journal& ) = delete;
+
+	/**
+	 *	\brief Open the journal for an image and replay it onto the FileSystem.
+	 *	
+	 *	\param imageName The name of the image the journal belongs to.
+	 *	\param root The root of the FileSystem loaded from the image.
+	 *	\param baseSequence The last record already folded into the image.
+	 *	\param snapshots The snapshots loaded from the image.
+	 *	
+	 *	Records after baseSequence are applied to root.  A record that was only 
+	 *	partly written when the program died is cut off the end of the file.
+	 *	
+	 *	\return The number of records that were replayed.
+	 */
+	int open( const std::string& imageName, Directory* root, 
+		std::uint64_t baseSequence, Snapshots& snapshots );
+
+	/**
+	 *	\brief Record that a Directory was made.
+	 *	
+	 *	\param where The Directory it was made in.
+	 *	\param dir The new Directory.
+	 */
+	void recordDirectory( Directory* where, const Directory& dir );
+
+	/**
+	 *	\brief Record that a TextFile was made.
+	 *	
+	 *	\param where The Directory it was made in.
+	 *	\param file The new TextFile.
+	 */
+	void recordTextFile( Directory* where, const TextFile& file );
+
+	/**
+	 *	\brief Record that a ProgramFile was made.
+	 *	
+	 *	\param where The Directory it was made in.
+	 *	\param program The new ProgramFile.
+	 */
+	void recordProgramFile( Directory* where, const ProgramFile& program );
+
+	/**
+	 *	\brief Record that a snapshot was taken.
+	 *	
+	 *	\param name The name of the new snapshot.
+	 */
+	void recordSnapshot( const std::string& name );
+
+	/**
+	 *	\brief Record that part of a TextFile's body was replaced.
+	 *	
+	 *	\param where The Directory the TextFile is in.
+	 *	\param file The TextFile.
+	 *	\param offset The first byte that was replaced.
+	 *	\param length How many bytes were replaced.
+	 *	\param text What went in their place.
+	 */
+	void recordEdit( Directory* where, const TextFile& file, 
+		std::uint64_t offset, std::uint64_t length, const std::string& text );
+
+	/**
+	 *	\brief Start holding records back so they are written out together.
+	 *	
+	 *	Used while a large number of changes are made at once, like an 
+	 *	import.  Records are written in BATCH_SIZE pieces instead of one 
+	 *	write each, and are only synced when endBatch() is called.
+	 */
+	void beginBatch();
+
+	/**
+	 *	\brief Write out every record held back since beginBatch() and sync 
+	 *	them to the disk.
+	 */
+	void endBatch();
+
+	/**
+	 *	\brief Force every record written so far onto the disk.
+	 */
+	void sync();
+
+	/**
+	 *	\brief Throw away every record, they have been folded into the image.
+	 */
+	void clear();
+
+	/**
+	 *	\return The sequence number of the last record in the journal.
+	 */
+	std::uint64_t getSequence() const;
+
+private:
+	/**
+	 *	\brief Frame a record and append it to the journal.
+	 *	
+	 *	\param op What kind of change the record describes.
+	 *	\param where The Directory the change was made in.
+	 *	\param name The name of the new FSObject.
+	 *	\param data Any extra data the change needs, may be null.
+	 *	\param length How many bytes of extra data there are.
+	 */
+	void append( Operation op, Directory* where, const Name& name, 
+		const char* data, std::size_t length );
+
+	/**
+	 *	\brief Apply one record to the FileSystem.
+	 *	
+	 *	\param root The root of the FileSystem.
+	 *	\param snapshots The snapshots taken so far.
+	 *	\param body The record body, after the frame.
+	 *	\param length The number of bytes in the body.
+	 *	
+	 *	\return False if the record could not be understood.
+	 */
+	static bool apply( Directory* root, Snapshots& snapshots, 
+		const char* body, std::size_t length );
+
+	//! The name of the journal on disk
+	std::string filename;
+
+	//! The open journal, -1 when there is none
+	int fd = -1;
+
+	//! Number of the last record written
+	std::uint64_t sequence = 0;
+
+	//! Records written since the last sync
+	int unsynced = 0;
+
+	//! Is a batch being held back?
+	bool batching = false;
+
+	//! The records of the batch that have not been written yet
+	std::string batch;
+};
+
+#endif
@@ -0,0 +1,88 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "Name.h"
+
+#include <algorithm>
+#include <cstring>
+
+// std::min takes SIZE by reference, so it needs to be defined somewhere
+const std::size_t Name::SIZE;
+
+/**
+ *	\brief Pack a name.
+ *	
+ *	\param name The characters of the name, only the first 8 are kept.
+ */
+Name::Name( const std::string& name )
+{
+	std::memcpy(&value, name.data(), std::min(name.length(), SIZE));
+}
+
+/**
+ *	\brief Read a name from a record, null padded to 8 chars.
+ *	
+ *	\param record The first byte of the name in the record.
+ *	
+ *	\return The name, without anything that follows the padding.
+ */
+Name Name::fromRecord( const char* record )
+{
+	Name name;
+	std::memcpy(&name.value, record, strnlen(record, SIZE));
+	return name;
+}
+
+/**
+ *	\brief Pack some text, if it can be a name at all.
+ *	
+ *	\param text The characters to pack.
+ *	\param length How many characters there are.
+ *	\param name Set to the packed name.
+ *	
+ *	\return False if the text is too long to be a name.
+ */
+bool Name::pack( const char* text, std::size_t length, Name& name )
+{
+	if( length > SIZE )
+		return false;
+
+	name.value = 0;
+	std::memcpy(&name.value, text, length);
+	return true;
+}
+
+/**
+ *	\return The name as a string.
+ */
+std::string Name::str() const
+{
+	return std::string(data(), length());
+}
+
+/**
+ *	\return The number of characters in the name.
+ */
+std::size_t Name::length() const
+{
+	return strnlen(data(), SIZE);
+}
+
+/**
+ *	\return The 8 bytes of the name, null padded like a record.
+ */
+const char* Name::data() const
+{
+	return reinterpret_cast<const char*>(&value);
+}
+
+/**
+ *	\return The packed name as one integer, for hashing.
+ */
+std::uint64_t Name::key() const
+{
+	return value;
+}
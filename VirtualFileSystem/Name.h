@@ -0,0 +1,102 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef NAME_H
+#define NAME_H
+
+#include <string>
+#include <ostream>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ *	\brief The name of an FSObject, packed into 8 bytes.
+ *	
+ *	Every name in the FileSystem is at most 8 characters, so the characters 
+ *	are kept null padded in a single 64-bit value, byte for byte the same as 
+ *	the name field of a record on disk.  Comparing or hashing two names is 
+ *	one integer operation, and writing one out is a plain 8 byte copy.
+ */
+class Name
+{
+public:
+	//! The most characters a name can have, and the bytes it takes up
+	static const std::size_t SIZE = 8;
+
+	/**
+	 *	\brief An empty name.
+	 */
+	Name() = default;
+
+	/**
+	 *	\brief Pack a name.
+	 *	
+	 *	\param name The characters of the name, only the first 8 are kept.
+	 */
+	Name( const std::string& name );
+
+	/**
+	 *	\brief Read a name from a record, null padded to 8 chars.
+	 *	
+	 *	\param record The first byte of the name in the record.
+	 *	
+	 *	\return The name, without anything that follows the padding.
+	 */
+	static Name fromRecord( const char* record );
+
+	/**
+	 *	\brief Pack some text, if it can be a name at all.
+	 *	
+	 *	\param text The characters to pack.
+	 *	\param length How many characters there are.
+	 *	\param name Set to the packed name.
+	 *	
+	 *	\return False if the text is too long to be a name.
+	 */
+	static bool pack( const char* text, std::size_t length, Name& name );
+
+	/**
+	 *	\return The name as a string.
+	 */
+	std::string str() const;
+
+	/**
+	 *	\return The number of characters in the name.
+	 */
+	std::size_t length() const;
+
+	/**
+	 *	\return The 8 bytes of the name, null padded like a record.
+	 */
+	const char* data() const;
+
+	/**
+	 *	\return The packed name as one integer, for hashing.
+	 */
+	std::uint64_t key() const;
+
+	bool operator==( const Name& other ) const { return value == other.value; }
+	bool operator!=( const Name& other ) const { return value != other.value; }
+
+	/**
+	 *	\brief Print the characters of a name.
+	 *	
+	 *	\param os The output stream to write the name to
+	 *	\param name The name to write
+	 *	
+	 *	\return The output stream
+	 */
+	friend std::ostream& operator<<( std::ostream& os, const Name& name )
+	{
+		return os.write(name.data(), name.length());
+	}
+
+private:
+	//! The characters, in memory order, null padded
+	std::uint64_t value = 0;
+};
+
+#endif
@@ -0,0 +1,83 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "NameIndex.h"
+
+/**
+ *	\brief Remember where a child is, unless an earlier child already has its 
+ *	name.
+ *	
+ *	\param name The child's name.
+ *	\param position Where the child is in its Directory.
+ */
+void NameIndex::insert( const Name& name, std::uint32_t position )
+{
+	const std::uint64_t key = name.key();
+
+	// Keep the table at most half full so probes stay short
+	if( (used + 1) * 2 > slots.size() )
+		grow();
+
+	Slot& slot = slots[probe(key)];
+	if( slot.position != NOT_FOUND )
+		return;
+
+	slot.key = key;
+	slot.position = position;
+	used++;
+}
+
+/**
+ *	\brief Look up the first child with a name.
+ *	
+ *	\param name The name to look for.
+ *	
+ *	\return Where the child is in its Directory, or NOT_FOUND.
+ */
+std::uint32_t NameIndex::find( const Name& name ) const
+{
+	if( slots.empty() )
+		return NOT_FOUND;
+
+	return slots[probe(name.key())].position;
+}
+
+/**
+ *	\brief Find the slot that holds a key, or the empty slot it would go in.
+ *	
+ *	\param key The packed name.
+ *	
+ *	\return The slot's index in the table.
+ */
+std::size_t NameIndex::probe( std::uint64_t key ) const
+{
+	// Fibonacci hashing, the top bits of the product are the most mixed.  
+	//	Taking them also keeps entries in the same order as the table grows, 
+	//	so grow() writes the new table front to back.
+	const std::size_t mask = slots.size() - 1;
+	std::size_t i = static_cast<std::size_t>(
+		(key * 0x9E3779B97F4A7C15ull) >> shift);
+
+	while( slots[i].position != NOT_FOUND && slots[i].key != key )
+		i = (i + 1) & mask;
+
+	return i;
+}
+
+/**
+ *	\brief Double the size of the table and put every entry back in.
+ */
+void NameIndex::grow()
+{
+	std::vector<Slot> old(slots.empty() ? 8 : slots.size() * 2, 
+		Slot{ 0, NOT_FOUND });
+	old.swap(slots);
+	shift = slots.size() == 8 ? 61 : shift - 1;
+
+	for( const Slot& slot : old )
+		if( slot.position != NOT_FOUND )
+			slots[probe(slot.key)] = slot;
+}
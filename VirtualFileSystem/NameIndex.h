@@ -0,0 +1,82 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef NAME_INDEX_H
+#define NAME_INDEX_H
+
+#include <vector>
+#include <cstdint>
+#include "Name.h"
+
+/**
+ *	\brief Finds the first child of a Directory with a given name without 
+ *	searching through all of them.
+ *	
+ *	An open addressing hash table from a name to a child's position.  The 
+ *	packed Name is the key itself, so nothing is allocated per child and a 
+ *	lookup never has to touch the children.
+ */
+class NameIndex
+{
+public:
+	//! Returned by find() when no child has the name
+	static const std::uint32_t NOT_FOUND = 0xFFFFFFFF;
+
+	/**
+	 *	\brief Remember where a child is, unless an earlier child already has 
+	 *	its name.
+	 *	
+	 *	\param name The child's name.
+	 *	\param position Where the child is in its Directory.
+	 */
+	void insert( const Name& name, std::uint32_t position );
+
+	/**
+	 *	\brief Look up the first child with a name.
+	 *	
+	 *	\param name The name to look for.
+	 *	
+	 *	\return Where the child is in its Directory, or NOT_FOUND.
+	 */
+	std::uint32_t find( const Name& name ) const;
+
+private:
+	/**
+	 *	\brief One entry of the table.
+	 */
+	struct Slot
+	{
+		//! The packed name
+		std::uint64_t key;
+		//! Where the child is, NOT_FOUND if the slot is empty
+		std::uint32_t position;
+	};
+
+	/**
+	 *	\brief Find the slot that holds a key, or the empty slot it would go in.
+	 *	
+	 *	\param key The packed name.
+	 *	
+	 *	\return The slot's index in the table.
+	 */
+	std::size_t probe( std::uint64_t key ) const;
+
+	/**
+	 *	\brief Double the size of the table and put every entry back in.
+	 */
+	void grow();
+
+	//! The table, always a power of two in size and at most half full
+	std::vector<Slot> slots;
+
+	//! Number of slots in use
+	std::size_t used = 0;
+
+	//! How far a hash is shifted down to index the table, 64 - log2(size)
+	unsigned shift = 64;
+};
+
+#endif
@@ -0,0 +1,74 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "NodeArena.h"
+
+#include <cstdint>
+
+/**
+ *	\brief Release every node.
+ */
+NodeArena::~NodeArena()
+{
+	release();
+}
+
+/**
+ *	\brief Destroy every node and give the blocks back, all at once.
+ *	
+ *	A Directory only points at its children, it does not own them, so each 
+ *	node is destroyed on its own in one pass instead of recursively down the 
+ *	tree.  Every pointer the arena has handed out is left dangling.
+ */
+void NodeArena::release()
+{
+	for( FSObject* node : nodes )
+		node->~FSObject();
+	nodes.clear();
+	nodes.shrink_to_fit();
+
+	for( char* block : blocks )
+		::operator delete(block);
+	blocks.clear();
+
+	next = end = nullptr;
+}
+
+/**
+ *	\return How many nodes are in the arena.
+ */
+std::size_t NodeArena::getCount() const
+{
+	return nodes.size();
+}
+
+/**
+ *	\brief Carve space for a node out of the current block, starting a new 
+ *	block if it does not fit.
+ *	
+ *	\param size How many bytes the node needs.
+ *	\param align What the node's address has to be a multiple of.
+ *	
+ *	\return Where to construct the node.
+ */
+void* NodeArena::allocate( std::size_t size, std::size_t align )
+{
+	// Round up to the alignment, operator new's blocks are aligned for any 
+	//	node so a fresh block never needs it
+	std::uintptr_t address = reinterpret_cast<std::uintptr_t>(next);
+	address = (address + align - 1) & ~static_cast<std::uintptr_t>(align - 1);
+
+	if( !next || address + size > reinterpret_cast<std::uintptr_t>(end) )
+	{
+		char* block = static_cast<char*>(::operator new(BLOCK_SIZE));
+		blocks.push_back(block);
+		end = block + BLOCK_SIZE;
+		address = reinterpret_cast<std::uintptr_t>(block);
+	}
+
+	next = reinterpret_cast<char*>(address + size);
+	return reinterpret_cast<void*>(address);
+}
@@ -0,0 +1,101 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include <vector>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <type_traits>
+#include "FSObject.h"
+
+/**
+ *	\brief Owns every FSObject in a FileSystem.
+ *	
+ *	Nodes are carved out of large blocks one after another, so making one is 
+ *	a pointer bump instead of a trip to the heap.  Nothing is ever removed 
+ *	from a FileSystem, so nodes are never freed one at a time, the whole tree 
+ *	goes at once when the arena is released.
+ *	
+ *	Like the tree itself, an arena should only be used by one thread at a 
+ *	time.
+ */
+class NodeArena
+{
+public:
+	//! How many bytes each block holds
+	static const std::size_t BLOCK_SIZE = 1 << 20;
+
+	NodeArena() = default;
+	NodeArena( const NodeArena& ) = delete;
+	NodeArena& operator=( const NodeArena& ) = delete;
+
+	/**
+	 *	\brief Release every node.
+	 */
+	~NodeArena();
+
+	/**
+	 *	\brief Construct a new node in the arena.
+	 *	
+	 *	\param args Passed on to the node's constructor.
+	 *	
+	 *	\return The node, which lives until the arena is released.
+	 */
+	template<typename T, typename... Args>
+	T* make( Args&&... args )
+	{
+		static_assert(std::is_base_of<FSObject, T>::value, 
+			"Only FSObjects are kept in a NodeArena");
+		static_assert(sizeof(T) <= BLOCK_SIZE, 
+			"A node has to fit in one block");
+
+		T* node = new(allocate(sizeof(T), alignof(T))) 
+			T(std::forward<Args>(args)...);
+		nodes.push_back(node);
+		return node;
+	}
+
+	/**
+	 *	\brief Destroy every node and give the blocks back, all at once.
+	 *	
+	 *	Every pointer the arena has handed out is left dangling.
+	 */
+	void release();
+
+	/**
+	 *	\return How many nodes are in the arena.
+	 */
+	std::size_t getCount() const;
+
+private:
+	/**
+	 *	\brief Carve space for a node out of the current block, starting a 
+	 *	new block if it does not fit.
+	 *	
+	 *	\param size How many bytes the node needs.
+	 *	\param align What the node's address has to be a multiple of.
+	 *	
+	 *	\return Where to construct the node.
+	 */
+	void* allocate( std::size_t size, std::size_t align );
+
+	//! Every block the arena has allocated
+	std::vector<char*> blocks;
+
+	//! Every node in the arena, in the order they were made
+	std::vector<FSObject*> nodes;
+
+	//! The next free byte in the newest block
+	char* next = nullptr;
+
+	//! One past the last byte of the newest block
+	char* end = nullptr;
+};
+
+#endif
@@ -0,0 +1,384 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "NodeTable.h"
+#include "Directory.h"
+#include "TextFile.h"
+#include "ProgramFile.h"
+#include "ImageReader.h"
+
+#include <algorithm>
+#include <cstring>
+
+// push_back takes NONE by reference, so it needs to be defined somewhere
+const std::uint32_t NodeTable::NONE;
+
+/**
+ *	\brief Replace the table with a copy of a FileSystem.
+ *	
+ *	\param root The root of the FileSystem.
+ */
+void NodeTable::build( const Directory& root )
+{
+	parents.clear();
+	firstChildren.clear();
+	nextSiblings.clear();
+	lastChildren.clear();
+	subtreeSizes.clear();
+	kinds.clear();
+	names.clear();
+	generations.clear();
+	replacements.clear();
+	sizes.clear();
+	objects.clear();
+	bodies.clear();
+	text.clear();
+	textOffsets.clear();
+	images.clear();
+
+	root.flatten(*this, NONE);
+
+	// Rows are in pre-order, so adding each subtree into its parent from the 
+	//	back sizes every subtree in one pass
+	subtreeSizes.assign(getCount(), 0);
+	for( std::uint32_t row = getCount(); row-- > 1; )
+		if( parents[row] != NONE )
+			subtreeSizes[parents[row]] += subtreeSizes[row] + 1;
+
+	std::vector<std::uint32_t>().swap(lastChildren);
+}
+
+/**
+ *	\brief Add a row, used by FSObject::flatten().
+ *	
+ *	\param kind What kind of node it is.
+ *	\param name The node's name.
+ *	\param parent The row of the Directory that holds it, or NONE.
+ *	\param generation The generation the node was made in.
+ *	\param replaced The generation the node was replaced in, LIVE_GENERATION 
+ *	if it never was.
+ *	\param size How many bytes are in its body, 0 if it has none.
+ *	\param object The FSObject the row is a copy of.
+ *	
+ *	\return The new row.
+ */
+std::uint32_t NodeTable::addRow( NodeKind kind, const Name& name, 
+	std::uint32_t parent, std::uint32_t generation, std::uint32_t replaced, 
+	std::uint64_t size, const FSObject* object )
+{
+	const std::uint32_t row = getCount();
+
+	// Children are added in order, so each one goes after the last
+	if( parent != NONE )
+	{
+		if( firstChildren[parent] == NONE )
+			firstChildren[parent] = row;
+		else
+			nextSiblings[lastChildren[parent]] = row;
+		lastChildren[parent] = row;
+	}
+
+	parents.push_back(parent);
+	firstChildren.push_back(NONE);
+	nextSiblings.push_back(NONE);
+	lastChildren.push_back(NONE);
+	kinds.push_back(kind);
+	names.push_back(name);
+	generations.push_back(generation);
+	replacements.push_back(replaced);
+	sizes.push_back(size);
+	objects.push_back(object);
+	bodies.push_back(Body{nullptr, 0, 0});
+
+	return row;
+}
+
+/**
+ *	\brief Add the rows of a Directory that is still stored in an image.
+ *	
+ *	\param image The image that holds the Directory.
+ *	\param index The Directory's entry in the image's node table.
+ *	\param row The Directory's own row, already added.
+ *	
+ *	The image's table is already in pre-order, so its entries are copied in 
+ *	the order they are in.  Entries that would not be inflated, because their 
+ *	payload or parent is bad, are left out along with everything in them.
+ */
+void NodeTable::addImageSubtree( const std::shared_ptr<ImageFile>& image, 
+	std::uint32_t index, std::uint32_t row )
+{
+	ImageLayout layout;
+	if( !ImageReader::getLayout(*image, layout) || index >= layout.nodeCount )
+		return;
+
+	if( images.empty() || images.back() != image )
+		images.push_back(image);
+
+	const std::uint32_t count = static_cast<std::uint32_t>(
+		std::min<std::uint64_t>(layout.table[index].subtreeSize, 
+			layout.nodeCount - index - 1) + 1);
+
+	// The whole subtree is usually added, so make room for it up front
+	reserve(getCount() + count);
+
+	// The row that each entry of the subtree became, NONE if it was left out
+	std::vector<std::uint32_t> rows(count, NONE);
+	rows[0] = row;
+
+	for( std::uint32_t i = 1; i < count; i++)
+	{
+		const ImageNode& node = layout.table[index + i];
+
+		// A parent has to come before its children
+		if( node.parent < index || node.parent >= index + i || 
+			rows[node.parent - index] == NONE )
+			continue;
+
+		if( node.kind > NODE_PROGRAM || 
+			node.payloadOffset > layout.payloadSize || 
+			node.payloadLength > layout.payloadSize - node.payloadOffset )
+			continue;
+
+		if( node.kind == NODE_PROGRAM && 
+			node.payloadLength != PROGRAM_PAYLOAD_SIZE )
+			continue;
+
+		const char* data = layout.payload + node.payloadOffset;
+
+		// Compressed bodies start with their original length
+		std::uint64_t size = 0;
+		if( node.kind == NODE_TEXT )
+		{
+			size = node.payloadLength;
+			if( (node.flags & NODE_COMPRESSED) && 
+				node.payloadLength >= sizeof(size) )
+				std::memcpy(&size, data, sizeof(size));
+		}
+
+		const std::uint32_t replaced = (node.flags & NODE_REPLACED) ? 
+			node.childCount : LIVE_GENERATION;
+
+		rows[i] = addRow(static_cast<NodeKind>(node.kind), 
+			Name::fromRecord(node.name), rows[node.parent - index], 
+			node.generation, replaced, size, nullptr);
+
+		if( node.kind != NODE_DIRECTORY )
+			bodies[rows[i]] = Body{data, node.payloadLength, node.flags};
+	}
+}
+
+/**
+ *	\brief Make room for more rows without growing each array many times.
+ *	
+ *	\param rows How many rows the table should have room for.
+ */
+void NodeTable::reserve( std::size_t rows )
+{
+	if( rows <= kinds.capacity() )
+		return;
+
+	// Still at least double, so reserving for many small subtrees in a row 
+	//	does not copy the arrays every time
+	rows = std::max(rows, kinds.capacity() * 2);
+
+	parents.reserve(rows);
+	firstChildren.reserve(rows);
+	nextSiblings.reserve(rows);
+	lastChildren.reserve(rows);
+	kinds.reserve(rows);
+	names.reserve(rows);
+	generations.reserve(rows);
+	replacements.reserve(rows);
+	sizes.reserve(rows);
+	objects.reserve(rows);
+	bodies.reserve(rows);
+}
+
+/**
+ *	\brief Gather every text body into one blob, if it has not been yet.
+ *	
+ *	Compressed bodies are expanded, a damaged body is left empty.
+ */
+void NodeTable::loadText()
+{
+	if( !textOffsets.empty() )
+		return;
+
+	textOffsets.reserve(getCount() + 1);
+
+	std::string expanded;
+	for( std::uint32_t row = 0; row < getCount(); row++)
+	{
+		textOffsets.push_back(text.size());
+		if( kinds[row] != NODE_TEXT )
+			continue;
+
+		const Body& body = bodies[row];
+		if( objects[row] )
+			static_cast<const TextFile*>(objects[row])->appendContents(text);
+		else if( !(body.flags & NODE_COMPRESSED) )
+			text.append(body.data, static_cast<std::size_t>(body.length));
+		else if( TextFile::expand(body.data, 
+			static_cast<std::size_t>(body.length), body.flags, expanded) )
+			text += expanded;
+	}
+
+	textOffsets.push_back(text.size());
+}
+
+/**
+ *	\brief Find the row that is a copy of an FSObject.
+ *	
+ *	\param object The FSObject to look for.
+ *	
+ *	\return Its row, or NONE if it is not in the table.
+ */
+std::uint32_t NodeTable::findRow( const FSObject* object ) const
+{
+	const auto found = std::find(objects.begin(), objects.end(), object);
+	if( found == objects.end() )
+		return NONE;
+
+	return static_cast<std::uint32_t>(found - objects.begin());
+}
+
+/**
+ *	\brief Get a row's text body, loadText() has to be called first.
+ *	
+ *	\param row The row.
+ *	\param length Set to how many bytes are in the body.
+ *	
+ *	\return The first byte of the body in the blob.
+ */
+const char* NodeTable::getText( std::uint32_t row, std::uint64_t& length ) const
+{
+	length = textOffsets[row + 1] - textOffsets[row];
+	return text.data() + textOffsets[row];
+}
+
+/**
+ *	\brief Get one row's text body, without loadText().
+ *	
+ *	\param row The row of a TextFile.
+ *	\param scratch Holds the body if it has to be put together or expanded.
+ *	\param length Set to how many bytes are in the body.
+ *	
+ *	Nothing is changed, so different threads can read rows at the same time.  
+ *	A body that is stored plainly in an image is not copied at all.
+ *	
+ *	\return The first byte of the body, or null if it is damaged.
+ */
+const char* NodeTable::readText( std::uint32_t row, std::string& scratch, 
+	std::uint64_t& length ) const
+{
+	const Body& body = bodies[row];
+	if( !objects[row] && !(body.flags & NODE_COMPRESSED) )
+	{
+		length = body.length;
+		return body.data;
+	}
+
+	scratch.clear();
+	const bool read = objects[row] ? 
+		static_cast<const TextFile*>(objects[row])->appendContents(scratch) : 
+		TextFile::expand(body.data, static_cast<std::size_t>(body.length), 
+			body.flags, scratch);
+	if( !read )
+		return nullptr;
+
+	length = scratch.length();
+	return scratch.data();
+}
+
+/**
+ *	\brief Get the data of a ProgramFile's row.
+ *	
+ *	\param row The row of a ProgramFile.
+ *	\param fields Set to the time, memory and the three IO fields, in the 
+ *	order they are stored in an image.
+ */
+void NodeTable::readProgram( std::uint32_t row, 
+	std::int32_t (&fields)[5] ) const
+{
+	if( !objects[row] )
+	{
+		std::memcpy(fields, bodies[row].data, sizeof(fields));
+		return;
+	}
+
+	const auto program = static_cast<const ProgramFile*>(objects[row]);
+	fields[0] = program->getTimeRequirements();
+	fields[1] = program->getMemoryRequirements();
+	fields[2] = program->getNeedsIO();
+	fields[3] = program->getTimeToDoIO();
+	fields[4] = program->getAmoutOfIO();
+}
+
+/**
+ *	\brief Add up what is inside of a row, only counting one view of the 
+ *	FileSystem.
+ *	
+ *	\param row The row of a Directory.
+ *	\param generation The view to count, a snapshot or LIVE_GENERATION.
+ *	
+ *	Every row in the subtree is looked at, so this is for views that a 
+ *	Directory's own totals do not cover.
+ *	
+ *	\return The totals of the rows in the view.
+ */
+SubtreeTotals NodeTable::tally( std::uint32_t row, 
+	std::uint32_t generation ) const
+{
+	SubtreeTotals totals;
+
+	const std::uint32_t last = row + 1 + subtreeSizes[row];
+	for( std::uint32_t r = row + 1; r < last; r++)
+	{
+		// Anything inside of a newer Directory is newer too, so it is left 
+		//	out as well
+		if( !visibleIn(r, generation) )
+			continue;
+
+		totals.nodes++;
+		if( kinds[r] == NODE_TEXT )
+			totals.textBytes += sizes[r];
+		else if( kinds[r] == NODE_PROGRAM )
+		{
+			totals.programs++;
+
+			std::int32_t fields[5];
+			readProgram(r, fields);
+			totals.programMemory += fields[1];
+		}
+	}
+
+	return totals;
+}
+
+/**
+ *	\brief Add the path of a row to a string, like "root/a/b/notes.t".
+ *	
+ *	\param row The row.
+ *	\param out Where to add the path.
+ */
+void NodeTable::appendPath( std::uint32_t row, std::string& out ) const
+{
+	static const char* extensions[] = { "", ".t", ".p" };
+
+	// Collect the rows from here up to root, which is printed like pwd does
+	std::vector<std::uint32_t> path;
+	for( std::uint32_t r = row; r != NONE; r = parents[r])
+		path.push_back(r);
+
+	for( auto r = path.rbegin(); r != path.rend(); ++r)
+	{
+		if( r != path.rbegin() )
+			out += '/';
+		out.append(names[*r].data(), names[*r].length());
+	}
+
+	out += extensions[kinds[row]];
+}
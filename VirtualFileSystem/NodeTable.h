@@ -0,0 +1,261 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef NODE_TABLE_H
+#define NODE_TABLE_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+#include "ImageFormat.h"
+#include "ImageFile.h"
+#include "Name.h"
+#include "FSObject.h"
+
+class FSObject;
+class Directory;
+
+/**
+ *	\brief A flat copy of a whole FileSystem, for jobs that have to look at 
+ *	every node, like searching or adding up sizes.
+ *	
+ *	Each node is a row, and each field is its own array, so a job that only 
+ *	needs names or kinds only reads those.  Rows are in pre-order like an 
+ *	image's node table, every subtree is the run of rows right after its 
+ *	Directory.  Text bodies can be gathered into one blob as well.
+ *	
+ *	The Directory tree is still the FileSystem, a NodeTable is built from it 
+ *	and does not change with it.  Subtrees that are still in an image are 
+ *	copied straight out of the image's node table, without inflating them.
+ */
+class NodeTable
+{
+public:
+	//! Marks a missing parent, child or sibling
+	static const std::uint32_t NONE = 0xFFFFFFFF;
+
+	/**
+	 *	\brief Replace the table with a copy of a FileSystem.
+	 *	
+	 *	\param root The root of the FileSystem.
+	 */
+	void build( const Directory& root );
+
+	/**
+	 *	\brief Add a row, used by FSObject::flatten().
+	 *	
+	 *	\param kind What kind of node it is.
+	 *	\param name The node's name.
+	 *	\param parent The row of the Directory that holds it, or NONE.
+	 *	\param generation The generation the node was made in.
+	 *	\param replaced The generation the node was replaced in, 
+	 *	LIVE_GENERATION if it never was.
+	 *	\param size How many bytes are in its body, 0 if it has none.
+	 *	\param object The FSObject the row is a copy of.
+	 *	
+	 *	\return The new row.
+	 */
+	std::uint32_t addRow( NodeKind kind, const Name& name, 
+		std::uint32_t parent, std::uint32_t generation, std::uint32_t replaced, 
+		std::uint64_t size, const FSObject* object );
+
+	/**
+	 *	\brief Add the rows of a Directory that is still stored in an image.
+	 *	
+	 *	\param image The image that holds the Directory.
+	 *	\param index The Directory's entry in the image's node table.
+	 *	\param row The Directory's own row, already added.
+	 */
+	void addImageSubtree( const std::shared_ptr<ImageFile>& image, 
+		std::uint32_t index, std::uint32_t row );
+
+	/**
+	 *	\brief Gather every text body into one blob, if it has not been yet.
+	 *	
+	 *	Compressed bodies are expanded, a damaged body is left empty.
+	 */
+	void loadText();
+
+	/**
+	 *	\return How many rows there are.
+	 */
+	std::uint32_t getCount() const 
+	{ 
+		return static_cast<std::uint32_t>(kinds.size()); 
+	}
+
+	//! \return The row of the Directory that holds a row, NONE for root
+	std::uint32_t getParent( std::uint32_t row ) const { return parents[row]; }
+
+	//! \return A Directory's first child, NONE if it has none
+	std::uint32_t getFirstChild( std::uint32_t row ) const 
+	{ 
+		return firstChildren[row]; 
+	}
+
+	//! \return The next child of the same Directory, NONE after the last
+	std::uint32_t getNextSibling( std::uint32_t row ) const 
+	{ 
+		return nextSiblings[row]; 
+	}
+
+	//! \return How many rows follow a row that are inside of it
+	std::uint32_t getSubtreeSize( std::uint32_t row ) const 
+	{ 
+		return subtreeSizes[row]; 
+	}
+
+	//! \return What kind of node a row is
+	NodeKind getKind( std::uint32_t row ) const { return kinds[row]; }
+
+	//! \return The name of a row
+	const Name& getName( std::uint32_t row ) const { return names[row]; }
+
+	//! \return The generation a row was made in
+	std::uint32_t getGeneration( std::uint32_t row ) const 
+	{ 
+		return generations[row]; 
+	}
+
+	//! \return True if a row is part of a view, see FSObject::visibleIn()
+	bool visibleIn( std::uint32_t row, std::uint32_t generation ) const 
+	{ 
+		return generations[row] <= generation && 
+			(replacements[row] == LIVE_GENERATION || 
+				generation < replacements[row]); 
+	}
+
+	//! \return How many bytes are in a row's body
+	std::uint64_t getSize( std::uint32_t row ) const { return sizes[row]; }
+
+	//! \return The FSObject a row is a copy of, null if it is still in an 
+	//!	image
+	const FSObject* getObject( std::uint32_t row ) const 
+	{ 
+		return objects[row]; 
+	}
+
+	/**
+	 *	\brief Find the row that is a copy of an FSObject.
+	 *	
+	 *	\param object The FSObject to look for.
+	 *	
+	 *	\return Its row, or NONE if it is not in the table.
+	 */
+	std::uint32_t findRow( const FSObject* object ) const;
+
+	/**
+	 *	\brief Get a row's text body, loadText() has to be called first.
+	 *	
+	 *	\param row The row.
+	 *	\param length Set to how many bytes are in the body.
+	 *	
+	 *	\return The first byte of the body in the blob.
+	 */
+	const char* getText( std::uint32_t row, std::uint64_t& length ) const;
+
+	/**
+	 *	\brief Get one row's text body, without loadText().
+	 *	
+	 *	\param row The row of a TextFile.
+	 *	\param scratch Holds the body if it has to be put together or 
+	 *	expanded.
+	 *	\param length Set to how many bytes are in the body.
+	 *	
+	 *	Nothing is changed, so different threads can read rows at the same 
+	 *	time.
+	 *	
+	 *	\return The first byte of the body, or null if it is damaged.
+	 */
+	const char* readText( std::uint32_t row, std::string& scratch, 
+		std::uint64_t& length ) const;
+
+	/**
+	 *	\brief Get the data of a ProgramFile's row.
+	 *	
+	 *	\param row The row of a ProgramFile.
+	 *	\param fields Set to the time, memory and the three IO fields, in the 
+	 *	order they are stored in an image.
+	 */
+	void readProgram( std::uint32_t row, std::int32_t (&fields)[5] ) const;
+
+	/**
+	 *	\brief Add up what is inside of a row, only counting one view of the 
+	 *	FileSystem.
+	 *	
+	 *	\param row The row of a Directory.
+	 *	\param generation The view to count, a snapshot or LIVE_GENERATION.
+	 *	
+	 *	\return The totals of the rows in the view.
+	 */
+	SubtreeTotals tally( std::uint32_t row, std::uint32_t generation ) const;
+
+	/**
+	 *	\brief Add the path of a row to a string, like "root/a/b/notes.t".
+	 *	
+	 *	\param row The row.
+	 *	\param out Where to add the path.
+	 */
+	void appendPath( std::uint32_t row, std::string& out ) const;
+
+private:
+	/**
+	 *	\brief Make room for more rows without growing each array many times.
+	 *	
+	 *	\param rows How many rows the table should have room for.
+	 */
+	void reserve( std::size_t rows );
+
+	/**
+	 *	\brief Where the body of a row that is still in an image is.
+	 */
+	struct Body
+	{
+		//! The body inside of the image
+		const char* data;
+		//! Number of bytes in the image
+		std::uint64_t length;
+		//! How the body is stored, any of NodeFlags
+		std::uint8_t flags;
+	};
+
+	//! The Directory that holds each row
+	std::vector<std::uint32_t> parents;
+	//! Each Directory's first child
+	std::vector<std::uint32_t> firstChildren;
+	//! The next child of the same Directory
+	std::vector<std::uint32_t> nextSiblings;
+	//! The newest child of each Directory so far, only used while building
+	std::vector<std::uint32_t> lastChildren;
+	//! How many rows are inside of each row
+	std::vector<std::uint32_t> subtreeSizes;
+	//! What kind of node each row is
+	std::vector<NodeKind> kinds;
+	//! Each row's name
+	std::vector<Name> names;
+	//! The generation each row was made in
+	std::vector<std::uint32_t> generations;
+	//! The generation each row was replaced in, LIVE_GENERATION for most
+	std::vector<std::uint32_t> replacements;
+	//! Bytes in each row's body
+	std::vector<std::uint64_t> sizes;
+	//! The FSObject each row is a copy of, null if it is still in an image
+	std::vector<const FSObject*> objects;
+	//! Where each row's body is in an image, for rows that are still in one
+	std::vector<Body> bodies;
+
+	//! Every text body, one after another
+	std::string text;
+	//! Where each row's body starts in text, with one more at the end.  Empty 
+	//!	until loadText() is called.
+	std::vector<std::uint64_t> textOffsets;
+
+	//! The images that rows were copied out of, kept mapped for their bodies
+	std::vector<std::shared_ptr<ImageFile>> images;
+};
+
+#endif
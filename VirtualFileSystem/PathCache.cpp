@@ -0,0 +1,145 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "PathCache.h"
+#include "Directory.h"
+
+#include <algorithm>
+
+/**
+ *	\brief Find the Directory a path leads to.
+ *	
+ *	\param root The root of the FileSystem, where absolute paths start.
+ *	\param current Where relative paths start.
+ *	\param path The path to follow.
+ *	\param generation The view of the FileSystem to follow it in, a snapshot 
+ *	or LIVE_GENERATION.
+ *	
+ *	Paths are always followed in the live FileSystem.  A snapshot that can see 
+ *	every Directory along the way would have found the same ones, and one 
+ *	that cannot would not find the path at all.
+ *	
+ *	\return The Directory, or null if the path does not lead to one.
+ */
+Directory* PathCache::resolve( Directory* root, Directory* current, 
+	const std::string& path, std::uint32_t generation )
+{
+	Directory* start = !path.empty() && path[0] == '/' ? root : current;
+
+	// A path that is not found is not cached, so look without adding
+	Entry entry;
+	bool hit = false;
+	const auto from = paths.find(start);
+	if( from != paths.end() )
+	{
+		const auto cached = from->second.find(path);
+		hit = cached != from->second.end();
+		if( hit )
+			entry = cached->second;
+	}
+
+	if( !hit )
+	{
+		if( !walk(start, path, entry) )
+			return nullptr;
+
+		// Keep the cache from growing without bound, each starting Directory 
+		//	takes up room as well as each path
+		if( size + 2 > CAPACITY )
+		{
+			paths.clear();
+			size = 0;
+		}
+
+		auto& found = paths[start];
+		if( found.empty() )
+			size++;
+		found.emplace(path, entry);
+		size++;
+	}
+
+	if( entry.generation > generation )
+		return nullptr;
+
+	return entry.dir;
+}
+
+/**
+ *	\brief Find the Directory a path to a file is in.
+ *	
+ *	\param root The root of the FileSystem, where absolute paths start.
+ *	\param current Where relative paths start.
+ *	\param path The path to the file.
+ *	\param generation The view of the FileSystem to follow it in.
+ *	\param leaf Set to the last component of the path, the file's name.
+ *	
+ *	\return The Directory the file would be in, or null if the path does not 
+ *	lead to one.
+ */
+Directory* PathCache::resolveParent( Directory* root, Directory* current, 
+	const std::string& path, std::uint32_t generation, std::string& leaf )
+{
+	const auto slash = path.rfind('/');
+	if( slash == std::string::npos )
+	{
+		leaf = path;
+		return current;
+	}
+
+	leaf = path.substr(slash + 1);
+
+	// "/name" is in root, the path up to the slash would be empty
+	return resolve(root, current, slash == 0 ? "/" : path.substr(0, slash), 
+		generation);
+}
+
+/**
+ *	\brief Follow a path one component at a time.
+ *	
+ *	\param start Where to start.
+ *	\param path The path to follow.
+ *	\param entry Filled in with where the path leads.
+ *	
+ *	\return False if the path does not lead to a Directory.
+ */
+bool PathCache::walk( Directory* start, const std::string& path, 
+	Entry& entry )
+{
+	entry.dir = start;
+	entry.generation = start->getGeneration();
+
+	std::string component;
+	std::size_t first = 0;
+	while( first <= path.size() )
+	{
+		std::size_t last = path.find('/', first);
+		if( last == std::string::npos )
+			last = path.size();
+
+		component.assign(path, first, last - first);
+		first = last + 1;
+
+		if( component.empty() || component == "." )
+			continue;
+
+		// Root is its own parent
+		if( component == ".." )
+		{
+			if( entry.dir->getParent() )
+				entry.dir = entry.dir->getParent();
+			continue;
+		}
+
+		entry.dir = entry.dir->getDirectory(component);
+		if( !entry.dir )
+			return false;
+
+		entry.generation = std::max(entry.generation, 
+			entry.dir->getGeneration());
+	}
+
+	return true;
+}
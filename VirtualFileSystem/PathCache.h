@@ -0,0 +1,98 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef PATH_CACHE_H
+#define PATH_CACHE_H
+
+#include <string>
+#include <cstdint>
+#include <unordered_map>
+
+class Directory;
+
+/**
+ *	\brief Resolves paths like "/a/b/c" and "../x" to the Directory they lead 
+ *	to, remembering the paths that have been resolved before.
+ *	
+ *	A path starting with "/" starts at root, anything else starts at the 
+ *	current Directory.  ".." goes up a level (root is its own parent), "." 
+ *	and empty components are skipped.
+ *	
+ *	Nothing is ever removed from the FileSystem, and a name always finds the 
+ *	first child with that name, so once a path leads to a Directory it always 
+ *	will.  Only paths that were found are cached, a path that was not found 
+ *	might be made later, so the cache never has to be invalidated.
+ */
+class PathCache
+{
+public:
+	//! How many paths, and Directories they start from, are remembered 
+	//!	before the cache starts over
+	static const std::size_t CAPACITY = 4096;
+
+	/**
+	 *	\brief Find the Directory a path leads to.
+	 *	
+	 *	\param root The root of the FileSystem, where absolute paths start.
+	 *	\param current Where relative paths start.
+	 *	\param path The path to follow.
+	 *	\param generation The view of the FileSystem to follow it in, a 
+	 *	snapshot or LIVE_GENERATION.
+	 *	
+	 *	\return The Directory, or null if the path does not lead to one.
+	 */
+	Directory* resolve( Directory* root, Directory* current, 
+		const std::string& path, std::uint32_t generation );
+
+	/**
+	 *	\brief Find the Directory a path to a file is in.
+	 *	
+	 *	\param root The root of the FileSystem, where absolute paths start.
+	 *	\param current Where relative paths start.
+	 *	\param path The path to the file.
+	 *	\param generation The view of the FileSystem to follow it in.
+	 *	\param leaf Set to the last component of the path, the file's name.
+	 *	
+	 *	\return The Directory the file would be in, or null if the path does 
+	 *	not lead to one.
+	 */
+	Directory* resolveParent( Directory* root, Directory* current, 
+		const std::string& path, std::uint32_t generation, std::string& leaf );
+
+private:
+	/**
+	 *	\brief Where a path leads.
+	 */
+	struct Entry
+	{
+		//! The Directory at the end of the path
+		Directory* dir;
+		//! The newest generation of any Directory the path went through, 
+		//!	the path leads to the same place in any view that can see it
+		std::uint32_t generation;
+	};
+
+	/**
+	 *	\brief Follow a path one component at a time.
+	 *	
+	 *	\param start Where to start.
+	 *	\param path The path to follow.
+	 *	\param entry Filled in with where the path leads.
+	 *	
+	 *	\return False if the path does not lead to a Directory.
+	 */
+	static bool walk( Directory* start, const std::string& path, 
+		Entry& entry );
+
+	//! The paths found from each starting Directory
+	std::unordered_map<Directory*, 
+		std::unordered_map<std::string, Entry> > paths;
+
+	//! How many paths and starting Directories are in the cache
+	std::size_t size = 0;
+};
+
+#endif
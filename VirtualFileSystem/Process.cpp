@@ -235,11 +235,13 @@ std::string Process::getFinishedData()
 /**
  *	\brief Get the name of the Program that this Process is managing
  *	
+ *	The name is only unpacked into a string here, when it is printed.
+ *	
  *	\return string name of this process's program
  */
 std::string Process::getName()
 {
-	return name;
+	return name.str();
 }
 
 /**
@@ -8,6 +8,7 @@
 #define PROCESS_H
 
 #include "ProgramFile.h"
+#include "Name.h"
 
 class Scheduler;
 
@@ -138,6 +139,8 @@ public:
 	/**
 	 *	\brief Get the name of the Program that this Process is managing
 	 *	
+	 *	The name is only unpacked into a string here, when it is printed.
+	 *	
 	 *	\return string name of this process's program
 	 */
 	std::string getName();
@@ -160,8 +163,9 @@ public:
 	bool isInVM();
 
 private:
-	//! The name of the ProgramFile that this process was spawned from
-	std::string name;
+	//! The name of the ProgramFile that this process was spawned from, kept 
+	//!	packed rather than copied into a string at every start
+	Name name;
 
 	//! How many main ticks have this unit run for
 	int unitsRun;
@@ -5,13 +5,18 @@
 */
 
 #include "ProgramFile.h"
+#include "ImageWriter.h"
+#include "NodeArena.h"
+#include "NodeTable.h"
 #include <iostream>
 #include <string>
+#include <cstring>
 
 /**
  *	\brief Create a new ProgramFile with the given parameters.  The program 
- *	file will be created on the heap and a shared point will be returned.
+ *	file will be created in a NodeArena and a pointer will be returned.
  * 
+ *	\param arena The NodeArena that will own the ProgramFile
  *	\param name Name of the file
  *	\param time How long does the program take to run
  *	\param mem	How much memory does the program require to run
@@ -19,9 +24,9 @@
  *	\param timeIO if the program does IO, when should it start?
  *	\param amountIO  if the program does IO, how long does it take?
  *	
- *	\return A shared pointer to a heap allocated ProgramFile.
+ *	\return A pointer to the ProgramFile, or null if the name is invalid.
  */
-std::shared_ptr<ProgramFile> ProgramFile::makeProgramFile( 
+ProgramFile* ProgramFile::makeProgramFile( NodeArena& arena, 
 	const std::string& name, int time, int mem, 
 	int doesIO, int timeIO, int amountIO  )
 {
@@ -34,7 +39,7 @@ std::shared_ptr<ProgramFile> ProgramFile::makeProgramFile(
 	}
 
 	// Send back out new ProgramFile pointer
-	return std::make_shared<ProgramFile>(n, time, mem, doesIO, 
+	return arena.make<ProgramFile>(n, time, mem, doesIO, 
 		timeIO, amountIO);
 
 }
@@ -56,6 +61,7 @@ std::shared_ptr<ProgramFile> ProgramFile::makeProgramFile(
  */
 ProgramFile::ProgramFile( const std::string& name, int timeReq, int memReq, 
 	int doesIO, int timeIO, int amountIO)
+	: File(NODE_PROGRAM)
 {
 	fileName = name;
 
@@ -147,31 +153,52 @@ void ProgramFile::printData(int tabs)
  *	\brief Write the program file out to a stream so that is can be saved to 
  *	disk.
  *	
- *	\param stream The output file stream to write the program's data to.
+ *	\param writer The image to add the program's data to.
+ *	\param parent Index of the Directory that holds the program.
  */
-void ProgramFile::writeToFile(std::ofstream& stream)
+void ProgramFile::writeToFile(ImageWriter& writer, std::uint32_t parent)
 {
-	// Write the name to the stream
-	stream << fileName;
+	// The objects state and IO data make up the payload
+	const int fields[5] = { timeRequirements, memoryRequirements, 
+		needsIO, timeToDoIO, amoutOfIoTime };
 
-	// fill the remaining space with null chars
-	for( int i = fileName.length(); i < 8; i++)
-	{
-		stream << '\0';
-	}
+	writer.addNode(NODE_PROGRAM, fileName, parent, 
+		reinterpret_cast<const char*>(fields), sizeof(fields), 0, generation);
+}
 
-	// Add the spec required extension and null character
-	stream << ".p";
-	stream << '\0';
+/**
+ *	\brief Add up how much room the program takes in an image.
+ *	
+ *	\param size Accumulates the node count and payload bytes.
+ */
+void ProgramFile::measure(ImageSize& size) const
+{
+	size.nodeCount++;
+	size.payloadSize += PROGRAM_PAYLOAD_SIZE;
+}
 
-	// Write the objects state into the file
-	stream.write((char*)&timeRequirements, sizeof(timeRequirements));
-	stream.write((char*)&memoryRequirements, sizeof(memoryRequirements));
+/**
+ *	\brief Add the ProgramFile to a NodeTable.
+ *	
+ *	\param table The table to add a row to.
+ *	\param parent The row of the Directory that holds the ProgramFile.
+ */
+void ProgramFile::flatten(NodeTable& table, std::uint32_t parent) const
+{
+	table.addRow(NODE_PROGRAM, fileName, parent, generation, replaced, 0, 
+		this);
+}
 
-	// Write the IO data out
-	stream.write((char*)&needsIO, sizeof(needsIO));
-	stream.write((char*)&timeToDoIO, sizeof(timeToDoIO));
-	stream.write((char*)&amoutOfIoTime, sizeof(amoutOfIoTime));
+/**
+ *	\brief Add the ProgramFile and the memory it needs to a Directory's totals.
+ *	
+ *	\param totals The totals to add to.
+ */
+void ProgramFile::tally(SubtreeTotals& totals) const
+{
+	totals.nodes++;
+	totals.programs++;
+	totals.programMemory += memoryRequirements;
 }
 
 /**
@@ -231,37 +258,36 @@ int ProgramFile::getAmoutOfIO() const
 /**
  *	\brief Inflate a stored ProgramFile back into a full file.
  *	
+ *	\param arena The NodeArena that will own the ProgramFile.
  *	\param name The name of the ProgramFile that is read from the file.
- *	\param stream The stream that contains the rest of the data.
+ *	\param image The memory-mapped image that contains the rest of the data.
+ *	\param cursor Where the program data starts, advanced past it.
  *	
  *	The ProgramFile is read from a binary file and reconstructed from the data.
  *	
- *	\return A shared pointer to a ProgramFile to be managed by a Directory
+ *	\return A pointer to a ProgramFile to be managed by a Directory, or null 
+ *	if the image was truncated.
  */
-std::shared_ptr<ProgramFile> ProgramFile::inflateProgramFile(std::string& name, 
-	std::ifstream& stream)
+ProgramFile* ProgramFile::inflateProgramFile(NodeArena& arena, 
+	std::string& name, const ImageFile& image, const char*& cursor)
 {
 	std::string n = name;
 	validName(&n);
 
-	// Load process data
-	int t;
-	int m;
-
-	// Load IO Data
-	int doesIO;
-	int timeIO;
-	int amountIO;
-	
-	// Load the object's state from the file
-	stream.read((char*)&t, sizeof(t));
-	stream.read((char*)&m, sizeof(m));
+	// Program data is five ints: time, memory and the three IO fields
+	int fields[5];
+	const char* end = image.getData() + image.getSize();
+	if( static_cast<std::size_t>(end - cursor) < sizeof(fields) )
+	{
+		cursor = end;
+		return nullptr;
+	}
 
-	// Load in the IO data
-	stream.read((char*)&doesIO, sizeof(doesIO));
-	stream.read((char*)&timeIO, sizeof(timeIO));
-	stream.read((char*)&amountIO, sizeof(amountIO));
+	// Load the object's state straight out of the image
+	std::memcpy(fields, cursor, sizeof(fields));
+	cursor += sizeof(fields);
 
-	// Return the shared pointer to a new ProgramFile
-	return std::make_shared<ProgramFile>(n, t, m, doesIO, timeIO, amountIO);
-}
\ No newline at end of file
+	// Return a new ProgramFile, the arena owns it
+	return arena.make<ProgramFile>(n, fields[0], fields[1], 
+		fields[2], fields[3], fields[4]);
+}
@@ -9,6 +9,9 @@
 
 #include <memory>
 #include "File.h"
+#include "ImageFile.h"
+
+class NodeArena;
 
 /**
  *	\brief A special type of file that contains the necessary meta-data to be 
@@ -20,8 +23,9 @@ class ProgramFile : public File
 public:
 	/**
 	 *	\brief Create a new ProgramFile with the given parameters.  The program 
-	 *	file will be created on the heap and a shared point will be returned.
+	 *	file will be created in a NodeArena and a pointer will be returned.
 	 * 
+	 *	\param arena The NodeArena that will own the ProgramFile
 	 *	\param name Name of the file
 	 *	\param time How long does the program take to run
 	 *	\param mem	How much memory does the program require to run
@@ -29,25 +33,28 @@ public:
 	 *	\param timeIO if the program does IO, when should it start?
 	 *	\param amountIO  if the program does IO, how long does it take?
 	 *	
-	 *	\return A shared pointer to a heap allocated ProgramFile.
+	 *	\return A pointer to the ProgramFile, or null if the name is invalid.
 	 */
-	static std::shared_ptr<ProgramFile> makeProgramFile( 
+	static ProgramFile* makeProgramFile( NodeArena& arena, 
 		const std::string& name, int time, int mem, 
 		int doesIO, int timeIO, int amountIO);
 	
 	/**
 	 *	\brief Inflate a stored ProgramFile back into a full file.
 	 *	
+	 *	\param arena The NodeArena that will own the ProgramFile.
 	 *	\param name The name of the ProgramFile that is read from the file.
-	 *	\param stream The stream that contains the rest of the data.
+	 *	\param image The memory-mapped image that contains the rest of the data.
+	 *	\param cursor Where the program data starts, advanced past it.
 	 *	
 	 *	The ProgramFile is read from a binary file and reconstructed from the 
 	 *	data.
 	 *	
-	 *	\return A shared pointer to a ProgramFile to be managed by a Directory
+	 *	\return A pointer to a ProgramFile to be managed by a Directory, or 
+	 *	null if the image was truncated.
 	 */
-	static std::shared_ptr<ProgramFile> inflateProgramFile( std::string& name, 
-		std::ifstream& stream );
+	static ProgramFile* inflateProgramFile( NodeArena& arena, 
+		std::string& name, const ImageFile& image, const char*& cursor );
 
 	/**
 	 *	\brief Validate a user provided name to ensure that it complies with 
@@ -67,8 +74,8 @@ public:
 	 *	\brief Should NOT be used.  Instead use the makeProgramFile function.
 	 * 
 	 *	This should not be used, as it does not fully validate the file name
-	 *	and the ProgramFile will be stack allocated which will make it difficult 
-	 *	to serialize later.
+	 *	and the ProgramFile will not be in a NodeArena which will make it 
+	 *	difficult to serialize later.
 	 * 
 	 *	\param name Name of the ProgramFile
 	 *	\param timeReq How long does this Program take to run
@@ -92,9 +99,33 @@ public:
 	 *	\brief Write the program file out to a stream so that is can be saved 
 	 *	to disk.
 	 *	
-	 *	\param stream The output file stream to write the program's data to.
+	 *	\param writer The image to add the program's data to.
+	 *	\param parent Index of the Directory that holds the program.
+	 */
+	void writeToFile(ImageWriter& writer, std::uint32_t parent) override;
+
+	/**
+	 *	\brief Add up how much room the program takes in an image.
+	 *	
+	 *	\param size Accumulates the node count and payload bytes.
+	 */
+	void measure(ImageSize& size) const override;
+
+	/**
+	 *	\brief Add the ProgramFile to a NodeTable.
+	 *	
+	 *	\param table The table to add a row to.
+	 *	\param parent The row of the Directory that holds the ProgramFile.
+	 */
+	void flatten(NodeTable& table, std::uint32_t parent) const override;
+
+	/**
+	 *	\brief Add the ProgramFile and the memory it needs to a Directory's 
+	 *	totals.
+	 *	
+	 *	\param totals The totals to add to.
 	 */
-	void writeToFile(std::ofstream& stream) override;
+	void tally(SubtreeTotals& totals) const override;
 
 	/**
 	 *	\brief Get how much memory this program requires on the scheduler to 
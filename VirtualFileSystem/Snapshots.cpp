@@ -0,0 +1,123 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "Snapshots.h"
+
+#include <cstring>
+#include <iostream>
+
+/**
+ *	\brief Validate the user entered snapshot name.
+ *	
+ *	\param name The name entered by the user.
+ *	
+ *	Snapshot names follow the same rules as Directory names, at most 8 
+ *	alphabetic characters.
+ *	
+ *	\return True if the name is valid.
+ */
+bool Snapshots::validName( const std::string& name )
+{
+	if( name.empty() || name.length() > 8 )
+	{
+		std::cout << "Snapshot names must be 1 to 8 characters.\n";
+		return false;
+	}
+
+	for( char c : name )
+	{
+		if( !((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) )
+		{
+			std::cout << "Snapshot names must contain only "
+				<< "alphabetic characters.\n";
+			return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+ *	\brief Take a new snapshot of the FileSystem as it is now.
+ *	
+ *	\param name What to call the snapshot.
+ *	
+ *	Everything made so far has a generation no higher than the new snapshot's, 
+ *	and everything made from now on is stamped with the next one.
+ *	
+ *	\return False if the name is taken or there is no room for another 
+ *	snapshot.
+ */
+bool Snapshots::take( const std::string& name )
+{
+	std::uint32_t existing;
+	if( names.size() >= MAX_SNAPSHOTS || find(name, existing) )
+		return false;
+
+	names.push_back(name);
+	return true;
+}
+
+/**
+ *	\brief Look up a snapshot by name.
+ *	
+ *	\param name The snapshot to find.
+ *	\param generation Set to the snapshot's generation if it was found.
+ *	
+ *	\return True if there is a snapshot with that name.
+ */
+bool Snapshots::find( const std::string& name, std::uint32_t& generation ) const
+{
+	for( std::size_t i = 0; i < names.size(); i++)
+	{
+		if( names[i] == name )
+		{
+			generation = static_cast<std::uint32_t>(i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ *	\param generation A snapshot's generation, see find().
+ *	
+ *	\return The name of that snapshot.
+ */
+const std::string& Snapshots::getName( std::uint32_t generation ) const
+{
+	return names.at(generation);
+}
+
+/**
+ *	\return How many snapshots have been taken.
+ */
+std::uint32_t Snapshots::getCount() const
+{
+	return static_cast<std::uint32_t>(names.size());
+}
+
+/**
+ *	\return The generation that new FSObjects are stamped with.
+ */
+std::uint32_t Snapshots::getGeneration() const
+{
+	return getCount();
+}
+
+/**
+ *	\brief Bring back the snapshots that were saved in an image.
+ *	
+ *	\param names The image's snapshot names, 8 null padded chars each.
+ *	\param count How many names there are.
+ */
+void Snapshots::restore( const char* names, std::uint32_t count )
+{
+	this->names.clear();
+	for( std::uint32_t i = 0; i < count; i++, names += 8)
+		this->names.emplace_back(names, strnlen(names, 8));
+}
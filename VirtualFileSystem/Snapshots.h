@@ -0,0 +1,97 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef SNAPSHOTS_H
+#define SNAPSHOTS_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ *	\brief The named snapshots of the FileSystem, in the order they were 
+ *	taken.
+ *	
+ *	Nothing in the FileSystem is ever removed or changed once a snapshot can 
+ *	see it, so a snapshot does not need a copy of the tree.  Every FSObject is 
+ *	stamped with the generation it was made in, which is how many snapshots 
+ *	had been taken at the time, and snapshot number N sees exactly the 
+ *	FSObjects whose generation is N or lower.  Taking a snapshot is just a new 
+ *	name and a bump of the generation.
+ *	
+ *	Editing a TextFile from an older generation replaces it with a new one 
+ *	instead, and the old one is stamped with the generation it was replaced 
+ *	in.  Snapshots from before that keep seeing the old one.
+ */
+class Snapshots
+{
+public:
+	//! The image stores each FSObject's generation in 16 bits
+	static const std::uint32_t MAX_SNAPSHOTS = 0xFFFF;
+
+	/**
+	 *	\brief Validate the user entered snapshot name.
+	 *	
+	 *	\param name The name entered by the user.
+	 *	
+	 *	Snapshot names follow the same rules as Directory names, at most 8 
+	 *	alphabetic characters.
+	 *	
+	 *	\return True if the name is valid.
+	 */
+	static bool validName( const std::string& name );
+
+	/**
+	 *	\brief Take a new snapshot of the FileSystem as it is now.
+	 *	
+	 *	\param name What to call the snapshot.
+	 *	
+	 *	\return False if the name is taken or there is no room for another 
+	 *	snapshot.
+	 */
+	bool take( const std::string& name );
+
+	/**
+	 *	\brief Look up a snapshot by name.
+	 *	
+	 *	\param name The snapshot to find.
+	 *	\param generation Set to the snapshot's generation if it was found.
+	 *	
+	 *	\return True if there is a snapshot with that name.
+	 */
+	bool find( const std::string& name, std::uint32_t& generation ) const;
+
+	/**
+	 *	\param generation A snapshot's generation, see find().
+	 *	
+	 *	\return The name of that snapshot.
+	 */
+	const std::string& getName( std::uint32_t generation ) const;
+
+	/**
+	 *	\return How many snapshots have been taken.
+	 */
+	std::uint32_t getCount() const;
+
+	/**
+	 *	\return The generation that new FSObjects are stamped with.
+	 */
+	std::uint32_t getGeneration() const;
+
+	/**
+	 *	\brief Bring back the snapshots that were saved in an image.
+	 *	
+	 *	\param names The image's snapshot names, 8 null padded chars each.
+	 *	\param count How many names there are.
+	 */
+	void restore( const char* names, std::uint32_t count );
+
+private:
+	//! Every snapshot's name, a snapshot's generation is its index
+	std::vector<std::string> names;
+};
+
+#endif
@@ -5,17 +5,26 @@
 */
 
 #include "TextFile.h"
+#include "ImageWriter.h"
+#include "Compression.h"
+#include "NodeArena.h"
+#include "NodeTable.h"
+#include "ImageBodies.h"
+
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 /**
  *	\brief Create a new TextFile from a given name.  The user will be prompted 
  *	to enter the file contents.
  *	
+ *	\param arena The NodeArena that will own the TextFile.
  *	\param name The name of the TextFile that user gave.
  *	
- *	\return A shared pointer to the newly minted TextFile.
+ *	\return A pointer to the newly minted TextFile.
  */
-std::shared_ptr<TextFile> TextFile::makeTextFile(const std::string& name)
+TextFile* TextFile::makeTextFile(NodeArena& arena, const std::string& name)
 {
 	// Ensure the name is valid
 	std::string n = name;
@@ -30,39 +39,37 @@ std::shared_ptr<TextFile> TextFile::makeTextFile(const std::string& name)
 	std::cout << "Enter file contents>";
 	std::getline(std::cin, contents);
 
-	// Return shared pointer to the TextFile
-	return std::make_shared<TextFile>(n, contents);
+	// Hand the new TextFile back, the arena owns it
+	return arena.make<TextFile>(n, contents);
 }
 
 /**
- *	\brief Inflate a TextFile from a flat binary file.
+ *	\brief Inflate a TextFile from a memory-mapped image.
  *	
+ *	\param arena The NodeArena that will own the TextFile.
  *	\param name The name of the TextFile
- *	\param stream The stream to read the contents of the file from.
+ *	\param image The image that the TextFile is stored in.
+ *	\param body Where the body starts inside of the image.
+ *	\param length How many bytes are in the body.
+ *	\param flags The NodeFlags of the body, saying how it is stored
  *	
- *	The TextFile can be loaded from a binary stream back into a full object on 
- *	the heap.  This is done using shared pointers to allow directories to 
- *	manage the memory and re-serialize the file system when needed.
+ *	The body is not copied out of the image.  The TextFile references it in 
+ *	place and keeps the image mapped until the body is needed as a string, a 
+ *	compressed body is only expanded then.
  *	
- *	\return A shared pointer to the new TextFile that should be handled by a 
+ *	\return A pointer to the new TextFile that should be handled by a 
  *	Directory.
  */
-std::shared_ptr<TextFile> TextFile::inflateTextFile(std::string& name, 
-	std::ifstream& stream)
+TextFile* TextFile::inflateTextFile( NodeArena& arena, std::string& name, 
+	const std::shared_ptr<ImageFile>& image, const char* body, 
+	std::size_t length, std::uint8_t flags )
 {
 	// Test the filename in-case of corruption
 	std::string n = name;
 	validName(&n);
 
-	// Read in chars until we hit the end of the string
-	char ch;
-	std::string contents;
-	while ((ch = stream.get()) != '\0') {
-		contents += ch;
-	}
-
-	// Create a new TextFile
-	return std::make_shared<TextFile>(n, contents);
+	// Create a new TextFile that points back into the image
+	return arena.make<TextFile>(n, image, body, length, flags);
 }
 
 /**
@@ -113,17 +120,65 @@ bool TextFile::validName( std::string* name)
  *	function makeTextFile().
  *	
  *	\param name The name of the TextFile
- *	\param contents The body of the TextFile
+ *	\param contents The body of the TextFile, shared with every other TextFile 
+ *	that has the same body
  *	
- *	This constructor should NOT be used.  The system relies on the use of shared 
- *	pointers to manage the files contained in directories.  Using the 
- *	constructor directly will violate this structure and cause the file to not 
- *	be serialize when the file system is saved.
+ *	This constructor should NOT be called directly.  Every FSObject is made 
+ *	with NodeArena::make(), the arena owns it until the whole arena is 
+ *	released, and Directories only hold plain pointers to it.  A TextFile 
+ *	made any other way can be freed while a Directory still points at it.
  */
 TextFile::TextFile(const std::string& name, const std::string& contents)
+	: File(NODE_TEXT), contents(BlobStore::intern(contents))
+{
+	fileName = name;
+}
+
+/**
+ *	\brief Constructor that should NOT be used.  Instead use the factory 
+ *	function makeTextFile().
+ *	
+ *	\param name The name of the TextFile
+ *	\param contents A body that was already taken from BlobStore::intern()
+ *	
+ *	Used where bodies are interned on other threads, so the TextFile only has 
+ *	to be made here.
+ */
+TextFile::TextFile(const std::string& name, 
+	std::shared_ptr<const Blob> contents)
+	: File(NODE_TEXT), contents(std::move(contents))
+{
+	fileName = name;
+}
+
+/**
+ *	\brief Constructor that should NOT be used.  Instead use the factory 
+ *	function inflateTextFile().
+ *	
+ *	\param name The name of the TextFile
+ *	\param image The image that holds the body
+ *	\param body First byte of the body inside the image
+ *	\param length Number of bytes in the body
+ *	\param flags The NodeFlags of the body, saying how it is stored
+ */
+TextFile::TextFile(const std::string& name, std::shared_ptr<ImageFile> image, 
+	const char* body, std::size_t length, std::uint8_t flags)
+	: File(NODE_TEXT), image(std::move(image)), mappedContents(body), 
+	mappedLength(length), mappedFlags(flags)
+{
+	fileName = name;
+}
+
+/**
+ *	\brief Constructor that should NOT be used.  Instead use replace().
+ *	
+ *	\param name The name of the TextFile
+ *	\param body The body, shared with the TextFile it was copied from
+ */
+TextFile::TextFile(const Name& name, const TextRope& body)
+	: File(NODE_TEXT), rope(new TextRope(body))
 {
 	fileName = name;
-	fileContents = contents;
 }
 
 /**
@@ -141,35 +196,451 @@ void TextFile::printData(int tabs)
 /**
  *	\brief Serialize the TextFile to a binary file steam.
  *	
- *	\param stream where to write the TextFile to.
+ *	\param writer The image to add the TextFile to.
+ *	\param parent Index of the Directory that holds the TextFile.
+ */
+void TextFile::writeToFile(ImageWriter& writer, std::uint32_t parent)
+{
+	// Any other body is already in the image, measure() added it
+	if( !rope )
+	{
+		const char* body;
+		std::size_t length;
+		std::uint8_t flags;
+		getStored(body, length, flags);
+		writer.addText(fileName, parent, body, length, flags, generation, 
+			replaced);
+	}
+
+	// measure() has already decided whether the body is worth compressing
+	else if( !compressedContents.empty() )
+		writer.addNode(NODE_TEXT, fileName, parent, compressedContents.data(), 
+			compressedContents.length(), compressedFlags, generation, replaced);
+
+	// An edited body is copied in a piece at a time
+	else
+	{
+		const auto index = writer.addNode(NODE_TEXT, fileName, parent, nullptr, 
+			static_cast<std::size_t>(rope->length()), 0, generation, replaced);
+
+		char* payload = writer.getPayload(index);
+		if( payload )
+			rope->forEach(0, rope->length(), 
+				[&payload]( const char* data, std::size_t length )
+			{
+				std::memcpy(payload, data, length);
+				payload += length;
+			});
+	}
+}
+
+/**
+ *	\brief Add up how much room the TextFile takes in an image.
+ *	
+ *	\param size Accumulates the node count and payload bytes, and the body if 
+ *	it is one the image stores once for every TextFile that has it.
+ *	
+ *	A large body is compressed here the first time the TextFile is saved, and 
+ *	the compressed block is kept for every save after.
  */
-void TextFile::writeToFile(std::ofstream& stream)
+void TextFile::measure(ImageSize& size) const
 {
-	// Write the filename to the stream
-	stream << fileName;
+	size.nodeCount++;
 
-	// Fill remaining spaces with null chars as per spec
-	for( int i = fileName.length(); i < 8; i++)
+	// Bodies that are in one piece are shared with every TextFile that has 
+	//	the same bytes, they take no payload of the TextFile's own
+	if( !rope )
 	{
-		stream << '\0';
+		const char* body;
+		std::size_t length;
+		std::uint8_t flags;
+		getStored(body, length, flags);
+		if( size.bodies )
+			size.bodies->add(body, length, flags);
+		return;
 	}
 
-	// Write the file's extension to the stream
-	stream << ".t";
-	stream << '\0';
+	// Only keep the compressed block if it really is smaller
+	const std::size_t length = static_cast<std::size_t>(rope->length());
+	if( !compressionChecked && length >= TEXT_COMPRESS_THRESHOLD )
+	{
+		// An edited body is gathered up one frame at a time
+		std::string frame;
+		compressedContents = compressFramed(length, TEXT_FRAME_SIZE, 
+			[this, &frame]( std::uint64_t offset, std::size_t size )
+		{
+			return rope->read(offset, size, frame);
+		});
+		compressedFlags = NODE_COMPRESSED | NODE_FRAMED;
+		if( compressedContents.length() >= length )
+			std::string().swap(compressedContents);
+	}
+	compressionChecked = true;
 
-	// Write the contents to the stream
-	stream << fileContents;
-	stream << '\0';
+	if( !compressedContents.empty() )
+		size.payloadSize += compressedContents.length();
+	else
+		size.payloadSize += length;
+}
+
+/**
+ *	\brief Add the TextFile to a NodeTable.
+ *	
+ *	\param table The table to add a row to.
+ *	\param parent The row of the Directory that holds the TextFile.
+ */
+void TextFile::flatten(NodeTable& table, std::uint32_t parent) const
+{
+	table.addRow(NODE_TEXT, fileName, parent, generation, replaced, getSize(), 
+		this);
+}
+
+/**
+ *	\brief Add the TextFile and the bytes in its body to a Directory's totals.
+ *	
+ *	\param totals The totals to add to.
+ */
+void TextFile::tally(SubtreeTotals& totals) const
+{
+	// Totals are for the live FileSystem, which only sees the replacement
+	if( replaced != LIVE_GENERATION )
+		return;
+
+	totals.nodes++;
+	totals.textBytes += getSize();
 }
 
 /**
  *	\brief Get the Text file's contents.  The body of the file that was
  *	entered by the user at creation.
  *	
- *	\return The contents of the file as entered by the user.
+ *	An edited body has to be gathered into one string for this, which is 
+ *	kept until the next edit.  appendContents() and print() read it where it 
+ *	is.
+ *	
+ *	\return The contents of the file as entered by the user, valid until the 
+ *	next edit.
  */
 const std::string& TextFile::getContents() const
 {
-	return fileContents;
+	// An edited body is gathered up once, and kept until the next edit
+	if( rope )
+	{
+		if( !contentsGathered )
+		{
+			gathered.clear();
+			appendContents(gathered);
+			contentsGathered = true;
+		}
+		return gathered;
+	}
+
+	// Copy the body out of the image the first time it is needed
+	else if( image && (mappedFlags & NODE_COMPRESSED) )
+	{
+		std::string expanded;
+		if( !expand(mappedContents, mappedLength, mappedFlags, expanded) )
+			std::cout << "The body of <" << fileName << ".t> is damaged.\n";
+		contents = BlobStore::intern(std::move(expanded));
+
+		// Keep the block, so saving does not have to compress it again
+		contents->keepStored(mappedContents, mappedLength, mappedFlags);
+		image.reset();
+	}
+	else if( image )
+	{
+		contents = BlobStore::intern(std::string(mappedContents, mappedLength));
+		image.reset();
+	}
+
+	return contents->getBytes();
+}
+
+/**
+ *	\brief Add the body to the end of a string, without keeping a copy.
+ *	
+ *	\param output Where to add the body.
+ *	
+ *	Unlike getContents(), a body that is still in the image stays there.
+ *	
+ *	\return False if the body is damaged.
+ */
+bool TextFile::appendContents( std::string& output ) const
+{
+	if( rope )
+		rope->forEach(0, rope->length(), 
+			[&output]( const char* data, std::size_t length )
+		{
+			output.append(data, length);
+		});
+	else if( !image )
+		output += contents->getBytes();
+	else if( !(mappedFlags & NODE_COMPRESSED) )
+		output.append(mappedContents, mappedLength);
+	else
+	{
+		std::string expanded;
+		if( !expand(mappedContents, mappedLength, mappedFlags, expanded) )
+			return false;
+		output += expanded;
+	}
+
+	return true;
+}
+
+/**
+ *	\brief Expand a compressed body.
+ *	
+ *	\param block The compressed body
+ *	\param length How many bytes are in the block
+ *	\param flags The NodeFlags of the body, saying how it is stored
+ *	\param output Replaced with the body
+ *	
+ *	\return False if the body is damaged.
+ */
+bool TextFile::expand( const char* block, std::size_t length, 
+	std::uint8_t flags, std::string& output )
+{
+	// Compressed bodies are always framed
+	output.clear();
+	if( !(flags & NODE_FRAMED) )
+		return false;
+
+	FramedBlock framed;
+	if( !openFramed(block, length, framed) )
+		return false;
+
+	output.reserve(static_cast<std::size_t>(framed.length));
+	std::string frame;
+	for( std::uint32_t i = 0; i < framed.frameCount; i++)
+	{
+		if( !decompressFrame(framed, i, frame) )
+		{
+			output.clear();
+			return false;
+		}
+		output += frame;
+	}
+
+	return true;
+}
+
+/**
+ *	\brief Get the length of the body, without reading the body.
+ *	
+ *	\return How many bytes are in the body.
+ */
+std::uint64_t TextFile::getSize() const
+{
+	if( rope )
+		return rope->length();
+	if( !image )
+		return contents->getBytes().length();
+
+	// Compressed blocks of both kinds start with the original length
+	if( (mappedFlags & NODE_COMPRESSED) && mappedLength >= sizeof(std::uint64_t) )
+	{
+		std::uint64_t length;
+		std::memcpy(&length, mappedContents, sizeof(length));
+		return length;
+	}
+
+	return mappedLength;
+}
+
+/**
+ *	\brief Print part of the body, TEXT_FRAME_SIZE bytes at a time.
+ *	
+ *	\param out Where to print the body
+ *	\param offset The first byte to print
+ *	\param length The most bytes to print, it stops early at the end
+ *	
+ *	Only the frames that hold the requested bytes are read, and the body is 
+ *	never built up as a whole string unless it already is one.
+ *	
+ *	\return False if the body is damaged.
+ */
+bool TextFile::print( std::ostream& out, std::uint64_t offset, 
+	std::uint64_t length ) const
+{
+	// An edited body is printed a piece at a time
+	if( rope )
+	{
+		rope->forEach(offset, length, [&out]( const char* data, std::size_t size )
+		{
+			out.write(data, static_cast<std::streamsize>(size));
+		});
+		return true;
+	}
+
+	// A raw body is printed straight out of the image or the string
+	if( !image || !(mappedFlags & NODE_COMPRESSED) )
+	{
+		const char* body = image ? mappedContents : contents->getBytes().data();
+		const std::uint64_t size = image ? mappedLength : 
+			contents->getBytes().length();
+
+		if( offset >= size )
+			return true;
+		const std::uint64_t end = size - offset < length ? size : offset + length;
+
+		for( std::uint64_t at = offset; at < end; at += TEXT_FRAME_SIZE)
+			out.write(body + at, static_cast<std::streamsize>(
+				std::min<std::uint64_t>(TEXT_FRAME_SIZE, end - at)));
+
+		return true;
+	}
+
+	FramedBlock framed;
+	if( !(mappedFlags & NODE_FRAMED) || 
+		!openFramed(mappedContents, mappedLength, framed) )
+		return false;
+
+	if( offset >= framed.length )
+		return true;
+	const std::uint64_t end = framed.length - offset < length ? 
+		framed.length : offset + length;
+
+	// Expand one frame at a time, only the ones that overlap the range
+	std::string frame;
+	for( std::uint32_t i = static_cast<std::uint32_t>(offset / framed.frameSize);
+		i < framed.frameCount; i++)
+	{
+		const std::uint64_t start = static_cast<std::uint64_t>(i) * 
+			framed.frameSize;
+		if( start >= end )
+			break;
+
+		if( !decompressFrame(framed, i, frame) )
+			return false;
+
+		const std::uint64_t from = offset > start ? offset - start : 0;
+		const std::uint64_t to = std::min<std::uint64_t>(frame.length(), 
+			end - start);
+		out.write(frame.data() + from, static_cast<std::streamsize>(to - from));
+	}
+
+	return true;
+}
+
+/**
+ *	\brief Replace part of the body.
+ *	
+ *	\param offset The first byte to replace, past the end is the end
+ *	\param length How many bytes to replace, 0 to only insert
+ *	\param text What goes in their place
+ *	
+ *	The first edit moves the body into a TextRope, a body that is still in the 
+ *	image is not copied out to do it unless it is compressed.  Use 
+ *	Directory::editTextfile() so that snapshots and totals are looked after.
+ */
+void TextFile::edit( std::uint64_t offset, std::uint64_t length, 
+	const std::string& text )
+{
+	makeRope();
+
+	if( offset >= rope->length() )
+		rope->append(text.data(), text.length());
+	else
+		rope->replace(offset, length, text.data(), text.length());
+
+	// The body has changed, so it has to be compressed and gathered again
+	std::string().swap(compressedContents);
+	compressionChecked = false;
+	std::string().swap(gathered);
+	contentsGathered = false;
+}
+
+/**
+ *	\brief Make the TextFile that takes this one's place, so that the body can 
+ *	be edited without changing what snapshots see.
+ *	
+ *	\param arena The NodeArena that will own the new TextFile.
+ *	\param generation The generation the new TextFile is made in.
+ *	
+ *	The new TextFile shares this one's body until it is edited, and this one is 
+ *	marked as replaced in that generation.
+ *	
+ *	\return The new TextFile, it still has to be added to the Directory.
+ */
+TextFile* TextFile::replace( NodeArena& arena, std::uint32_t generation )
+{
+	makeRope();
+
+	replacement = arena.make<TextFile>(fileName, *rope);
+	replacement->setGeneration(generation);
+	setReplaced(generation);
+
+	return replacement;
+}
+
+/**
+ *	\return The TextFile that replaced this one, null if none has.
+ */
+TextFile* TextFile::getReplacement() const
+{
+	return replacement;
+}
+
+/**
+ *	\brief Link this TextFile to the one that replaced it, once they are both 
+ *	loaded from an image.
+ *	
+ *	\param next The TextFile that replaced this one.
+ */
+void TextFile::setReplacement( TextFile* next )
+{
+	replacement = next;
+}
+
+/**
+ *	\brief Get the body the way it is saved in an image, for any body that is 
+ *	not in a TextRope.
+ *	
+ *	\param body Set to the first byte.
+ *	\param length Set to how many bytes there are.
+ *	\param flags Set to the NodeFlags that say how it is stored.
+ *	
+ *	A body still in the old image is saved just as it is there.
+ */
+void TextFile::getStored( const char*& body, std::size_t& length, 
+	std::uint8_t& flags ) const
+{
+	if( image )
+	{
+		body = mappedContents;
+		length = mappedLength;
+		flags = mappedFlags;
+		return;
+	}
+
+	const std::string& stored = contents->getStored(flags);
+	body = stored.data();
+	length = stored.length();
+}
+
+/**
+ *	\brief Move the body into rope, if it is not there already.
+ *	
+ *	A raw body in the image becomes the rope's first piece right where it is, 
+ *	and keeps the image mapped.  A compressed body has to be expanded first.  
+ *	Either way, the other TextFiles that share the body keep it unchanged.
+ */
+void TextFile::makeRope()
+{
+	if( rope )
+		return;
+
+	if( image && !(mappedFlags & NODE_COMPRESSED) )
+	{
+		rope.reset(new TextRope(std::move(image), mappedContents, 
+			mappedLength));
+		image.reset();
+		return;
+	}
+
+	// The Blob stays shared, the rope only holds on to it
+	const std::string& body = getContents();
+	rope.reset(new TextRope(contents, body.data(), body.length()));
+	contents.reset();
 }
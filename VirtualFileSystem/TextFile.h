@@ -9,8 +9,13 @@
 
 #include <string>
 #include <memory>
+#include <ostream>
 #include "File.h"
+#include "ImageFile.h"
+#include "TextRope.h"
+#include "BlobStore.h"
 
+class NodeArena;
 
 /**
  *	\brief A special type of File that is designed to hold a single string 
@@ -23,27 +28,33 @@ public:
 	 *	\brief Create a new TextFile from a given name.  The user will be 
 	 *	prompted to enter the file contents.
 	 *	
+	 *	\param arena The NodeArena that will own the TextFile.
 	 *	\param name The name of the TextFile that user gave.
 	 *	
-	 *	\return A shared pointer to the newly minted TextFile.
+	 *	\return A pointer to the newly minted TextFile.
 	 */
-	static std::shared_ptr<TextFile> makeTextFile( const std::string& name );
+	static TextFile* makeTextFile( NodeArena& arena, const std::string& name );
 	
 	/**
-	 *	\brief Inflate a TextFile from a flat binary file.
+	 *	\brief Inflate a TextFile from a memory-mapped image.
 	 *	
+	 *	\param arena The NodeArena that will own the TextFile.
 	 *	\param name The name of the TextFile
-	 *	\param stream The stream to read the contents of the file from.
+	 *	\param image The image that the TextFile is stored in.
+	 *	\param body Where the body starts inside of the image.
+	 *	\param length How many bytes are in the body.
+	 *	\param flags The NodeFlags of the body, saying how it is stored
 	 *	
-	 *	The TextFile can be loaded from a binary stream back into a full object 
-	 *	on the heap.  This is done using shared pointers to allow directories 
-	 *	to manage the memory and re-serialize the file system when needed.
+	 *	The body is not copied out of the image.  The TextFile references it 
+	 *	in place and keeps the image mapped until the body is needed as a 
+	 *	string, a compressed body is only expanded then.
 	 *	
-	 *	\return A shared pointer to the new TextFile that should be handled by 
-	 *	a Directory.
+	 *	\return A pointer to the new TextFile that should be handled by a 
+	 *	Directory.
 	 */
-	static std::shared_ptr<TextFile> inflateTextFile(  std::string& name, 
-		std::ifstream& stream);
+	static TextFile* inflateTextFile( NodeArena& arena, std::string& name, 
+		const std::shared_ptr<ImageFile>& image, const char* body, 
+		std::size_t length, std::uint8_t flags );
 	
 	/**
 	 *	\brief Check to see if the name follows the rules for a TextFile as 
@@ -60,15 +71,47 @@ public:
 	 *	function makeTextFile().
 	 *	
 	 *	\param name The name of the TextFile
-	 *	\param contents The body of the TextFile
+	 *	\param contents The body of the TextFile, shared with every other 
+	 *	TextFile that has the same body
 	 *	
-	 *	This constructor should NOT be used.  The system relies on the use of 
-	 *	shared pointers to manage the files contained in directories.  Using the
-	 *	constructor directly will violate this structure and cause the file to 
-	 *	not be serialize when the file system is saved.
+	 *	This constructor should NOT be called directly.  Every FSObject is 
+	 *	made with NodeArena::make(), the arena owns it until the whole arena 
+	 *	is released, and Directories only hold plain pointers to it.  A 
+	 *	TextFile made any other way can be freed while a Directory still 
+	 *	points at it.
 	 */
 	TextFile(const std::string& name, const std::string& contents);
 
+	/**
+	 *	\brief Constructor that should NOT be used.  Instead use the factory 
+	 *	function makeTextFile().
+	 *	
+	 *	\param name The name of the TextFile
+	 *	\param contents A body that was already taken from BlobStore::intern()
+	 */
+	TextFile(const std::string& name, std::shared_ptr<const Blob> contents);
+
+	/**
+	 *	\brief Constructor that should NOT be used.  Instead use the factory 
+	 *	function inflateTextFile().
+	 *	
+	 *	\param name The name of the TextFile
+	 *	\param image The image that holds the body
+	 *	\param body First byte of the body inside the image
+	 *	\param length Number of bytes in the body
+	 *	\param flags The NodeFlags of the body, saying how it is stored
+	 */
+	TextFile(const std::string& name, std::shared_ptr<ImageFile> image, 
+		const char* body, std::size_t length, std::uint8_t flags);
+
+	/**
+	 *	\brief Constructor that should NOT be used.  Instead use replace().
+	 *	
+	 *	\param name The name of the TextFile
+	 *	\param body The body, shared with the TextFile it was copied from
+	 */
+	TextFile(const Name& name, const TextRope& body);
+
 	/**
 	 *	\brief Formatted printer for TextFiles as per spec.
 	 *	
@@ -79,21 +122,196 @@ public:
 	/**
 	 *	\brief Serialize the TextFile to a binary file steam.
 	 *	
-	 *	\param stream where to write the TextFile to.
+	 *	\param writer The image to add the TextFile to.
+	 *	\param parent Index of the Directory that holds the TextFile.
+	 */
+	void writeToFile(ImageWriter& writer, std::uint32_t parent) override;
+
+	/**
+	 *	\brief Add up how much room the TextFile takes in an image.
+	 *	
+	 *	\param size Accumulates the node count and payload bytes, and the 
+	 *	body if it is one the image stores once for every TextFile that has it.
+	 *	
+	 *	A large body is compressed here the first time the TextFile is saved, 
+	 *	and the compressed block is kept for every save after.
 	 */
-	void writeToFile(std::ofstream& stream) override;
+	void measure(ImageSize& size) const override;
+
+	/**
+	 *	\brief Add the TextFile to a NodeTable.
+	 *	
+	 *	\param table The table to add a row to.
+	 *	\param parent The row of the Directory that holds the TextFile.
+	 */
+	void flatten(NodeTable& table, std::uint32_t parent) const override;
+
+	/**
+	 *	\brief Add the TextFile and the bytes in its body to a Directory's 
+	 *	totals.
+	 *	
+	 *	\param totals The totals to add to.
+	 */
+	void tally(SubtreeTotals& totals) const override;
 
 	/**
 	 *	\brief Get the Text file's contents.  The body of the file that was
 	 *	entered by the user at creation.
 	 *	
-	 *	\return The contents of the file as entered by the user.
+	 *	An edited body has to be gathered into one string for this, which is 
+	 *	kept until the next edit.  appendContents() and print() read it where 
+	 *	it is.
+	 *	
+	 *	\return The contents of the file as entered by the user, valid until 
+	 *	the next edit.
 	 */
 	const std::string& getContents() const;
+
+	/**
+	 *	\brief Add the body to the end of a string, without keeping a copy.
+	 *	
+	 *	\param output Where to add the body.
+	 *	
+	 *	Unlike getContents(), a body that is still in the image stays there.
+	 *	
+	 *	\return False if the body is damaged.
+	 */
+	bool appendContents( std::string& output ) const;
+
+	/**
+	 *	\brief Get the length of the body, without reading the body.
+	 *	
+	 *	\return How many bytes are in the body.
+	 */
+	std::uint64_t getSize() const;
+
+	/**
+	 *	\brief Print part of the body, TEXT_FRAME_SIZE bytes at a time.
+	 *	
+	 *	\param out Where to print the body
+	 *	\param offset The first byte to print
+	 *	\param length The most bytes to print, it stops early at the end
+	 *	
+	 *	Only the frames that hold the requested bytes are read, and the body is 
+	 *	never built up as a whole string unless it already is one.
+	 *	
+	 *	\return False if the body is damaged.
+	 */
+	bool print( std::ostream& out, std::uint64_t offset, 
+		std::uint64_t length ) const;
+
+	/**
+	 *	\brief Expand a compressed body.
+	 *	
+	 *	\param block The compressed body
+	 *	\param length How many bytes are in the block
+	 *	\param flags The NodeFlags of the body, saying how it is stored
+	 *	\param output Replaced with the body
+	 *	
+	 *	\return False if the body is damaged.
+	 */
+	static bool expand( const char* block, std::size_t length, 
+		std::uint8_t flags, std::string& output );
+
+	/**
+	 *	\brief Replace part of the body.
+	 *	
+	 *	\param offset The first byte to replace, past the end is the end
+	 *	\param length How many bytes to replace, 0 to only insert
+	 *	\param text What goes in their place
+	 *	
+	 *	The first edit moves the body into a TextRope, a body that is still in 
+	 *	the image is not copied out to do it unless it is compressed.  Use 
+	 *	Directory::editTextfile() so that snapshots and totals are looked 
+	 *	after.
+	 */
+	void edit( std::uint64_t offset, std::uint64_t length, 
+		const std::string& text );
+
+	/**
+	 *	\brief Make the TextFile that takes this one's place, so that the body 
+	 *	can be edited without changing what snapshots see.
+	 *	
+	 *	\param arena The NodeArena that will own the new TextFile.
+	 *	\param generation The generation the new TextFile is made in.
+	 *	
+	 *	The new TextFile shares this one's body until it is edited, and this 
+	 *	one is marked as replaced in that generation.
+	 *	
+	 *	\return The new TextFile, it still has to be added to the Directory.
+	 */
+	TextFile* replace( NodeArena& arena, std::uint32_t generation );
+
+	/**
+	 *	\return The TextFile that replaced this one, null if none has.
+	 */
+	TextFile* getReplacement() const;
+
+	/**
+	 *	\brief Link this TextFile to the one that replaced it, once they are 
+	 *	both loaded from an image.
+	 *	
+	 *	\param next The TextFile that replaced this one.
+	 */
+	void setReplacement( TextFile* next );
 	
 private:
-	//! The text contents, of body, of this TextFile
-	std::string fileContents;
+	/**
+	 *	\brief Move the body into rope, if it is not there already.
+	 */
+	void makeRope();
+
+	/**
+	 *	\brief Get the body the way it is saved in an image, for any body 
+	 *	that is not in a TextRope.
+	 *	
+	 *	\param body Set to the first byte.
+	 *	\param length Set to how many bytes there are.
+	 *	\param flags Set to the NodeFlags that say how it is stored.
+	 */
+	void getStored( const char*& body, std::size_t& length, 
+		std::uint8_t& flags ) const;
+
+	//! The text contents, of body, of this TextFile, shared with every 
+	//!	TextFile that has the same body.  Only valid while image and rope are 
+	//!	not set.
+	mutable std::shared_ptr<const Blob> contents;
+
+	//! The image that the body still lives in, null once it is copied out
+	mutable std::shared_ptr<ImageFile> image;
+
+	//! The body inside of the image, only valid while image is set
+	const char* mappedContents = nullptr;
+
+	//! Length of the body inside of the image
+	std::size_t mappedLength = 0;
+
+	//! How the body inside of the image is stored, any of NodeFlags
+	std::uint8_t mappedFlags = 0;
+
+	//! An edited body as a compressed block, empty if it is not worth 
+	//!	compressing.  Every other body keeps its block in its Blob.
+	mutable std::string compressedContents;
+
+	//! How compressedContents is stored, any of NodeFlags
+	mutable std::uint8_t compressedFlags = 0;
+
+	//! Has the edited body been checked for compression yet?
+	mutable bool compressionChecked = false;
+
+	//! The edited body gathered into one string by getContents(), only 
+	//!	valid while contentsGathered is set.
+	mutable std::string gathered;
+
+	//! Has the edited body been gathered since it was last edited?
+	mutable bool contentsGathered = false;
+
+	//! The body once it has been edited, null until then.  contents and 
+	//!	image are not used after that.
+	std::unique_ptr<TextRope> rope;
+
+	//! The TextFile that replaced this one, null if none has
+	TextFile* replacement = nullptr;
 };
 
 #endif
\ No newline at end of file
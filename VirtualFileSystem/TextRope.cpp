@@ -0,0 +1,322 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "TextRope.h"
+
+#include <algorithm>
+
+/**
+ *	\brief Pick a treap priority for a new piece.
+ *	
+ *	\param data The first byte of the piece.
+ *	
+ *	Priorities only have to look random, and no two live pieces start at the 
+ *	same byte, so the address is mixed up rather than keeping a generator.
+ *	
+ *	\return The priority.
+ */
+static std::uint32_t priorityOf( const char* data )
+{
+	std::uint64_t x = reinterpret_cast<std::uintptr_t>(data);
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return static_cast<std::uint32_t>(x);
+}
+
+/**
+ *	\brief Start with bytes that something else keeps alive, like a mapped 
+ *	image, without copying them.
+ *	
+ *	\param owner Kept for as long as any piece needs the bytes.
+ *	\param data The first byte.
+ *	\param length How many bytes there are.
+ */
+TextRope::TextRope( std::shared_ptr<const void> owner, const char* data, 
+	std::size_t length )
+{
+	if( length )
+		push(Piece{std::move(owner), data, length});
+}
+
+/**
+ *	\return How many bytes are in the body.
+ */
+std::uint64_t TextRope::length() const
+{
+	return length(root) + (tail ? tail->length() : 0);
+}
+
+/**
+ *	\brief Add bytes to the end of the body.
+ *	
+ *	\param data The bytes to add.
+ *	\param length How many there are.
+ *	
+ *	The bytes go into the tail, unless a copy of this TextRope can still see 
+ *	the tail.  Then the tail is closed off first, the copy only ever reads as 
+ *	many bytes of it as it had.
+ */
+void TextRope::append( const char* data, std::size_t length )
+{
+	if( length == 0 )
+		return;
+
+	if( tail && tail.use_count() > 1 )
+		closeTail();
+	if( !tail )
+		tail = std::make_shared<std::string>();
+
+	tail->append(data, length);
+	if( tail->length() >= TAIL_SIZE )
+		closeTail();
+}
+
+/**
+ *	\brief Replace a run of the body with other bytes.
+ *	
+ *	\param offset The first byte to replace, at most length().
+ *	\param length How many bytes to replace, it stops at the end.
+ *	\param data The bytes that go in their place.
+ *	\param dataLength How many of them there are, 0 to just remove bytes.
+ *	
+ *	The tree is cut around the run and joined back up without it, the pieces 
+ *	on either side are shared rather than copied.
+ */
+void TextRope::replace( std::uint64_t offset, std::uint64_t length, 
+	const char* data, std::size_t dataLength )
+{
+	closeTail();
+
+	Link before;
+	Link rest;
+	split(root, std::min(offset, TextRope::length(root)), before, rest);
+
+	Link removed;
+	Link after;
+	split(rest, std::min(length, TextRope::length(rest)), removed, after);
+
+	if( dataLength )
+	{
+		const auto owned = std::make_shared<const std::string>(data, dataLength);
+		before = merge(before, make(Piece{owned, owned->data(), dataLength}, 
+			nullptr, nullptr, priorityOf(owned->data())));
+	}
+
+	root = merge(before, after);
+}
+
+/**
+ *	\brief Visit part of the body, a piece at a time, in order.
+ *	
+ *	\param offset The first byte to visit.
+ *	\param length The most bytes to visit, it stops early at the end.
+ *	\param visit Called with each run of bytes and how long it is.
+ */
+void TextRope::forEach( std::uint64_t offset, std::uint64_t length, 
+	const std::function<void( const char*, std::size_t )>& visit ) const
+{
+	const std::uint64_t size = TextRope::length();
+	if( offset >= size )
+		return;
+	const std::uint64_t end = size - offset < length ? size : offset + length;
+
+	// The tree holds the front of the body and the tail the rest
+	const std::uint64_t treeLength = TextRope::length(root);
+	visitRange(root, 0, offset, std::min(end, treeLength), visit);
+
+	if( end > treeLength )
+	{
+		const std::uint64_t from = std::max(offset, treeLength) - treeLength;
+		visit(tail->data() + from, 
+			static_cast<std::size_t>(end - treeLength - from));
+	}
+}
+
+/**
+ *	\brief Get part of the body as one run of bytes.
+ *	
+ *	\param offset The first byte, the run has to be inside of the body.
+ *	\param length How many bytes.
+ *	\param scratch Holds the run if it spans more than one piece.
+ *	
+ *	\return The first byte of the run, inside a piece if it fits in one.
+ */
+const char* TextRope::read( std::uint64_t offset, std::size_t length, 
+	std::string& scratch ) const
+{
+	const char* whole = nullptr;
+	scratch.clear();
+
+	forEach(offset, length, [&]( const char* data, std::size_t size )
+	{
+		if( size == length )
+			whole = data;
+		else
+			scratch.append(data, size);
+	});
+
+	return whole ? whole : scratch.data();
+}
+
+//! \return How many bytes are in a subtree, 0 for none
+std::uint64_t TextRope::length( const Link& node )
+{
+	return node ? node->length : 0;
+}
+
+//! \return A new node, with its length worked out from its children
+TextRope::Link TextRope::make( const Piece& piece, const Link& left, 
+	const Link& right, std::uint32_t priority )
+{
+	return std::make_shared<const Node>(Node{piece, left, right, 
+		length(left) + piece.length + length(right), priority});
+}
+
+/**
+ *	\brief Cut a subtree in two.
+ *	
+ *	\param node The subtree.
+ *	\param offset How many bytes go into left, a piece that spans it is cut 
+ *	in two.
+ *	\param left Set to the bytes before offset.
+ *	\param right Set to the bytes from offset on.
+ *	
+ *	Only the nodes on the path down to offset are rebuilt.  The two halves of 
+ *	a cut piece are given their own priorities and merged back in, a body 
+ *	that is cut up many times would otherwise fill with equal priorities and 
+ *	the tree would stop being balanced.
+ */
+void TextRope::split( const Link& node, std::uint64_t offset, Link& left, 
+	Link& right )
+{
+	// Cutting at either end does not change anything
+	if( offset == 0 || !node )
+	{
+		left = nullptr;
+		right = node;
+		return;
+	}
+	if( offset >= node->length )
+	{
+		left = node;
+		right = nullptr;
+		return;
+	}
+
+	const std::uint64_t leftLength = length(node->left);
+	const std::uint64_t pieceEnd = leftLength + node->piece.length;
+
+	if( offset <= leftLength )
+	{
+		Link inside;
+		split(node->left, offset, left, inside);
+		right = make(node->piece, inside, node->right, node->priority);
+	}
+	else if( offset >= pieceEnd )
+	{
+		Link inside;
+		split(node->right, offset - pieceEnd, inside, right);
+		left = make(node->piece, node->left, inside, node->priority);
+	}
+	else
+	{
+		const std::size_t cut = static_cast<std::size_t>(offset - leftLength);
+		const Piece& piece = node->piece;
+		const Piece front{piece.owner, piece.data, cut};
+		const Piece back{piece.owner, piece.data + cut, piece.length - cut};
+		left = merge(node->left, make(front, nullptr, nullptr, 
+			priorityOf(front.data)));
+		right = merge(make(back, nullptr, nullptr, priorityOf(back.data)), 
+			node->right);
+	}
+}
+
+/**
+ *	\brief Join two subtrees, every byte of left comes first.
+ *	
+ *	\param left The subtree that goes first.
+ *	\param right The subtree that goes after it.
+ *	
+ *	\return The joined subtree.
+ */
+TextRope::Link TextRope::merge( const Link& left, const Link& right )
+{
+	if( !left )
+		return right;
+	if( !right )
+		return left;
+
+	// Whichever root has the higher priority stays on top
+	if( left->priority >= right->priority )
+		return make(left->piece, left->left, merge(left->right, right), 
+			left->priority);
+
+	return make(right->piece, merge(left, right->left), right->right, 
+		right->priority);
+}
+
+/**
+ *	\brief Visit the part of a subtree that overlaps a range.
+ *	
+ *	\param node The subtree.
+ *	\param start Where the subtree starts in the body.
+ *	\param from The first byte to visit.
+ *	\param to One past the last byte to visit.
+ *	\param visit Called with each run of bytes.
+ *	
+ *	Subtrees that are entirely outside of the range are never walked into.
+ */
+void TextRope::visitRange( const Link& node, std::uint64_t start, 
+	std::uint64_t from, std::uint64_t to, 
+	const std::function<void( const char*, std::size_t )>& visit )
+{
+	if( !node || from >= to )
+		return;
+
+	const std::uint64_t pieceStart = start + length(node->left);
+	const std::uint64_t pieceEnd = pieceStart + node->piece.length;
+
+	if( from < pieceStart )
+		visitRange(node->left, start, from, to, visit);
+
+	if( from < pieceEnd && to > pieceStart )
+	{
+		const std::uint64_t low = std::max(from, pieceStart);
+		const std::uint64_t high = std::min(to, pieceEnd);
+		visit(node->piece.data + (low - pieceStart), 
+			static_cast<std::size_t>(high - low));
+	}
+
+	if( to > pieceEnd )
+		visitRange(node->right, pieceEnd, from, to, visit);
+}
+
+/**
+ *	\brief Make the tail into a piece at the end of the tree.
+ *	
+ *	The tail is never added to again after this, so the piece can point 
+ *	straight at its bytes.
+ */
+void TextRope::closeTail()
+{
+	if( tail && !tail->empty() )
+		push(Piece{tail, tail->data(), tail->length()});
+
+	tail.reset();
+}
+
+/**
+ *	\brief Add a piece at the end of the tree.
+ *	
+ *	\param piece The piece to add.
+ */
+void TextRope::push( const Piece& piece )
+{
+	root = merge(root, make(piece, nullptr, nullptr, priorityOf(piece.data)));
+}
@@ -0,0 +1,194 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef TEXT_ROPE_H
+#define TEXT_ROPE_H
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ *	\brief The body of a TextFile that has been edited, kept as a tree of 
+ *	pieces instead of one string.
+ *	
+ *	Each piece is a run of bytes that never changes once it is in the tree, 
+ *	often a slice of the image or of a string an earlier edit made.  Pieces 
+ *	sit in a treap ordered by where they are in the body, so finding an 
+ *	offset, cutting the body there or joining two parts is O(log n) in the 
+ *	number of pieces, and no edit copies bytes that it does not change.
+ *	
+ *	Nodes are never changed either, an edit builds new nodes along the path 
+ *	it touched and shares the rest.  Copying a TextRope is just copying its 
+ *	root, and the copy is not affected by edits to the original.
+ *	
+ *	Appended bytes are gathered in an open tail first, which only becomes a 
+ *	piece once it holds TAIL_SIZE bytes, so a long run of small appends is 
+ *	amortized O(1) each.
+ */
+class TextRope
+{
+public:
+	//! How many bytes the tail gathers before it becomes a piece
+	static const std::size_t TAIL_SIZE = 64 * 1024;
+
+	TextRope() = default;
+
+	/**
+	 *	\brief Start with bytes that something else keeps alive, like a 
+	 *	mapped image, without copying them.
+	 *	
+	 *	\param owner Kept for as long as any piece needs the bytes.
+	 *	\param data The first byte.
+	 *	\param length How many bytes there are.
+	 */
+	TextRope( std::shared_ptr<const void> owner, const char* data, 
+		std::size_t length );
+
+	/**
+	 *	\return How many bytes are in the body.
+	 */
+	std::uint64_t length() const;
+
+	/**
+	 *	\brief Add bytes to the end of the body.
+	 *	
+	 *	\param data The bytes to add.
+	 *	\param length How many there are.
+	 */
+	void append( const char* data, std::size_t length );
+
+	/**
+	 *	\brief Replace a run of the body with other bytes.
+	 *	
+	 *	\param offset The first byte to replace, at most length().
+	 *	\param length How many bytes to replace, it stops at the end.
+	 *	\param data The bytes that go in their place.
+	 *	\param dataLength How many of them there are, 0 to just remove bytes.
+	 */
+	void replace( std::uint64_t offset, std::uint64_t length, 
+		const char* data, std::size_t dataLength );
+
+	/**
+	 *	\brief Visit part of the body, a piece at a time, in order.
+	 *	
+	 *	\param offset The first byte to visit.
+	 *	\param length The most bytes to visit, it stops early at the end.
+	 *	\param visit Called with each run of bytes and how long it is.
+	 */
+	void forEach( std::uint64_t offset, std::uint64_t length, 
+		const std::function<void( const char*, std::size_t )>& visit ) const;
+
+	/**
+	 *	\brief Get part of the body as one run of bytes.
+	 *	
+	 *	\param offset The first byte, the run has to be inside of the body.
+	 *	\param length How many bytes.
+	 *	\param scratch Holds the run if it spans more than one piece.
+	 *	
+	 *	\return The first byte of the run, inside a piece if it fits in one.
+	 */
+	const char* read( std::uint64_t offset, std::size_t length, 
+		std::string& scratch ) const;
+
+private:
+	/**
+	 *	\brief A run of bytes that is part of the body.
+	 */
+	struct Piece
+	{
+		//! Keeps the bytes alive, an image or a string
+		std::shared_ptr<const void> owner;
+		//! The first byte
+		const char* data;
+		//! How many bytes there are
+		std::size_t length;
+	};
+
+	struct Node;
+
+	//! Nodes are shared between every TextRope that was copied from another
+	typedef std::shared_ptr<const Node> Link;
+
+	/**
+	 *	\brief One piece and the two subtrees on either side of it.
+	 */
+	struct Node
+	{
+		//! The piece that comes after everything in left
+		Piece piece;
+		//! The pieces before this one
+		Link left;
+		//! The pieces after this one
+		Link right;
+		//! Bytes in this node's whole subtree
+		std::uint64_t length;
+		//! A node's priority is never lower than its children's
+		std::uint32_t priority;
+	};
+
+	//! \return How many bytes are in a subtree, 0 for none
+	static std::uint64_t length( const Link& node );
+
+	//! \return A new node, with its length worked out from its children
+	static Link make( const Piece& piece, const Link& left, 
+		const Link& right, std::uint32_t priority );
+
+	/**
+	 *	\brief Cut a subtree in two.
+	 *	
+	 *	\param node The subtree.
+	 *	\param offset How many bytes go into left, a piece that spans it is 
+	 *	cut in two.
+	 *	\param left Set to the bytes before offset.
+	 *	\param right Set to the bytes from offset on.
+	 */
+	static void split( const Link& node, std::uint64_t offset, Link& left, 
+		Link& right );
+
+	/**
+	 *	\brief Join two subtrees, every byte of left comes first.
+	 *	
+	 *	\return The joined subtree.
+	 */
+	static Link merge( const Link& left, const Link& right );
+
+	/**
+	 *	\brief Visit the part of a subtree that overlaps a range.
+	 *	
+	 *	\param node The subtree.
+	 *	\param start Where the subtree starts in the body.
+	 *	\param from The first byte to visit.
+	 *	\param to One past the last byte to visit.
+	 *	\param visit Called with each run of bytes.
+	 */
+	static void visitRange( const Link& node, std::uint64_t start, 
+		std::uint64_t from, std::uint64_t to, 
+		const std::function<void( const char*, std::size_t )>& visit );
+
+	/**
+	 *	\brief Make the tail into a piece at the end of the tree.
+	 */
+	void closeTail();
+
+	/**
+	 *	\brief Add a piece at the end of the tree.
+	 *	
+	 *	\param piece The piece to add.
+	 */
+	void push( const Piece& piece );
+
+	//! The tree of pieces, null for an empty body
+	Link root;
+
+	//! Appended bytes that come after the tree, only ever added to while no 
+	//!	other TextRope shares it
+	std::shared_ptr<std::string> tail;
+};
+
+#endif
@@ -0,0 +1,229 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "TextSearch.h"
+
+#include <cstring>
+#include <cstdint>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	#define TEXT_SEARCH_X86
+	#define TEXT_SEARCH_SSE2_TARGET __attribute__((target("sse2")))
+	#define TEXT_SEARCH_AVX2_TARGET __attribute__((target("avx2")))
+	#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+	#define TEXT_SEARCH_X86
+	#define TEXT_SEARCH_SSE2_TARGET
+	#define TEXT_SEARCH_AVX2_TARGET
+	#include <intrin.h>
+	#include <immintrin.h>
+#endif
+
+/**
+ *	\brief The portable kernel, memchr() finds each place the first byte is 
+ *	and the rest is compared from there.
+ */
+static const char* findScalar( const char* text, std::size_t length, 
+	const char* needle, std::size_t needleLength )
+{
+	while( length >= needleLength )
+	{
+		const char* hit = static_cast<const char*>(
+			std::memchr(text, needle[0], length - needleLength + 1));
+		if( !hit )
+			return nullptr;
+
+		if( std::memcmp(hit + 1, needle + 1, needleLength - 1) == 0 )
+			return hit;
+
+		length -= hit + 1 - text;
+		text = hit + 1;
+	}
+
+	return nullptr;
+}
+
+#ifdef TEXT_SEARCH_X86
+/**
+ *	\brief The lowest set bit of a mask, which has to have one.
+ */
+static inline unsigned lowestBit( std::uint32_t mask )
+{
+#ifdef _MSC_VER
+	unsigned long bit;
+	_BitScanForward(&bit, mask);
+	return bit;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+
+/**
+ *	\brief The SSE2 kernel.  Each step checks 16 places for the needle's first 
+ *	and last byte at once, and only compares the rest where both are there.
+ */
+TEXT_SEARCH_SSE2_TARGET
+static const char* findSse2( const char* text, std::size_t length, 
+	const char* needle, std::size_t needleLength )
+{
+	const __m128i first = _mm_set1_epi8(needle[0]);
+	const __m128i last = _mm_set1_epi8(needle[needleLength - 1]);
+
+	// Both loads have to stay inside of the text
+	std::size_t i = 0;
+	for( ; i + needleLength - 1 + 16 <= length; i += 16)
+	{
+		const __m128i starts = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(text + i));
+		const __m128i ends = _mm_loadu_si128(
+			reinterpret_cast<const __m128i*>(text + i + needleLength - 1));
+
+		std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(
+			_mm_and_si128(_mm_cmpeq_epi8(starts, first), 
+				_mm_cmpeq_epi8(ends, last))));
+
+		for( ; mask != 0; mask &= mask - 1)
+		{
+			const char* candidate = text + i + lowestBit(mask);
+			if( std::memcmp(candidate + 1, needle + 1, needleLength - 1) == 0 )
+				return candidate;
+		}
+	}
+
+	return findScalar(text + i, length - i, needle, needleLength);
+}
+
+/**
+ *	\brief The AVX2 kernel, the same as the SSE2 one 32 places at a time.
+ */
+TEXT_SEARCH_AVX2_TARGET
+static const char* findAvx2( const char* text, std::size_t length, 
+	const char* needle, std::size_t needleLength )
+{
+	const __m256i first = _mm256_set1_epi8(needle[0]);
+	const __m256i last = _mm256_set1_epi8(needle[needleLength - 1]);
+
+	std::size_t i = 0;
+	for( ; i + needleLength - 1 + 32 <= length; i += 32)
+	{
+		const __m256i starts = _mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(text + i));
+		const __m256i ends = _mm256_loadu_si256(
+			reinterpret_cast<const __m256i*>(text + i + needleLength - 1));
+
+		std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+			_mm256_and_si256(_mm256_cmpeq_epi8(starts, first), 
+				_mm256_cmpeq_epi8(ends, last))));
+
+		for( ; mask != 0; mask &= mask - 1)
+		{
+			const char* candidate = text + i + lowestBit(mask);
+			if( std::memcmp(candidate + 1, needle + 1, needleLength - 1) == 0 )
+				return candidate;
+		}
+	}
+
+	return findSse2(text + i, length - i, needle, needleLength);
+}
+
+//! The kernels findText() can pick from
+enum TextSearchKernel { KERNEL_SCALAR, KERNEL_SSE2, KERNEL_AVX2 };
+
+/**
+ *	\brief Ask the CPU which of the vector kernels it can run.
+ */
+static TextSearchKernel detectKernel()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	const int highest = info[0];
+
+	__cpuid(info, 1);
+	const bool sse2 = (info[3] & (1 << 26)) != 0;
+	const bool osSavesAvx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && 
+		(_xgetbv(0) & 0x6) == 0x6;
+
+	bool avx2 = false;
+	if( highest >= 7 && osSavesAvx )
+	{
+		__cpuidex(info, 7, 0);
+		avx2 = (info[1] & (1 << 5)) != 0;
+	}
+#else
+	__builtin_cpu_init();
+	const bool sse2 = __builtin_cpu_supports("sse2");
+	const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+	return avx2 ? KERNEL_AVX2 : sse2 ? KERNEL_SSE2 : KERNEL_SCALAR;
+}
+
+/**
+ *	\brief The kernel this CPU uses, worked out the first time it is needed.
+ */
+static TextSearchKernel currentKernel()
+{
+	static const TextSearchKernel kernel = detectKernel();
+	return kernel;
+}
+#endif
+
+/**
+ *	\brief	Which kernel is findText() using?
+ *	
+ *	\return "AVX2", "SSE2" or "scalar"
+ */
+const char* textSearchKernel()
+{
+#ifdef TEXT_SEARCH_X86
+	switch( currentKernel() )
+	{
+		case KERNEL_AVX2:	return "AVX2";
+		case KERNEL_SSE2:	return "SSE2";
+		case KERNEL_SCALAR:	break;
+	}
+#endif
+
+	return "scalar";
+}
+
+/**
+ *	\brief	Find the first place a string appears in a block of text.
+ *	
+ *	\param text The text to search
+ *	\param length How many bytes of text there are
+ *	\param needle The string to look for
+ *	\param needleLength How many bytes are in the string
+ *	
+ *	AVX2 or SSE2 is used when the CPU has it, checking 32 or 16 places at once 
+ *	for the first and last byte of the string before comparing the rest.  
+ *	Otherwise memchr() finds each candidate.  All of them give the same 
+ *	result.
+ *	
+ *	\return The first byte of the match, or null if there is not one.  An 
+ *	empty needle matches at the start of the text.
+ */
+const char* findText( const char* text, std::size_t length, 
+	const char* needle, std::size_t needleLength )
+{
+	if( needleLength == 0 )
+		return text;
+
+	if( needleLength > length )
+		return nullptr;
+
+#ifdef TEXT_SEARCH_X86
+	switch( currentKernel() )
+	{
+		case KERNEL_AVX2:	return findAvx2(text, length, needle, needleLength);
+		case KERNEL_SSE2:	return findSse2(text, length, needle, needleLength);
+		case KERNEL_SCALAR:	break;
+	}
+#endif
+
+	return findScalar(text, length, needle, needleLength);
+}
@@ -0,0 +1,38 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef TEXT_SEARCH_H
+#define TEXT_SEARCH_H
+
+#include <cstddef>
+
+/**
+ *	\brief	Find the first place a string appears in a block of text.
+ *	
+ *	\param text The text to search
+ *	\param length How many bytes of text there are
+ *	\param needle The string to look for
+ *	\param needleLength How many bytes are in the string
+ *	
+ *	AVX2 or SSE2 is used when the CPU has it, checking 32 or 16 places at once 
+ *	for the first and last byte of the string before comparing the rest.  
+ *	Otherwise memchr() finds each candidate.  All of them give the same 
+ *	result.
+ *	
+ *	\return The first byte of the match, or null if there is not one.  An 
+ *	empty needle matches at the start of the text.
+ */
+const char* findText( const char* text, std::size_t length, 
+	const char* needle, std::size_t needleLength );
+
+/**
+ *	\brief	Which kernel is findText() using?
+ *	
+ *	\return "AVX2", "SSE2" or "scalar"
+ */
+const char* textSearchKernel();
+
+#endif
@@ -0,0 +1,105 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#include "ThreadPool.h"
+
+/**
+ *	\brief Start a pool of worker threads.
+ *	
+ *	\param threads How many workers to start, at least 1.
+ */
+ThreadPool::ThreadPool( int threads )
+{
+	if( threads < 1 )
+		threads = 1;
+
+	for( int i = 0; i < threads; i++)
+		workers.emplace_back(&ThreadPool::work, this);
+}
+
+/**
+ *	\brief Finish any queued tasks and stop the workers.
+ */
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		stopping = true;
+	}
+	available.notify_all();
+
+	for( auto& t : workers)
+		t.join();
+}
+
+/**
+ *	\brief Queue a task to be run by one of the workers.
+ *	
+ *	\param task The work to do.
+ */
+void ThreadPool::submit( std::function<void()> task )
+{
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		tasks.push(std::move(task));
+		pending++;
+	}
+	available.notify_one();
+}
+
+/**
+ *	\brief Block until every task submitted so far has finished.
+ */
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> guard(lock);
+	finished.wait(guard, [this] { return pending == 0; });
+}
+
+/**
+ *	\return How many workers are in the pool.
+ */
+int ThreadPool::getThreadCount() const
+{
+	return static_cast<int>(workers.size());
+}
+
+/**
+ *	\return How many threads the hardware can run at once, at least 1.
+ */
+int ThreadPool::hardwareThreads()
+{
+	const unsigned count = std::thread::hardware_concurrency();
+	return count ? static_cast<int>(count) : 1;
+}
+
+/**
+ *	\brief The loop that each worker runs, pulling tasks off the queue.
+ */
+void ThreadPool::work()
+{
+	while( true )
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> guard(lock);
+			available.wait(guard, [this] { return stopping || !tasks.empty(); });
+
+			// Only exit once the queue has drained
+			if( tasks.empty() )
+				return;
+
+			task = std::move(tasks.front());
+			tasks.pop();
+		}
+
+		task();
+
+		std::lock_guard<std::mutex> guard(lock);
+		if( --pending == 0 )
+			finished.notify_all();
+	}
+}
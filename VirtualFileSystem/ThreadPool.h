@@ -0,0 +1,90 @@
+﻿/*
+ *	Andrew McGuiness
+ *	ITEC 371 - Project 4
+ *	4/19/2018
+*/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+/**
+ *	\brief A fixed set of worker threads that run submitted tasks.  Used to 
+ *	spread the big whole-tree jobs (saving, verifying, searching) across the 
+ *	machine's cores.
+ */
+class ThreadPool
+{
+public:
+	/**
+	 *	\brief Start a pool of worker threads.
+	 *	
+	 *	\param threads How many workers to start, at least 1.
+	 */
+	explicit ThreadPool( int threads );
+
+	/**
+	 *	\brief Finish any queued tasks and stop the workers.
+	 */
+	~ThreadPool();
+
+	ThreadPool( const ThreadPool& ) = delete;
+	ThreadPool& operator=( const ThreadPool& ) = delete;
+
+	/**
+	 *	\brief Queue a task to be run by one of the workers.
+	 *	
+	 *	\param task The work to do.
+	 */
+	void submit( std::function<void()> task );
+
+	/**
+	 *	\brief Block until every task submitted so far has finished.
+	 */
+	void wait();
+
+	/**
+	 *	\return How many workers are in the pool.
+	 */
+	int getThreadCount() const;
+
+	/**
+	 *	\return How many threads the hardware can run at once, at least 1.
+	 */
+	static int hardwareThreads();
+
+private:
+	/**
+	 *	\brief The loop that each worker runs, pulling tasks off the queue.
+	 */
+	void work();
+
+	//! The worker threads
+	std::vector<std::thread> workers;
+
+	//! Tasks waiting for a worker
+	std::queue<std::function<void()>> tasks;
+
+	//! Guards tasks, pending and stopping
+	std::mutex lock;
+
+	//! Signalled when a task is queued or the pool is stopping
+	std::condition_variable available;
+
+	//! Signalled when the last pending task finishes
+	std::condition_variable finished;
+
+	//! Tasks that are queued or running
+	int pending = 0;
+
+	//! Set when the workers should exit
+	bool stopping = false;
+};
+
+#endif
@@ -31,6 +31,21 @@ const std::string cmd[] = {
 	"setmemory",
 	"setburst",
 	"getburst",
+	"setthreads",
+	"getthreads",
+	"compact",
+	"fsck",
+	// Commands match by prefix, so "snapshots" has to come before "snapshot"
+	"snapshots",
+	"snapshot",
+	"find",
+	"grep",
+	"du",
+	"append",
+	"edit",
+	"dedupstats",
+	"import",
+	"export",
 	"quit"
 };
 
@@ -50,7 +65,21 @@ enum Commands : int{
 	SET_MEM 	= 11,
 	SET_BURST 	= 12,
 	GET_BURST 	= 13,
-	QUIT 	  	= 14
+	SET_THREADS	= 14,
+	GET_THREADS	= 15,
+	COMPACT		= 16,
+	FSCK		= 17,
+	SNAPSHOTS	= 18,
+	SNAPSHOT	= 19,
+	FIND		= 20,
+	GREP		= 21,
+	DU			= 22,
+	APPEND		= 23,
+	EDIT		= 24,
+	DEDUP_STATS	= 25,
+	IMPORT		= 26,
+	EXPORT		= 27,
+	QUIT 	  	= 28
 	
 };
 
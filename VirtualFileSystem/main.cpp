@@ -9,12 +9,32 @@
 #include <fstream>
 #include <string>
 #include <sstream>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <chrono>
 
 #include "Util.h"
+#include "ImageFile.h"
+#include "ImageReader.h"
+#include "ImageWriter.h"
+#include "ImageBodies.h"
+#include "BlobStore.h"
+#include "Journal.h"
 #include "Directory.h"
 #include "TextFile.h"
 #include "Scheduler.h"
 #include "ProgramFile.h"
+#include "ThreadPool.h"
+#include "Snapshots.h"
+#include "PathCache.h"
+#include "NodeArena.h"
+#include "NodeTable.h"
+#include "Find.h"
+#include "Grep.h"
+#include "TextSearch.h"
+#include "Import.h"
+#include "Export.h"
 
 using  std::cout; using  std::cin; using  std::endl; using  std::string;
 
@@ -27,9 +47,62 @@ Directory* currentDirectory;
 //! Holds a pointer to the root for comparison during runtime
 Directory* rootPointer;
 
+//! Owns every node in the FS, the whole tree is released at once on exit
+NodeArena nodes;
+
 //! The system's Scheduler manages all running, waiting and finished processes
 Scheduler scheduler;
 
+//! Every change to the FS is logged here as it happens
+Journal journal;
+
+//! The named snapshots of the FS
+Snapshots snapshots;
+
+//! Remembers the paths that cd, cat and start have followed
+PathCache paths;
+
+//! A flat copy of the FS for the jobs that look at all of it, like find and 
+//!	grep
+NodeTable flatTree;
+
+//! Counts every change made to the FS, so flatTree knows when it is behind
+std::uint64_t treeChanges = 1;
+
+//! What treeChanges was when flatTree was last built, 0 if it never was
+std::uint64_t flatTreeChanges = 0;
+
+//! What Directory::getInflateCount() was when flatTree was last built
+std::uint64_t flatTreeInflates = 0;
+
+//! Which snapshot currentDirectory is being viewed through, LIVE_GENERATION 
+//!	when it is not in one
+std::uint32_t viewGeneration = LIVE_GENERATION;
+
+//! The name of the FS image on disk
+string imageName;
+
+//! Worker threads for the whole-FS jobs, like saving the image
+std::unique_ptr<ThreadPool> workers;
+
+
+/**
+ *	\brief Make sure the FS can be changed from where the user is.
+ *	
+ *	Snapshots are read-only, the user has to go back to the live FS with 
+ *	"cd @" first.
+ *	
+ *	\return True if currentDirectory can be changed.
+ */
+bool isWritable()
+{
+	if( viewGeneration == LIVE_GENERATION )
+		return true;
+
+	cout << "Snapshot <@" << snapshots.getName(viewGeneration) 
+		<< "> is read-only, use \"cd @\" to go back.\n";
+	return false;
+}
 
 /**
  *	\brief Attempt to create a new directory inside of currentDirectory.
@@ -42,12 +115,21 @@ Scheduler scheduler;
  */
 void createDir( const std::string& dirName)
 {
+	if( !isWritable() )
+		return;
+
 	// Attempt to create a new Directory with the given name
-	const auto dir = Directory::CreateDirectory(dirName, currentDirectory );
+	const auto dir = Directory::CreateDirectory(nodes, dirName, 
+		currentDirectory );
 
 	// Swap currentDirectory only if d was created
 	if( dir )
+	{
+		dir->setGeneration( snapshots.getGeneration() );
 		currentDirectory->addObject( dir );
+		journal.recordDirectory( currentDirectory, *dir );
+		treeChanges++;
+	}
 }
 
 /**
@@ -56,6 +138,9 @@ void createDir( const std::string& dirName)
  */
 void createTextFile( )
 {
+	if( !isWritable() )
+		return;
+
 	cout << "Enter filename>";
 		
 	string fileName;
@@ -74,9 +159,14 @@ void createTextFile( )
 	if( fileName.substr(len-2) == ".t")
 	{
 		// Make the actual TextFile and add it to the currentDirectory
-		const auto file = TextFile::makeTextFile(fileName);
+		const auto file = TextFile::makeTextFile(nodes, fileName);
 		if( file )
+		{
+			file->setGeneration( snapshots.getGeneration() );
 			currentDirectory->addObject( file );
+			journal.recordTextFile( currentDirectory, *file );
+			treeChanges++;
+		}
 	}
 
 	// Conform to spec, require .t extensions on filenames
@@ -94,6 +184,9 @@ void createTextFile( )
  */
 void createProgramFile( const std::string& programData )
 {
+	if( !isWritable() )
+		return;
+
 	// Tokenized the user's input string
 	std::stringstream ss{programData};
 	string item;
@@ -136,31 +229,56 @@ void createProgramFile( const std::string& programData )
 		}
 
 		// Create the ProgramFile and store it in the current directory
-		const auto file = ProgramFile::makeProgramFile(name, time, mem, doesIO, 
-			timeIO, amountIO);
+		const auto file = ProgramFile::makeProgramFile(nodes, name, time, mem, 
+			doesIO, timeIO, amountIO);
 			
 		if( file )
+		{
+			file->setGeneration( snapshots.getGeneration() );
 			currentDirectory->addObject( file );
+			journal.recordProgramFile( currentDirectory, *file );
+			treeChanges++;
+		}
 	}
 	
 }
 
 /**
- *	\brief Attempt to change to the directory to the requested directory name.
+ *	\brief Attempt to change to the directory to the requested directory path.
  *	
- *	If the user is currently inside of the root directory and they try to change
- *	directory to parent (with "..") the command is just ignored.
+ *	The path can be absolute ("/a/b") or relative ("../c").  If the user is 
+ *	currently inside of the root directory and they try to change directory 
+ *	to parent (with "..") they just stay in root.  "@name" enters the root of 
+ *	a snapshot, read-only, and "@" goes back to the same directory in the 
+ *	live FS.
  *	
- *	\param dirName Name of the directory to change to.
+ *	\param dirName Path of the directory to change to.
  */
 void tryToChangeDir( const std::string& dirName )
 {
-	// Special case if in root and trying to go up a level
-	if(dirName == ".." && rootPointer == currentDirectory)
+	// Everything in a snapshot is still in the live FS
+	if( dirName == "@" )
+	{
+		viewGeneration = LIVE_GENERATION;
 		return;
+	}
+
+	if( dirName[0] == '@' )
+	{
+		std::uint32_t generation;
+		if( snapshots.find(dirName.substr(1), generation) )
+		{
+			viewGeneration = generation;
+			currentDirectory = rootPointer;
+		}
+		else
+			cout << "There is no snapshot <" << dirName << ">" << std::endl;
+		return;
+	}
 
 	// Search for the requested directory
-	Directory* dir = currentDirectory->getDirectory(dirName);
+	Directory* dir = paths.resolve(rootPointer, currentDirectory, dirName, 
+		viewGeneration);
 
 	// Found the directory, change to it
 	if( dir )
@@ -172,33 +290,197 @@ void tryToChangeDir( const std::string& dirName )
 }
 
 /**
- *	\brief Search for a TextFile in the current Directory then print it's 
- *	contents if it was found.
+ *	\brief Search for a TextFile then print it's contents if it was found.
+ *	
+ *	\param arguments The TextFile's path, optionally followed by which part 
+ *	of it to print: "<offset> <length>", "head <length>" or "tail <length>".
  *	
- *	\param fileName TextFile name to search for and print the contents of.
+ *	The body is streamed out a block at a time, and only the blocks that hold 
+ *	the requested bytes are read.
  */
-void printTextFile(const string& fileName)
+void printTextFile(const string& arguments)
 {
-	// Try to get the file
-	TextFile* text = currentDirectory->getTextfile( fileName );
-
-	// Print the file if it exists
-	if( text )
-		cout << "Text file contents:\n" << text->getContents() << endl;
-	else
+	std::istringstream parts(arguments);
+	string fileName;
+	parts >> fileName;
+
+	// Try to get the file, from wherever the path leads
+	string leaf;
+	Directory* where = paths.resolveParent(rootPointer, currentDirectory, 
+		fileName, viewGeneration, leaf);
+	TextFile* text = where ? where->getTextfile( leaf, viewGeneration ) : nullptr;
+	if( !text )
+	{
 		cout << "Could not read from <" << fileName << ">" << endl;
+		return;
+	}
+
+	// Work out which bytes were asked for, everything by default
+	std::uint64_t offset = 0;
+	std::uint64_t length = std::numeric_limits<std::uint64_t>::max();
+	string mode;
+	if( parts >> mode )
+	{
+		// Negative numbers would wrap around to huge ones
+		bool valid = arguments.find('-') == string::npos;
+		if( equalIC(mode, "head") )
+			valid = valid && (parts >> length);
+		else if( equalIC(mode, "tail") )
+		{
+			valid = valid && (parts >> length);
+			const std::uint64_t size = text->getSize();
+			offset = size > length ? size - length : 0;
+		}
+		else
+		{
+			std::istringstream first(mode);
+			valid = valid && (first >> offset) && (parts >> length);
+		}
+
+		if( !valid )
+		{
+			cout << "Error: cat <filename> [<offset> <length> | head <length> "
+				"| tail <length>]\n";
+			return;
+		}
+	}
+
+	cout << "Text file contents:\n";
+	if( !text->print(cout, offset, length) )
+		cout << "\nThe body of <" << fileName << "> is damaged.";
+	cout << endl;
 }
 
 /**
- *	\brief Search for a ProgramFile in the current Directory, if found try to 
- *	create a process in the Scheduler.
+ *	\brief Find a TextFile in the live FS so that it can be changed.
+ *	
+ *	\param fileName The TextFile's path.
+ *	\param where Set to the Directory the TextFile is in.
  *	
- *	\param fileName ProgramFile name to search for and spawn a process from.
+ *	\return The TextFile, or null if it was not found.
+ */
+TextFile* findTextFile( const string& fileName, Directory*& where )
+{
+	string leaf;
+	where = paths.resolveParent(rootPointer, currentDirectory, fileName, 
+		LIVE_GENERATION, leaf);
+	TextFile* text = where ? where->getTextfile( leaf ) : nullptr;
+	if( !text )
+		cout << "Could not find <" << fileName << ">" << endl;
+
+	return text;
+}
+
+/**
+ *	\brief Replace part of a TextFile's body and journal it.
+ *	
+ *	\param where The Directory the TextFile is in.
+ *	\param file The TextFile.
+ *	\param offset The first byte to replace.
+ *	\param length How many bytes to replace.
+ *	\param text What goes in their place.
+ */
+void changeText( Directory* where, TextFile* file, std::uint64_t offset, 
+	std::uint64_t length, const string& text )
+{
+	where->editTextfile( file, offset, length, text, 
+		snapshots.getGeneration() );
+	journal.recordEdit( where, *file, offset, length, text );
+	treeChanges++;
+}
+
+/**
+ *	\brief Add a line to the end of a TextFile, the user is prompted for it.
+ *	
+ *	\param fileName The TextFile's path.
+ *	
+ *	The text goes on a line of its own, so a TextFile can be kept as a log 
+ *	that grows an entry at a time.  Only the new text is copied, however long 
+ *	the body already is.
+ */
+void appendText( const string& fileName )
+{
+	if( !isWritable() )
+		return;
+
+	Directory* where;
+	TextFile* file = findTextFile(fileName, where);
+	if( !file )
+		return;
+
+	cout << "Enter text to append>";
+	string text;
+	getline(cin, text);
+
+	// Start a new line, unless the body is empty or already ends with one
+	const std::uint64_t size = file->getSize();
+	std::ostringstream last;
+	if( size > 0 && file->print(last, size - 1, 1) && last.str() != "\n" )
+		text.insert(0, 1, '\n');
+
+	changeText(where, file, size, 0, text);
+}
+
+/**
+ *	\brief Replace part of a TextFile, the user is prompted for what goes in 
+ *	its place.
+ *	
+ *	\param arguments The TextFile's path, then the offset of the first byte 
+ *	to replace and how many bytes to replace.
+ *	
+ *	Replacing 0 bytes inserts the text, and entering no text removes the 
+ *	bytes.
+ */
+void editText( const string& arguments )
+{
+	if( !isWritable() )
+		return;
+
+	// Negative numbers would wrap around to huge ones
+	std::istringstream parts(arguments);
+	string fileName;
+	std::uint64_t offset;
+	std::uint64_t length;
+	if( !(parts >> fileName >> offset >> length) || 
+		arguments.find('-') != string::npos )
+	{
+		cout << "Error: edit <filename> <offset> <length>\n";
+		return;
+	}
+
+	Directory* where;
+	TextFile* file = findTextFile(fileName, where);
+	if( !file )
+		return;
+
+	const std::uint64_t size = file->getSize();
+	if( offset > size )
+	{
+		cout << "<" << fileName << "> only holds " << size << " byte(s).\n";
+		return;
+	}
+
+	cout << "Enter replacement text>";
+	string text;
+	getline(cin, text);
+
+	changeText(where, file, offset, std::min(length, size - offset), text);
+}
+
+/**
+ *	\brief Search for a ProgramFile, if found try to create a process in the 
+ *	Scheduler.
+ *	
+ *	\param fileName ProgramFile path to search for and spawn a process from.
  */
 void startProcess(const string& fileName)
 {
-	// Try to get the program file
-	ProgramFile* program = currentDirectory->getProgramfile( fileName );
+	// Try to get the program file, from wherever the path leads
+	string leaf;
+	Directory* where = paths.resolveParent(rootPointer, currentDirectory, 
+		fileName, viewGeneration, leaf);
+	ProgramFile* program = where ? 
+		where->getProgramfile( leaf, viewGeneration ) : nullptr;
 
 	// Send the program file to the scheduler to try and create a process
 	if( program )
@@ -207,6 +489,530 @@ void startProcess(const string& fileName)
 		cout << "Could not find <" << fileName << "> \n";
 }
 
+/**
+ *	\brief Get what goes in front of a path to show which view it is in.
+ *	
+ *	\return "@<snapshot>/" while a snapshot is being viewed, otherwise empty, 
+ *	so every path printed looks like "@before/root/a" or "root/a".
+ */
+std::string viewPrefix()
+{
+	if( viewGeneration == LIVE_GENERATION )
+		return "";
+
+	return "@" + snapshots.getName(viewGeneration) + "/";
+}
+
+/**
+ *	\brief Get a flat copy of the whole FS, rebuilding it if the FS has 
+ *	changed, or a Directory has been inflated, since it was last built.
+ *	
+ *	\return The copy, in step with the FS until the next change.
+ */
+NodeTable& getFlatTree()
+{
+	if( flatTreeChanges != treeChanges || 
+		flatTreeInflates != Directory::getInflateCount() )
+	{
+		flatTree.build(*rootPointer);
+		flatTreeChanges = treeChanges;
+		flatTreeInflates = Directory::getInflateCount();
+	}
+
+	return flatTree;
+}
+
+/**
+ *	\brief Search everything under currentDirectory for names that match a 
+ *	pattern, and print the path to each one.
+ *	
+ *	\param arguments The pattern, optionally followed by "-type d", "-type t" 
+ *	or "-type p" to only look for Directories, TextFiles or ProgramFiles.
+ */
+void findFiles( const std::string& arguments )
+{
+	std::stringstream ss{arguments};
+	string pattern, option, type;
+	ss >> pattern >> option >> type;
+
+	// Look for every kind unless told otherwise
+	std::uint8_t kinds = (1 << NODE_DIRECTORY) | (1 << NODE_TEXT) | 
+		(1 << NODE_PROGRAM);
+	if( !option.empty() )
+	{
+		if( option != "-type" || type.size() != 1 || 
+			string("dtp").find(type[0]) == string::npos )
+		{
+			cout << "Error: find <pattern> [-type d|t|p] is required format.\n";
+			return;
+		}
+
+		kinds = type[0] == 'd' ? 1 << NODE_DIRECTORY : 
+			type[0] == 't' ? 1 << NODE_TEXT : 1 << NODE_PROGRAM;
+	}
+
+	const auto started = std::chrono::steady_clock::now();
+
+	const NodeTable& table = getFlatTree();
+	const std::uint32_t start = table.findRow(currentDirectory);
+	if( start == NodeTable::NONE )
+	{
+		cout << "Could not find Directory <" << *currentDirectory << ">\n";
+		return;
+	}
+
+	Finder finder(pattern, kinds);
+	finder.setPrefix(viewPrefix());
+	const std::uint64_t searched = finder.run(table, start, viewGeneration, 
+		*workers, cout);
+
+	const double seconds = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - started).count();
+
+	cout << "Found " << finder.getMatchCount() << " match(es) in " 
+		<< searched << " node(s), " << static_cast<std::uint64_t>(
+			seconds > 0 ? searched / seconds : 0) << " nodes/s.\n";
+}
+
+/**
+ *	\brief Search the TextFiles under a Directory for a string, and print 
+ *	each line that has it.
+ *	
+ *	\param arguments The string, in double quotes if it has spaces, then 
+ *	optionally the path of the Directory to search.  Without one, everything 
+ *	under currentDirectory is searched.
+ */
+void grepFiles( const std::string& arguments )
+{
+	string literal, path;
+	if( arguments[0] == '"' )
+	{
+		const auto close = arguments.find('"', 1);
+		if( close != string::npos )
+		{
+			literal = arguments.substr(1, close - 1);
+			std::stringstream ss{arguments.substr(close + 1)};
+			ss >> path;
+		}
+	}
+	else
+	{
+		std::stringstream ss{arguments};
+		ss >> literal >> path;
+	}
+
+	if( literal.empty() )
+	{
+		cout << "Error: grep <literal> [path] is required format.\n";
+		return;
+	}
+
+	Directory* dir = path.empty() ? currentDirectory : paths.resolve(
+		rootPointer, currentDirectory, path, viewGeneration);
+	if( !dir )
+	{
+		cout << "Could not find Directory <" << path << ">" << std::endl;
+		return;
+	}
+
+	const auto started = std::chrono::steady_clock::now();
+
+	NodeTable& table = getFlatTree();
+	const std::uint32_t start = table.findRow(dir);
+	if( start == NodeTable::NONE )
+	{
+		cout << "Could not find Directory <" << *dir << ">\n";
+		return;
+	}
+
+	table.loadText();
+
+	Grepper grepper(literal);
+	grepper.setPrefix(viewPrefix());
+	const std::uint64_t searched = grepper.run(table, start, viewGeneration, 
+		*workers, cout);
+
+	const double seconds = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - started).count();
+
+	cout << "Found " << grepper.getMatchCount() << " line(s) in " 
+		<< grepper.getFileCount() << " file(s), searched " << searched 
+		<< " byte(s) with " << textSearchKernel() << ", " 
+		<< static_cast<std::uint64_t>(seconds > 0 ? 
+			searched / seconds / (1024 * 1024) : 0) << " MB/s.\n";
+}
+
+/**
+ *	\brief Print what is under a Directory: how many FSObjects, how many 
+ *	bytes of text, and how many programs and how much memory they need.
+ *	
+ *	\param arguments Nothing for currentDirectory, or a space and the path 
+ *	of the Directory.
+ *	
+ *	Each Directory keeps these totals for the live FS, so they are printed 
+ *	straight away.  A snapshot's view is added up from the flat copy of the 
+ *	FS instead.
+ */
+void reportUsage( const std::string& arguments )
+{
+	if( !arguments.empty() && arguments[0] != ' ' )
+	{
+		cout << "Error: du [path] is required format.\n";
+		return;
+	}
+
+	std::stringstream ss{arguments};
+	string path;
+	ss >> path;
+
+	Directory* dir = path.empty() ? currentDirectory : paths.resolve(
+		rootPointer, currentDirectory, path, viewGeneration);
+	if( !dir )
+	{
+		cout << "Could not find Directory <" << path << ">" << std::endl;
+		return;
+	}
+
+	SubtreeTotals totals = dir->getTotals();
+	if( viewGeneration != LIVE_GENERATION )
+	{
+		const NodeTable& table = getFlatTree();
+		const std::uint32_t row = table.findRow(dir);
+		if( row == NodeTable::NONE )
+		{
+			cout << "Could not find Directory <" << *dir << ">\n";
+			return;
+		}
+
+		totals = table.tally(row, viewGeneration);
+	}
+
+	cout << viewPrefix() << *dir << ": " << totals.nodes << " node(s), " << totals.textBytes 
+		<< " text byte(s), " << totals.programs << " program(s) needing " 
+		<< totals.programMemory << " memory.\n";
+}
+
+/**
+ *	\brief Copy a directory tree from the host into the FS.
+ *	
+ *	\param arguments The host directory, in double quotes if it has spaces, 
+ *	then optionally the path of the Directory to copy it into.  Without one, 
+ *	it goes into currentDirectory.
+ *	
+ *	Host directories become Directories and small text files become 
+ *	TextFiles, with their names made to fit.  The files are read on the 
+ *	worker threads, and the whole import is journaled as one batch.
+ */
+void importTree( const std::string& arguments )
+{
+	if( !isWritable() )
+		return;
+
+	string hostPath, path;
+	if( arguments[0] == '"' )
+	{
+		const auto close = arguments.find('"', 1);
+		if( close != string::npos )
+		{
+			hostPath = arguments.substr(1, close - 1);
+			std::stringstream ss{arguments.substr(close + 1)};
+			ss >> path;
+		}
+	}
+	else
+	{
+		std::stringstream ss{arguments};
+		ss >> hostPath >> path;
+	}
+
+	if( hostPath.empty() )
+	{
+		cout << "Error: import <hostpath> [vfsdir] is required format.\n";
+		return;
+	}
+
+	Directory* dir = path.empty() ? currentDirectory : paths.resolve(
+		rootPointer, currentDirectory, path, viewGeneration);
+	if( !dir )
+	{
+		cout << "Could not find Directory <" << path << ">" << std::endl;
+		return;
+	}
+
+	const auto started = std::chrono::steady_clock::now();
+
+	Importer importer;
+	if( !importer.run(hostPath, dir, snapshots.getGeneration(), *workers, 
+		journal) )
+	{
+		cout << "Could not read host directory <" << hostPath << ">\n";
+		return;
+	}
+	treeChanges++;
+
+	const double seconds = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - started).count();
+
+	cout << "Imported " << importer.getDirectoryCount() << " Directory(s) and " 
+		<< importer.getFileCount() << " TextFile(s) holding " 
+		<< importer.getByteCount() << " byte(s), skipped " 
+		<< importer.getSkippedCount() << ", " << static_cast<std::uint64_t>(
+			seconds > 0 ? importer.getByteCount() / seconds / (1024 * 1024) : 0) 
+		<< " MB/s.\n";
+}
+
+/**
+ *	\brief Write a Directory and everything in it out to the host.
+ *	
+ *	\param arguments The path of the Directory, then the host directory to 
+ *	write it into, in double quotes if it has spaces.
+ *	
+ *	TextFiles are written as <name>.t and ProgramFiles as a <name>.p sidecar 
+ *	that holds their data.  In a snapshot, the snapshot's view is written.
+ */
+void exportTree( const std::string& arguments )
+{
+	std::stringstream ss{arguments};
+	string path, hostPath;
+	ss >> path;
+	std::getline(ss, hostPath);
+
+	const auto first = hostPath.find_first_not_of(' ');
+	hostPath.erase(0, first == string::npos ? hostPath.length() : first);
+	if( hostPath.length() > 1 && hostPath[0] == '"' && hostPath.back() == '"' )
+		hostPath = hostPath.substr(1, hostPath.length() - 2);
+
+	if( path.empty() || hostPath.empty() )
+	{
+		cout << "Error: export <vfsdir> <hostpath> is required format.\n";
+		return;
+	}
+
+	Directory* dir = paths.resolve(rootPointer, currentDirectory, path, 
+		viewGeneration);
+	if( !dir )
+	{
+		cout << "Could not find Directory <" << path << ">" << std::endl;
+		return;
+	}
+
+	const auto started = std::chrono::steady_clock::now();
+
+	const NodeTable& table = getFlatTree();
+	const std::uint32_t start = table.findRow(dir);
+	if( start == NodeTable::NONE )
+	{
+		cout << "Could not find Directory <" << *dir << ">\n";
+		return;
+	}
+
+	Exporter exporter;
+	if( !exporter.run(table, start, viewGeneration, hostPath, *workers) )
+	{
+		cout << "Could not make host directory <" << hostPath << ">\n";
+		return;
+	}
+
+	const double seconds = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - started).count();
+
+	cout << "Exported " << exporter.getDirectoryCount() << " directory(s) and " 
+		<< exporter.getFileCount() << " file(s) holding " 
+		<< exporter.getByteCount() << " byte(s), skipped " 
+		<< exporter.getSkippedCount() << ", " << static_cast<std::uint64_t>(
+			seconds > 0 ? exporter.getByteCount() / seconds / (1024 * 1024) : 0) 
+		<< " MB/s.\n";
+}
+
+/**
+ *	\brief Replace the worker threads with a new pool.
+ *	
+ *	\param threads How many workers to use, 1 does everything on one thread.
+ */
+void setThreads( int threads )
+{
+	if( threads < 1 )
+	{
+		cout << "Error: at least 1 thread is required.\n";
+		return;
+	}
+
+	// The old pool finishes its work before it is replaced
+	workers.reset(new ThreadPool(threads));
+}
+
+/**
+ *	\brief Take a snapshot of the whole FS as it is now.
+ *	
+ *	\param name What to call the snapshot.
+ *	
+ *	Nothing is copied, the snapshot is just the point in the FS's history to 
+ *	look back at, so it takes the same time however big the FS is.
+ */
+void takeSnapshot( const std::string& name )
+{
+	if( !Snapshots::validName(name) )
+		return;
+
+	std::uint32_t existing;
+	if( snapshots.find(name, existing) )
+	{
+		cout << "Snapshot <@" << name << "> already exists.\n";
+		return;
+	}
+
+	if( !snapshots.take(name) )
+	{
+		cout << "Error: no more than " << Snapshots::MAX_SNAPSHOTS 
+			<< " snapshots can be taken.\n";
+		return;
+	}
+
+	journal.recordSnapshot(name);
+	cout << "Snapshot <@" << name << "> taken, use \"cd @" << name 
+		<< "\" to view it.\n";
+}
+
+/**
+ *	\brief List every snapshot, oldest first.
+ */
+void listSnapshots()
+{
+	if( snapshots.getCount() == 0 )
+	{
+		cout << "No snapshots have been taken.\n";
+		return;
+	}
+
+	for( std::uint32_t i = 0; i < snapshots.getCount(); i++)
+		cout << "Snapshot: @" << snapshots.getName(i) << endl;
+}
+
+/**
+ *	\brief Fold the journal into a new image on disk.
+ *	
+ *	The whole FS is written out as a fresh image that remembers the last 
+ *	journal record it includes, then the journal is emptied.  If the program 
+ *	dies part way through, the old image and the journal are still intact.
+ */
+void compactImage()
+{
+	// Make sure every record is on disk before the image claims to hold them
+	journal.sync();
+
+	// Size the image exactly, then fill it in one pass.  Every distinct 
+	//	TextFile body is collected on the way, to be stored only once.
+	ImageBodies bodies;
+	ImageSize size;
+	size.bodies = &bodies;
+	rootPointer->measure(size);
+	size.snapshotCount = snapshots.getCount();
+
+	ImageWriter writer(size);
+	writer.setJournalSequence( journal.getSequence() );
+
+	for( std::uint32_t i = 0; i < snapshots.getCount(); i++)
+		writer.addSnapshot( snapshots.getName(i) );
+
+	// Starting from the root node, recursively write each piece into the 
+	//	image, with the big subtrees spread across the workers
+	rootPointer->writeToFile(writer, NO_PARENT, *workers);
+
+	// save() only returns true once the new image is on the disk for good
+	if( writer.save(imageName) )
+	{
+		journal.clear();
+		cout << "Journal folded into <" << imageName << ">\n";
+	}
+	else
+		cout << "Could not save the file system to <" << imageName << ">\n";
+}
+
+/**
+ *	\brief Tell the user which parts of an image are damaged.
+ *	
+ *	\param damaged The byte ranges that failed their checksums.
+ */
+void reportDamage( const std::vector<ImageRange>& damaged )
+{
+	for( const auto& range : damaged )
+		cout << "Damaged: bytes " << range.offset << " to " 
+			<< range.offset + range.length - 1 << " (" << range.length 
+			<< " bytes)\n";
+}
+
+/**
+ *	\brief Check the image on disk against its block checksums.
+ *	
+ *	Only the checksums are checked, the tree is not loaded.  This checks the 
+ *	image as it is on disk now, so it includes the last compact.
+ */
+void checkImage()
+{
+	const auto image = ImageFile::open(imageName);
+	if( !image || image->getSize() == 0 )
+	{
+		cout << "There is no image at <" << imageName << "> to check.\n";
+		return;
+	}
+
+	std::vector<ImageRange> damaged;
+	if( !ImageReader::verify(*image, *workers, damaged) )
+	{
+		reportDamage(damaged);
+		cout << "<" << imageName << "> is damaged.\n";
+		return;
+	}
+
+	// Older images load fine, but there is nothing to check them against
+	ImageLayout layout;
+	if( !ImageReader::getLayout(*image, layout) || layout.blockCount == 0 )
+		cout << "<" << imageName << "> has no checksums, compact to add them.\n";
+	else
+		cout << "<" << imageName << "> is intact, " << layout.blockCount 
+			<< " block(s) checked.\n";
+}
+
+/**
+ *	\brief Print one line of how much sharing TextFile bodies saves.
+ *	
+ *	\param where What the numbers are for.
+ *	\param uses What each use of a body is.
+ *	\param copies What each distinct body is kept in.
+ *	\param stats The numbers.
+ */
+void printSharing( const std::string& where, const std::string& uses, 
+	const std::string& copies, const SharingStats& stats )
+{
+	cout << where << ": " << stats.references << " " << uses << " share " 
+		<< stats.distinct << " " << copies << " holding " << stats.storedBytes 
+		<< " byte(s), " << stats.referencedBytes - stats.storedBytes 
+		<< " byte(s) saved.\n";
+}
+
+/**
+ *	\brief Report how much is saved by keeping each distinct TextFile body 
+ *	only once, in memory and in the image on disk.
+ *	
+ *	Bodies that are still read straight out of the image are only counted for 
+ *	the image, and the image is as it was at the last compact.
+ */
+void reportSharing()
+{
+	printSharing("Memory", "use(s)", "buffer(s)", BlobStore::getStats());
+
+	SharingStats stored;
+	const auto image = ImageFile::open(imageName);
+	if( !image || !ImageBodies::survey(*image, stored) )
+	{
+		cout << "Image: <" << imageName << "> has no indexed image yet, " 
+			<< "compact to write one.\n";
+		return;
+	}
+
+	printSharing("Image", "TextFile node(s)", "payload(s)", stored);
+}
+
 /**
  *	\brief Handle complex, multi-part commands that take an argument.
  *	
@@ -271,6 +1077,46 @@ bool handleCompound(Commands command, const std::string& input )
 				scheduler.setBurst( std::stoi(input.substr(len)));
 				break;
 
+			// Set how many worker threads to use
+			case SET_THREADS:
+				setThreads( std::stoi(input.substr(len)));
+				break;
+
+			// Take a snapshot of the FS
+			case SNAPSHOT:
+				takeSnapshot( input.substr(len));
+				break;
+
+			// Search everything under currentDirectory
+			case FIND:
+				findFiles( input.substr(len));
+				break;
+
+			// Search the TextFiles under a Directory
+			case GREP:
+				grepFiles( input.substr(len));
+				break;
+
+			// Add a line to the end of a TextFile
+			case APPEND:
+				appendText( input.substr(len));
+				break;
+
+			// Replace part of a TextFile
+			case EDIT:
+				editText( input.substr(len));
+				break;
+
+			// Copy a host directory tree into the FS
+			case IMPORT:
+				importTree( input.substr(len));
+				break;
+
+			// Write a Directory out to the host
+			case EXPORT:
+				exportTree( input.substr(len));
+				break;
+
 			default:
 				handled = false;
 		}
@@ -312,7 +1158,7 @@ bool handleSimple(Commands command, const std::string& input )
 		// List the file in currentDirectory
 		case LIST:
 			if( equalIC(input, "ls"))
-				currentDirectory->printData(0);
+				currentDirectory->printData(0, viewGeneration);
 			else
 				cout << "Error: <ls> is required format.\n";
 			break;
@@ -320,7 +1166,10 @@ bool handleSimple(Commands command, const std::string& input )
 		// Display the current working directory to the user
 		case PWD:
 			if( equalIC(input, "pwd"))
-				cout << "Current directory is " << *currentDirectory << endl; 
+			{
+				cout << "Current directory is " << viewPrefix() 
+					<< *currentDirectory << endl; 
+			}
 			else
 				cout << "Error: <pwd> is required format.\n";	
 			break;
@@ -352,7 +1201,43 @@ bool handleSimple(Commands command, const std::string& input )
 			}
 			break;
 
-		// Quit the program and write the current FS to disk
+		// Display how many worker threads there are
+		case GET_THREADS:
+			cout << "Worker Threads: " << workers->getThreadCount() << endl;
+			break;
+
+		// Fold the journal into a new image
+		case COMPACT:
+			compactImage();
+			break;
+
+		// Check the image on disk for damage
+		case FSCK:
+			checkImage();
+			break;
+
+		// List the snapshots that can be viewed
+		case SNAPSHOTS:
+			if( equalIC(input, "snapshots"))
+				listSnapshots();
+			else
+				cout << "Error: <snapshots> is required format.\n";
+			break;
+
+		// Add up what is under a Directory
+		case DU:
+			reportUsage(input.substr(cmd[DU].length()));
+			break;
+
+		// Show what sharing TextFile bodies saves
+		case DEDUP_STATS:
+			if( equalIC(input, "dedupstats"))
+				reportSharing();
+			else
+				cout << "Error: <dedupstats> is required format.\n";
+			break;
+
+		// Quit the program, every change is already in the journal
 		case QUIT:
 			running = false;
 			break;
@@ -384,11 +1269,15 @@ bool executeCommand( Commands command, const std::string& input )
 		// Handle all complex commands
 		case MKDIR: 	case CAT:  		case START:  	case CD: 
 		case ADD_PRO: 	case SET_MEM: 	case SET_BURST: case STEP:
+		case SET_THREADS: case SNAPSHOT:	case FIND:		case GREP:
+		case APPEND:	case EDIT:		case IMPORT:	case EXPORT:
 				return handleCompound(command, input);
 
 		// Handle all simple commands
 		case CREATE_TEXT: 	case LIST: 		case PWD: 	case RUN: 
-		case GET_MEM: 		case GET_BURST:	case QUIT:
+		case GET_MEM: 		case GET_BURST:	case GET_THREADS:
+		case COMPACT:		case FSCK:			case SNAPSHOTS:
+		case DU:			case DEDUP_STATS:	case QUIT:
 				return handleSimple(command, input);
 	}
 
@@ -402,88 +1291,61 @@ bool executeCommand( Commands command, const std::string& input )
  *	\param filename The name that was passed in by the user as a command-line 
  *	argument.
  *	
- *	\return The root directory of the reconstructed FS.
+ *	The image is memory-mapped and its block checksums are checked across 
+ *	the worker threads, then the tree is parsed straight out of the mapping.  
+ *	Both the indexed and the original sequential formats can be loaded.  Any 
+ *	journal records that are newer than the image are then replayed on top.
+ *	
+ *	\return The root directory of the reconstructed FS, or null if the image 
+ *	is damaged or is another version of the indexed format.
  */
-std::shared_ptr<Directory>  readInFile( const string& filename )
+Directory* readInFile( const string& filename )
 {
-	std::shared_ptr<Directory> root = nullptr;
-
-	// Load in the file from disk
-	std::ifstream inFile{ filename, std::ios::in | std::ios::binary};
+	Directory* root = nullptr;
+	std::uint64_t sequence = 0;
 
-    // 11 char token to pull from the file.  All files/directories are 
-	//	identified by 11 chars, 8 for name, a period, a 1 char extension 
-	//	and then a null character
-	char token[11];
-
-    // Once we will out the token, we have to toss out the null chars to parse 
-	//	it easier
-	std::string parsed;
-	
-	while( running == true)
+	// Map the file from disk
+	const auto image = ImageFile::open(filename);
+	if( image )
 	{
-        // Grab a token
-		inFile.read( token, sizeof(char)*11 );
-		parsed.clear();
-
-		// Strip the null chars
-		for( int i = 0; i < 11; i++)
+		// Images from another version of the indexed format are not read
+		const std::uint32_t version = ImageReader::getVersion(*image);
+		if( version != 1 && version != IMAGE_VERSION )
 		{
-			if( token[i] != '\0')
-				parsed += token[i];
+			cout << "<" << filename << "> is version " << version << 
+				" of the image format, only version " << IMAGE_VERSION << 
+				" can be loaded, so it was not loaded.\n";
+			return nullptr;
 		}
 
-        // Prep an iterator
-		auto extension = parsed.substr(parsed.size()-2);
-
-        // We found a directory
-		if( extension == ".d" )
+		// Never load (and later compact over) an image that is damaged
+		std::vector<ImageRange> damaged;
+		if( !ImageReader::verify(*image, *workers, damaged) )
 		{
-            // Special case for root.d
-			if( !currentDirectory )
-			{
-				root = Directory::CreateDirectory( parsed, nullptr, true);
-				currentDirectory = root.get();
-				rootPointer = root.get();
-			}
-			else
-			{
-                // Try to inflate the flat directory back into the linked 
-				//	structure
-				auto d = Directory::CreateDirectory(parsed, currentDirectory );
-
-				// Swap currentDirectory only if d was created
-				if( d )
-				{
-					currentDirectory->addObject( d );
-					currentDirectory = d.get();
-				}
-            }
-
-            // We get the number of files under the directory, but it's not used
-			int data;
-			inFile.read((char*)&data, sizeof(data));
+			reportDamage(damaged);
+			cout << "<" << filename << "> is damaged and was not loaded.\n";
+			return nullptr;
 		}
 
-        // We found a textfile
-		else if( extension == ".t" )
-			currentDirectory->addObject( TextFile::inflateTextFile(parsed, inFile));
+		root = ImageReader::load(image, nodes);
 
-        // We found a program
-		else if( extension == ".p")
-			currentDirectory->addObject( ProgramFile::inflateProgramFile(parsed, inFile));
-	
-        // found an endX token, close the current directory
-        else if( parsed.find_first_of("end" + currentDirectory->getFileName()) == 0)
+		ImageLayout layout;
+		if( ImageReader::getLayout(*image, layout) )
 		{
-			if( currentDirectory == rootPointer )
-				running = false;
-			else
-				currentDirectory = currentDirectory->getParent();
+			sequence = layout.journalSequence;
+			snapshots.restore(layout.snapshots, layout.snapshotCount);
 		}
 	}
 
-	inFile.close();
+	// If there is no existing FS, the journal starts from an empty root
+	if( !root )
+		root = Directory::CreateDirectory(nodes, "root", nullptr, true);
+
+	// Bring the FS up to date with the changes made since the last compact
+	const int replayed = journal.open(filename, root, sequence, 
+		snapshots);
+	if( replayed > 0 )
+		cout << "Replayed " << replayed << " change(s) from the journal.\n";
 
 	return root;
 }
@@ -514,24 +1376,25 @@ void trimWhiteSpace(std::string& input)
  *	
  *	The program can begin execution with a file system loaded from disk or with 
  *	none loaded.  If there is a FS on disk, it is re-inflated and used as root.  
- *	If there isn't one already, a new one is created and will be saved to the 
- *	supplied filename.
+ *	If there isn't one already, a new one is created.  Changes are journaled 
+ *	beside the supplied filename and folded into it by the compact command.
  */
-void commandLoop( const string& filename, std::shared_ptr<Directory> rootPtr )
+void commandLoop( const string& filename, Directory* rootPtr )
 {
 	// Start the running flag
 	running = true;
 
 	// Set root to what was passed in 
-	std::shared_ptr<Directory> root = rootPtr;
+	Directory* root = rootPtr;
 
 	// If null was passed, there is no existing FS, so make a new one
 	if( !root )
-		root = Directory::CreateDirectory("root", nullptr, true);
+		root = Directory::CreateDirectory(nodes, "root", nullptr, true);
 
 	// Initialize the Directory pointers
-	currentDirectory = root.get();
-	rootPointer = root.get();
+	currentDirectory = root;
+	rootPointer = root;
+	imageName = filename;
 	
     // Loop until Quit was entered
     while( running )
@@ -565,14 +1428,9 @@ void commandLoop( const string& filename, std::shared_ptr<Directory> rootPtr )
 		if( !handled ) cout << "Unknown Command...\n";
 	}
 
-    // User has finished, compress everything down and write it out to a file
-	std::ofstream outfile{filename, std::ios::out | std::ios::binary};
-
-    // Starting from the root node, recursively write each piece into the file
-	root->writeToFile(outfile);
-
-    // Jobs done!
-	outfile.close();
+    // User has finished, every change is in the journal so just make sure it 
+	//	has reached the disk.  "compact" folds it into the image.
+	journal.sync();
 }
 
 
@@ -585,8 +1443,8 @@ void commandLoop( const string& filename, std::shared_ptr<Directory> rootPtr )
  *	
  *	The program accepts a single command-line argument, the name of the file 
  *	system on disk.  The system will attempt to find the specified FS and load 
- *	it in, if none is found, a new one is created.  When the program is quit by 
- *	the user, the new FS is written to disk.
+ *	it in, if none is found, a new one is created.  Every change is journaled 
+ *	to disk as it is made.
  *	
  *	\return 0 if the program exited successfully, -1 otherwise.
  */
@@ -599,22 +1457,15 @@ int main( int argc, char* argv[])
 		return -1;
 	}
 	
-	// Attempt to load in the FS from disk
-	std::fstream file(argv[1], std::ios::in | std::ios::binary);
+	// Use every core for the whole-FS jobs until told otherwise
+	workers.reset(new ThreadPool(ThreadPool::hardwareThreads()));
 
-	// If it was loaded successfully, use it as root
-	if( file.good() )
-	{
-		file.close();
-		commandLoop( argv[1], readInFile(argv[1]));
-	}
+	// Load the FS from disk, or start a new one if there isn't one yet
+	const auto root = readInFile(argv[1]);
+	if( !root )
+		return -1;
 
-	// If it wasn't loaded, then the system will make a new root
-	else
-	{
-		file.close();
-		commandLoop( argv[1], nullptr );
-	}
+	commandLoop( argv[1], root );
 	
 	return 0;
 }